@@ -0,0 +1,215 @@
+#include "aiplayer.h"
+#include <QTimer>
+
+void SearchWorker::cancelBefore(quint64 id)
+{
+    m_latestId.store(id);
+    m_search.stop();
+}
+
+void SearchWorker::finishPonder(quint64 id)
+{
+    m_finishId.store(id);
+    if (id == m_latestId.load()) {
+        m_search.stop();
+    }
+}
+
+void SearchWorker::setTablebase(std::shared_ptr<const Tablebase> tablebase)
+{
+    m_tablebase = std::move(tablebase);
+    m_search.setTablebase(m_tablebase.get());
+}
+
+void SearchWorker::search(quint64 id, const Position& position, int moveTimeMs, int threadCount, bool ponder)
+{
+    // Superseded while waiting in the queue
+    if (id != m_latestId.load()) return;
+    
+    Move bookMove;
+    if (m_book && m_book->pickMove(position, m_random(), bookMove)) {
+        SearchInfo result;
+        result.bestMove = bookMove;
+        result.pv.push_back(bookMove);
+        result.fromBook = true;
+        emit searchFinished(id, result);
+        return;
+    }
+    
+    SearchLimits limits;
+    limits.moveTimeMs = ponder ? 0 : moveTimeMs;
+    
+    if (threadCount != m_search.threadCount()) {
+        m_search.setThreadCount(threadCount);
+    }
+    
+    QElapsedTimer sinceReport;
+    SearchInfo result = m_search.search(position, limits, [this, id, ponder, &sinceReport](const SearchInfo& info) {
+        // Catches a cancel that raced with the start of this search
+        if (id != m_latestId.load()) {
+            m_search.stop();
+            return;
+        }
+        // Likewise a finishPonder that came before the search started
+        if (ponder && id == m_finishId.load()) {
+            m_search.stop();
+        }
+        
+        if (m_reportIntervalMs > 0 && sinceReport.isValid() && sinceReport.elapsed() < m_reportIntervalMs) {
+            return;
+        }
+        sinceReport.start();
+        emit iterationFinished(id, info);
+    });
+    
+    emit searchFinished(id, result);
+}
+
+AiPlayer::AiPlayer(QObject *parent)
+    : QObject(parent)
+    , m_worker(new SearchWorker)
+{
+    qRegisterMetaType<Move>("Move");
+    qRegisterMetaType<Position>("Position");
+    qRegisterMetaType<SearchInfo>("SearchInfo");
+    
+    m_worker->moveToThread(&m_thread);
+    connect(&m_thread, &QThread::finished, m_worker, &QObject::deleteLater);
+    
+    connect(this, &AiPlayer::searchRequested, m_worker, &SearchWorker::search);
+    connect(m_worker, &SearchWorker::iterationFinished, this, &AiPlayer::onIterationFinished);
+    connect(m_worker, &SearchWorker::searchFinished, this, &AiPlayer::onSearchFinished);
+    
+    m_thread.start();
+}
+
+AiPlayer::~AiPlayer()
+{
+    stop();
+    m_thread.quit();
+    m_thread.wait();
+}
+
+void AiPlayer::setTablebase(std::shared_ptr<const Tablebase> tablebase)
+{
+    // Queued behind any search already waiting, so it never changes under one
+    SearchWorker* worker = m_worker;
+    QMetaObject::invokeMethod(m_worker, [worker, tablebase]() {
+        worker->setTablebase(tablebase);
+    }, Qt::QueuedConnection);
+}
+
+void AiPlayer::setOpeningBook(std::shared_ptr<const OpeningBook> book)
+{
+    SearchWorker* worker = m_worker;
+    QMetaObject::invokeMethod(m_worker, [worker, book]() {
+        worker->setOpeningBook(book);
+    }, Qt::QueuedConnection);
+}
+
+void AiPlayer::setPonderEnabled(bool enabled)
+{
+    m_ponderEnabled = enabled;
+    if (!enabled && m_ponderId != 0) {
+        stop();
+    }
+}
+
+void AiPlayer::startThinking(const Position& position)
+{
+    if (m_ponderId != 0 && m_ponderId == m_searchId && position.hash() == m_ponderHash) {
+        // Ponder hit: the running search becomes the real one
+        const quint64 id = m_ponderId;
+        m_ponderId = 0;
+        m_thinking = true;
+        
+        if (m_ponderFinished) {
+            // Queued, so the move isn't made inside the caller's turnChanged
+            QMetaObject::invokeMethod(this, [this, id]() {
+                onSearchFinished(id, m_ponderResult);
+            }, Qt::QueuedConnection);
+            return;
+        }
+        
+        // Time spent pondering counts towards the move time
+        qint64 remaining = m_moveTimeMs - m_ponderTimer.elapsed();
+        if (remaining <= 0) {
+            m_worker->finishPonder(id);
+        } else {
+            QTimer::singleShot(static_cast<int>(remaining), this, [this, id]() {
+                if (id == m_searchId && m_thinking) {
+                    m_worker->finishPonder(id);
+                }
+            });
+        }
+        return;
+    }
+    
+    // Each search gets a new id; results carrying an older one are ignored.
+    // Cancelling only raises a flag, so a missed ponder never blocks here.
+    m_ponderId = 0;
+    m_worker->cancelBefore(++m_searchId);
+    m_thinking = true;
+    emit searchRequested(m_searchId, position, m_moveTimeMs, m_threadCount, false);
+}
+
+void AiPlayer::startPondering(const Position& position)
+{
+    stop();
+    if (!m_ponderEnabled) return;
+    
+    MoveList moves;
+    position.generateMoves(moves);
+    if (moves.isEmpty()) return;
+    
+    Position ponderPosition = position;
+    for (const Move& move : moves) {
+        if (m_predictedReply.isValid() && move == m_predictedReply) {
+            UndoRecord undo;
+            ponderPosition.doMove(move, undo);
+            break;
+        }
+    }
+    
+    m_ponderId = ++m_searchId;
+    m_ponderHash = ponderPosition.hash();
+    m_ponderFinished = false;
+    m_ponderTimer.start();
+    m_worker->cancelBefore(m_ponderId);
+    emit searchRequested(m_ponderId, ponderPosition, 0, m_threadCount, true);
+}
+
+void AiPlayer::stop()
+{
+    m_worker->cancelBefore(++m_searchId);
+    m_thinking = false;
+    m_ponderId = 0;
+}
+
+void AiPlayer::onIterationFinished(quint64 id, const SearchInfo& info)
+{
+    // Ponder iterations stay quiet until a hit
+    if (id == m_searchId && m_thinking) {
+        emit searchInfo(info);
+    }
+}
+
+void AiPlayer::onSearchFinished(quint64 id, const SearchInfo& info)
+{
+    if (id != m_searchId) return;
+    
+    if (id == m_ponderId) {
+        // Kept in case the predicted reply is played
+        m_ponderFinished = true;
+        m_ponderResult = info;
+        return;
+    }
+    
+    m_thinking = false;
+    emit searchInfo(info);
+    
+    if (info.bestMove.isValid()) {
+        m_predictedReply = info.pv.size() >= 2 ? info.pv[1] : Move::invalid();
+        emit moveChosen(info.bestMove);
+    }
+}
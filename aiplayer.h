@@ -0,0 +1,134 @@
+#ifndef AIPLAYER_H
+#define AIPLAYER_H
+
+#include <QElapsedTimer>
+#include <QObject>
+#include <QThread>
+#include <atomic>
+#include <memory>
+#include <random>
+#include "openingbook.h"
+#include "position.h"
+#include "search.h"
+
+// Runs the search on the AI thread. Only AiPlayer talks to it.
+class SearchWorker : public QObject
+{
+    Q_OBJECT
+    
+public:
+    // Safe to call from any thread. Requests older than id are skipped, or
+    // stopped if they are already running.
+    void cancelBefore(quint64 id);
+    
+    // Safe to call from any thread. Ends ponder search id as soon as
+    // possible, reporting its result as usual.
+    void finishPonder(quint64 id);
+    
+    // Call on the worker thread, between searches
+    void setTablebase(std::shared_ptr<const Tablebase> tablebase);
+    void setOpeningBook(std::shared_ptr<const OpeningBook> book) { m_book = std::move(book); }
+    
+    // Iterations finishing sooner than this after the last one reported
+    // are not reported (default: 0, all of them). searchFinished always is.
+    void setReportInterval(int ms) { m_reportIntervalMs = ms; }
+    
+public slots:
+    // A ponder search ignores moveTimeMs and runs until it is cancelled or
+    // finished with finishPonder
+    void search(quint64 id, const Position& position, int moveTimeMs, int threadCount, bool ponder);
+    
+signals:
+    void iterationFinished(quint64 id, const SearchInfo& info);
+    void searchFinished(quint64 id, const SearchInfo& info);
+    
+private:
+    ParallelSearch m_search;
+    std::shared_ptr<const Tablebase> m_tablebase;
+    std::shared_ptr<const OpeningBook> m_book;
+    std::mt19937_64 m_random{std::random_device{}()};
+    std::atomic<quint64> m_latestId{0};
+    std::atomic<quint64> m_finishId{0};
+    int m_reportIntervalMs = 0;
+};
+
+// Computer opponent. Searches run on a worker thread so the board keeps
+// painting while the engine thinks; results arrive as queued signals.
+//
+// While the opponent is on move the engine ponders: it searches the
+// position after the reply its last search predicted. If that reply is
+// played, startThinking carries on with the ponder search, and answers at
+// once if it has already used the move time. Otherwise the ponder is
+// cancelled without waiting and a normal search starts, still helped by
+// what the ponder left in the hash table.
+class AiPlayer : public QObject
+{
+    Q_OBJECT
+    
+public:
+    static constexpr int DEFAULT_MOVE_TIME_MS = 1000;
+    
+    explicit AiPlayer(QObject *parent = nullptr);
+    ~AiPlayer();
+    
+    PlayerColor color() const { return m_color; }
+    void setColor(PlayerColor color) { m_color = color; }
+    int moveTime() const { return m_moveTimeMs; }
+    void setMoveTime(int ms) { m_moveTimeMs = ms; }
+    int threadCount() const { return m_threadCount; }
+    void setThreadCount(int threadCount) { m_threadCount = threadCount; }
+    bool isThinking() const { return m_thinking; }
+    bool ponderEnabled() const { return m_ponderEnabled; }
+    void setPonderEnabled(bool enabled);
+    
+    // Lets the engine play covered endgames perfectly
+    void setTablebase(std::shared_ptr<const Tablebase> tablebase);
+    
+    // Book moves are played at once, picked at random by weight
+    void setOpeningBook(std::shared_ptr<const OpeningBook> book);
+    
+public slots:
+    // Starts searching the position, abandoning any search in progress
+    // unless it is a ponder search of this very position
+    void startThinking(const Position& position);
+    
+    // Ponders while the opponent is to move in position. Without a
+    // predicted reply it searches position itself, which still fills the
+    // hash table. Does nothing if pondering is off or the opponent has no
+    // moves.
+    void startPondering(const Position& position);
+    
+    // Abandons the current search or ponder without emitting moveChosen
+    void stop();
+    
+signals:
+    void moveChosen(const Move& move);
+    void searchInfo(const SearchInfo& info); // After every completed depth
+    
+    // Internal: queues a search on the worker thread
+    void searchRequested(quint64 id, const Position& position, int moveTimeMs, int threadCount, bool ponder);
+    
+private slots:
+    void onIterationFinished(quint64 id, const SearchInfo& info);
+    void onSearchFinished(quint64 id, const SearchInfo& info);
+    
+private:
+    QThread m_thread;
+    SearchWorker* m_worker;
+    PlayerColor m_color = PlayerColor::Black;
+    int m_moveTimeMs = DEFAULT_MOVE_TIME_MS;
+    int m_threadCount = 1;
+    quint64 m_searchId = 0;
+    bool m_thinking = false;
+    
+    // Pondering. m_ponderId is the running ponder search, or 0.
+    bool m_ponderEnabled = true;
+    Move m_predictedReply = Move::invalid(); // Second move of the last PV
+    quint64 m_ponderId = 0;
+    quint64 m_ponderHash = 0; // Position being pondered
+    QElapsedTimer m_ponderTimer;
+    bool m_ponderFinished = false; // It ended by itself, e.g. a book move
+    SearchInfo m_ponderResult;
+};
+
+#endif // AIPLAYER_H
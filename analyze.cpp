@@ -0,0 +1,401 @@
+#include "packed.h"
+#include "pdn.h"
+#include "search.h"
+#include "tablebase.h"
+#include "threadpool.h"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Batch position analysis.
+//
+//   checkers-analyze <positions> [options]
+//
+// Searches every position in the file on a thread pool and writes one line
+// per position, in input order, as soon as it and everything before it is
+// done:
+//
+//   <fen> best <move> score <n> depth <n> nodes <n> pv <moves>
+//
+// Positions are either text, one FEN per line (lines starting with '#' and
+// anything after the FEN are ignored), or binary records back to back:
+// 14-byte Packed records (packed.h, what CheckersGame::serialize writes) or
+// the 264-byte records older versions wrote. The format is told from the
+// first byte unless --format gives it. Positions are read as they are
+// needed, so files of any size can be analysed.
+//
+// Options:
+//   --format <f>       auto, fen, packed or serialized (the old 264-byte
+//                      records; default: auto)
+//   --depth <n>        Search depth (default: 10, or unlimited with --nodes)
+//   --nodes <n>        Node budget per position
+//   --threads <n>      Positions searched at once (default: all cores)
+//   --hash <MB>        Hash table per thread, cleared for every position so
+//                      results don't depend on the order (default: 16)
+//   --tablebase <dir>  Score positions these tablebases cover exactly
+//   --output <file>    Write results here instead of standard output
+
+namespace {
+
+enum class Format {
+    Auto,
+    Fen,
+    Packed,
+    Serialized
+};
+
+struct Options {
+    std::string inputPath;
+    std::string outputPath;
+    Format format = Format::Auto;
+    SearchLimits limits;
+    int threadCount = 1;
+    std::size_t hashMegabytes = 16;
+    std::shared_ptr<const Tablebase> tablebase;
+};
+
+void printUsage()
+{
+    std::fprintf(stderr,
+        "Usage: checkers-analyze <positions> [--format auto|fen|packed|serialized] [--depth <n>] [--nodes <n>]\n"
+        "                        [--threads <n>] [--hash <MB>] [--tablebase <dir>] [--output <file>]\n");
+}
+
+// CheckersGame::serialize used to write a QDataStream of 64 big-endian 32-bit
+// piece codes, row by row from the top, then the side to move and the winner
+constexpr std::size_t SERIALIZED_SIZE = (64 + 2) * 4;
+
+bool decodeSerialized(const unsigned char* data, Position& position)
+{
+    auto readInt = [data](int index) {
+        const unsigned char* p = data + index * 4;
+        return static_cast<std::int32_t>((std::uint32_t(p[0]) << 24) | (std::uint32_t(p[1]) << 16)
+                                         | (std::uint32_t(p[2]) << 8) | std::uint32_t(p[3]));
+    };
+    
+    position.clear();
+    for (int row = 0; row < 8; ++row) {
+        for (int col = 0; col < 8; ++col) {
+            std::int32_t piece = readInt(row * 8 + col);
+            if (piece < 0 || piece > static_cast<int>(Piece::BlackKing)) return false;
+            int square = Bitboard::squareIndex(row, col);
+            if (square < 0) {
+                if (piece != 0) return false;
+                continue;
+            }
+            position.setPiece(square, static_cast<Piece>(piece));
+        }
+    }
+    
+    std::int32_t side = readInt(64);
+    if (side != static_cast<int>(PlayerColor::Red) && side != static_cast<int>(PlayerColor::Black)) return false;
+    position.setSideToMove(static_cast<PlayerColor>(side));
+    return true;
+}
+
+const char* formatName(Format format)
+{
+    switch (format) {
+        case Format::Packed:     return "packed";
+        case Format::Serialized: return "serialized";
+        default:                 return "fen";
+    }
+}
+
+// Reads positions one at a time, skipping (and reporting) invalid ones
+class PositionReader
+{
+public:
+    bool open(const std::string& path, Format format)
+    {
+        m_in.open(path, std::ios::binary);
+        if (!m_in) return false;
+        
+        m_format = format;
+        if (m_format == Format::Auto) {
+            // Old records start with the big-endian code of an empty light
+            // square; text never starts with a zero byte or a Packed tag
+            int first = m_in.peek();
+            if (first == Packed::VERSION_1) {
+                m_format = Format::Packed;
+            } else {
+                m_format = (first == 0) ? Format::Serialized : Format::Fen;
+            }
+        }
+        return true;
+    }
+    
+    bool next(Position& position)
+    {
+        if (m_format == Format::Packed) {
+            Packed::Record record;
+            PlayerColor winner;
+            while (m_in.read(reinterpret_cast<char*>(record.data()), Packed::SIZE)) {
+                ++m_record;
+                if (Packed::decode(record.data(), record.size(), position, winner)) return true;
+                std::fprintf(stderr, "Record %zu: invalid position, skipped\n", m_record);
+            }
+            if (m_in.gcount() > 0) {
+                std::fprintf(stderr, "Trailing %lld bytes ignored\n", static_cast<long long>(m_in.gcount()));
+            }
+            return false;
+        }
+        
+        if (m_format == Format::Serialized) {
+            unsigned char record[SERIALIZED_SIZE];
+            while (m_in.read(reinterpret_cast<char*>(record), SERIALIZED_SIZE)) {
+                ++m_record;
+                if (decodeSerialized(record, position)) return true;
+                std::fprintf(stderr, "Record %zu: invalid position, skipped\n", m_record);
+            }
+            if (m_in.gcount() > 0) {
+                std::fprintf(stderr, "Trailing %lld bytes ignored\n", static_cast<long long>(m_in.gcount()));
+            }
+            return false;
+        }
+        
+        std::string line;
+        while (std::getline(m_in, line)) {
+            ++m_record;
+            std::size_t start = line.find_first_not_of(" \t\r");
+            if (start == std::string::npos || line[start] == '#') continue;
+            std::size_t end = line.find_first_of(" \t\r", start);
+            std::string fen = line.substr(start, end == std::string::npos ? std::string::npos : end - start);
+            if (position.fromFen(fen)) return true;
+            std::fprintf(stderr, "Line %zu: invalid FEN %s, skipped\n", m_record, fen.c_str());
+        }
+        return false;
+    }
+    
+    Format format() const { return m_format; }
+    
+private:
+    std::ifstream m_in;
+    Format m_format = Format::Auto;
+    std::size_t m_record = 0;
+};
+
+class Analysis
+{
+public:
+    explicit Analysis(const Options& options)
+        : m_options(options)
+    {
+    }
+    
+    int run();
+    
+private:
+    struct ThreadStats {
+        std::uint64_t positions = 0;
+        std::uint64_t nodes = 0;
+        double busySeconds = 0.0;
+    };
+    
+    void analyze(ThreadPool& pool, std::size_t index, const Position& position);
+    void finish(std::size_t index, std::string line);
+    
+    const Options& m_options;
+    std::FILE* m_output = stdout;
+    
+    // Results finished out of order wait here until they're next. Reading
+    // pauses while too many are in flight, which bounds this and the queues.
+    std::mutex m_mutex;
+    std::condition_variable m_written;
+    std::map<std::size_t, std::string> m_finished;
+    std::size_t m_nextToWrite = 0;
+    std::size_t m_inFlight = 0;
+    std::vector<ThreadStats> m_threadStats; // Indexed by pool worker
+};
+
+int Analysis::run()
+{
+    PositionReader reader;
+    if (!reader.open(m_options.inputPath, m_options.format)) {
+        std::fprintf(stderr, "Cannot read %s\n", m_options.inputPath.c_str());
+        return 1;
+    }
+    if (!m_options.outputPath.empty()) {
+        m_output = std::fopen(m_options.outputPath.c_str(), "w");
+        if (!m_output) {
+            std::fprintf(stderr, "Cannot write %s\n", m_options.outputPath.c_str());
+            return 1;
+        }
+    }
+    
+    const std::size_t maxInFlight = static_cast<std::size_t>(m_options.threadCount) * 64;
+    m_threadStats.assign(static_cast<std::size_t>(m_options.threadCount), ThreadStats());
+    
+    auto started = std::chrono::steady_clock::now();
+    std::size_t count = 0;
+    {
+        ThreadPool pool(m_options.threadCount);
+        Position position;
+        while (reader.next(position)) {
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_written.wait(lock, [this, maxInFlight]() { return m_inFlight < maxInFlight; });
+                ++m_inFlight;
+            }
+            const std::size_t index = count++;
+            pool.submit([this, &pool, index, position]() { analyze(pool, index, position); });
+        }
+        pool.wait();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    
+    if (m_output != stdout) {
+        std::fclose(m_output);
+    }
+    
+    std::uint64_t nodes = 0;
+    for (const ThreadStats& stats : m_threadStats) {
+        nodes += stats.nodes;
+    }
+    std::fprintf(stderr, "%zu positions (%s) in %.2f s: %.1f positions/s, %.0f knodes/s\n",
+                 count, formatName(reader.format()), seconds,
+                 seconds > 0 ? static_cast<double>(count) / seconds : 0.0,
+                 seconds > 0 ? static_cast<double>(nodes) / seconds / 1000 : 0.0);
+    for (std::size_t i = 0; i < m_threadStats.size(); ++i) {
+        const ThreadStats& stats = m_threadStats[i];
+        std::fprintf(stderr, "thread %2zu  %8llu positions  %6.2f s busy  %5.1f%% utilization\n",
+                     i, static_cast<unsigned long long>(stats.positions), stats.busySeconds,
+                     seconds > 0 ? 100.0 * stats.busySeconds / seconds : 0.0);
+    }
+    return 0;
+}
+
+void Analysis::analyze(ThreadPool& pool, std::size_t index, const Position& position)
+{
+    auto started = std::chrono::steady_clock::now();
+    
+    // Each pool thread keeps its engine between positions, so there is one
+    // Analysis per process
+    thread_local std::unique_ptr<ParallelSearch> engine;
+    if (!engine) {
+        engine = std::make_unique<ParallelSearch>(1, m_options.hashMegabytes);
+        engine->setTablebase(m_options.tablebase.get());
+    }
+    engine->clearHash();
+    SearchInfo info = engine->search(position, m_options.limits);
+    
+    std::string line = position.toFen();
+    line += " best ";
+    line += info.bestMove.isValid() ? Pdn::moveText(info.bestMove) : std::string("none");
+    line += " score " + std::to_string(info.score);
+    line += " depth " + std::to_string(info.depth);
+    line += " nodes " + std::to_string(info.nodes);
+    line += " pv";
+    for (const Move& move : info.pv) {
+        line += ' ';
+        line += Pdn::moveText(move);
+    }
+    line += '\n';
+    
+    double busy = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    // Only this worker writes its entry, and run() reads them once the
+    // pool has joined
+    ThreadStats& stats = m_threadStats[static_cast<std::size_t>(pool.workerIndex())];
+    stats.positions++;
+    stats.nodes += info.nodes;
+    stats.busySeconds += busy;
+    finish(index, std::move(line));
+}
+
+void Analysis::finish(std::size_t index, std::string line)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_finished.emplace(index, std::move(line));
+    
+    // Write every result that is now next in order
+    bool wrote = false;
+    for (auto it = m_finished.begin(); it != m_finished.end() && it->first == m_nextToWrite;
+         it = m_finished.erase(it)) {
+        std::fwrite(it->second.data(), 1, it->second.size(), m_output);
+        ++m_nextToWrite;
+        --m_inFlight;
+        wrote = true;
+    }
+    if (wrote) {
+        std::fflush(m_output);
+        m_written.notify_one();
+    }
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    Options options;
+    options.threadCount = static_cast<int>(std::thread::hardware_concurrency());
+    std::string tablebasePath;
+    bool depthGiven = false;
+    
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--format") == 0 && i + 1 < argc) {
+            const char* format = argv[++i];
+            if (std::strcmp(format, "auto") == 0) {
+                options.format = Format::Auto;
+            } else if (std::strcmp(format, "fen") == 0) {
+                options.format = Format::Fen;
+            } else if (std::strcmp(format, "packed") == 0) {
+                options.format = Format::Packed;
+            } else if (std::strcmp(format, "serialized") == 0) {
+                options.format = Format::Serialized;
+            } else {
+                printUsage();
+                return 1;
+            }
+        } else if (std::strcmp(argv[i], "--depth") == 0 && i + 1 < argc) {
+            options.limits.maxDepth = std::max(std::atoi(argv[++i]), 1);
+            depthGiven = true;
+        } else if (std::strcmp(argv[i], "--nodes") == 0 && i + 1 < argc) {
+            options.limits.maxNodes = std::strtoull(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            options.threadCount = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--hash") == 0 && i + 1 < argc) {
+            options.hashMegabytes = static_cast<std::size_t>(std::max(std::atoi(argv[++i]), 1));
+        } else if (std::strcmp(argv[i], "--tablebase") == 0 && i + 1 < argc) {
+            tablebasePath = argv[++i];
+        } else if (std::strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+            options.outputPath = argv[++i];
+        } else if (options.inputPath.empty() && argv[i][0] != '-') {
+            options.inputPath = argv[i];
+        } else {
+            printUsage();
+            return 1;
+        }
+    }
+    if (options.inputPath.empty()) {
+        printUsage();
+        return 1;
+    }
+    if (!depthGiven && options.limits.maxNodes == 0) {
+        options.limits.maxDepth = 10;
+    }
+    if (options.threadCount < 1) {
+        options.threadCount = 1;
+    }
+    
+    if (!tablebasePath.empty()) {
+        auto tablebase = std::make_shared<Tablebase>();
+        if (tablebase->load(tablebasePath) == 0) {
+            std::fprintf(stderr, "No tablebase files in %s\n", tablebasePath.c_str());
+            return 1;
+        }
+        options.tablebase = tablebase;
+    }
+    
+    Analysis analysis(options);
+    return analysis.run();
+}
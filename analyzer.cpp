@@ -0,0 +1,66 @@
+#include "analyzer.h"
+
+Analyzer::Analyzer(QObject *parent)
+    : QObject(parent)
+    , m_worker(new SearchWorker)
+{
+    qRegisterMetaType<Position>("Position");
+    qRegisterMetaType<SearchInfo>("SearchInfo");
+    
+    // Throttled on the worker, so fast shallow iterations never flood the
+    // GUI thread's event queue
+    m_worker->setReportInterval(REPORT_INTERVAL_MS);
+    m_worker->moveToThread(&m_thread);
+    connect(&m_thread, &QThread::finished, m_worker, &QObject::deleteLater);
+    
+    connect(this, &Analyzer::searchRequested, m_worker, &SearchWorker::search);
+    connect(m_worker, &SearchWorker::iterationFinished, this, &Analyzer::onIterationFinished);
+    connect(m_worker, &SearchWorker::searchFinished, this, &Analyzer::onSearchFinished);
+    
+    m_thread.start(QThread::LowPriority);
+}
+
+Analyzer::~Analyzer()
+{
+    stop();
+    m_thread.quit();
+    m_thread.wait();
+}
+
+void Analyzer::setTablebase(std::shared_ptr<const Tablebase> tablebase)
+{
+    SearchWorker* worker = m_worker;
+    QMetaObject::invokeMethod(m_worker, [worker, tablebase]() {
+        worker->setTablebase(tablebase);
+    }, Qt::QueuedConnection);
+}
+
+void Analyzer::analyze(const Position& position)
+{
+    // A move time of 0 searches until stopped
+    m_worker->cancelBefore(++m_searchId);
+    m_running = true;
+    emit searchRequested(m_searchId, position, 0, 1, false);
+}
+
+void Analyzer::stop()
+{
+    m_worker->cancelBefore(++m_searchId);
+    m_running = false;
+}
+
+void Analyzer::onIterationFinished(quint64 id, const SearchInfo& info)
+{
+    if (id == m_searchId) {
+        emit analysisUpdated(info);
+    }
+}
+
+void Analyzer::onSearchFinished(quint64 id, const SearchInfo& info)
+{
+    // Only ends by itself at the depth limit or on a solved position
+    if (id != m_searchId) return;
+    
+    m_running = false;
+    emit analysisUpdated(info);
+}
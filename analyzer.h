@@ -0,0 +1,50 @@
+#ifndef ANALYZER_H
+#define ANALYZER_H
+
+#include <QObject>
+#include <QThread>
+#include <memory>
+#include "aiplayer.h"
+
+// Background analysis for the hint display. Searches a copy of the given
+// position without a time limit on a thread of its own, so the GUI thread
+// only ever receives queued results, at most a few times a second.
+// Starting a new analysis cancels the old one without waiting for it.
+class Analyzer : public QObject
+{
+    Q_OBJECT
+    
+public:
+    static constexpr int REPORT_INTERVAL_MS = 150;
+    
+    explicit Analyzer(QObject *parent = nullptr);
+    ~Analyzer();
+    
+    bool isRunning() const { return m_running; }
+    void setTablebase(std::shared_ptr<const Tablebase> tablebase);
+    
+public slots:
+    // Restarts the analysis on position
+    void analyze(const Position& position);
+    void stop();
+    
+signals:
+    // Each deeper result for the current position. Old positions' results
+    // are dropped.
+    void analysisUpdated(const SearchInfo& info);
+    
+    // Internal: queues a search on the worker thread
+    void searchRequested(quint64 id, const Position& position, int moveTimeMs, int threadCount, bool ponder);
+    
+private slots:
+    void onIterationFinished(quint64 id, const SearchInfo& info);
+    void onSearchFinished(quint64 id, const SearchInfo& info);
+    
+private:
+    QThread m_thread;
+    SearchWorker* m_worker;
+    quint64 m_searchId = 0;
+    bool m_running = false;
+};
+
+#endif // ANALYZER_H
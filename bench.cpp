@@ -0,0 +1,421 @@
+#include "eval.h"
+#include "position.h"
+#include "search.h"
+#include "tablebase.h"
+#include "variants.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <thread>
+#include <vector>
+
+// Headless benchmark for the rules engine.
+//
+//   checkers-bench perft <depth> [options]    Leaf-node count and nodes/sec
+//   checkers-bench divide <depth> [options]   Same, listing the count per root move
+//   checkers-bench search <depth> [options]   Alpha-beta search, one line per iteration
+//   checkers-bench scaling <depth> [options]  Time to depth and nodes/sec for 1..n search threads
+//   checkers-bench eval <depth> [options]     Evaluation cost per node, full and incremental
+//
+// Options:
+//   --position <fen>   Start from a PDN FEN position, e.g. "W:W21-32:B1-12"
+//   --threads <n>      Perft threads sharing the root moves, or search threads (default: all cores)
+//   --movetime <ms>    Stop the search after this long (default: no limit)
+//   --hash <mb>        Transposition table size (default: 64)
+//   --tablebase <dir>  Score positions covered by the endgame tablebases in dir
+//   --variant <name>   perft/divide under american, russian, brazilian or
+//                      international rules, using the generator built from
+//                      that rules policy (see variants.h) instead of Position
+
+namespace {
+
+// Heap allocations made by the current thread, so the move generator can be
+// checked to stay allocation-free
+thread_local std::uint64_t t_allocations = 0;
+
+template <class MoveType>
+struct RootResult {
+    MoveType move;
+    std::uint64_t nodes;
+    std::uint64_t allocations;
+};
+
+void printUsage()
+{
+    std::fprintf(stderr,
+        "Usage: checkers-bench perft|divide|search|scaling|eval <depth> [--position <fen>] [--threads <n>]\n"
+        "                      [--movetime <ms>] [--hash <mb>] [--tablebase <dir>] [--variant <name>]\n");
+}
+
+// Squares are printed in the usual 1-32 (1-50 on 10x10) numbering
+template <class MoveType>
+void printMove(const MoveType& move)
+{
+    std::printf("%d%c%d", move.from + 1, move.isCapture() ? 'x' : '-', move.to + 1);
+}
+
+void printSearchInfo(const SearchInfo& info)
+{
+    std::printf("depth %2d  score %6d  nodes %12llu  time %7lld ms  %10llu nodes/s  pv",
+                info.depth,
+                info.score,
+                static_cast<unsigned long long>(info.nodes),
+                static_cast<long long>(info.timeMs),
+                static_cast<unsigned long long>(info.nodesPerSecond()));
+    for (const Move& move : info.pv) {
+        std::printf(" ");
+        printMove(move);
+    }
+    std::printf("\n");
+    std::fflush(stdout);
+}
+
+// Searches to a fixed depth with 1, 2, 4, ... and finally maxThreads threads,
+// starting each run from an empty table
+void printScaling(const Position& position, int depth, int maxThreads, std::size_t hashMegabytes)
+{
+    std::vector<int> counts;
+    for (int threads = 1; threads < maxThreads; threads *= 2) {
+        counts.push_back(threads);
+    }
+    counts.push_back(maxThreads);
+    
+    SearchLimits limits;
+    limits.maxDepth = depth;
+    
+    double baseSeconds = 0;
+    double baseRate = 0;
+    ParallelSearch search(1, hashMegabytes);
+    
+    for (int threads : counts) {
+        search.setThreadCount(threads);
+        search.clearHash();
+        
+        auto startTime = std::chrono::steady_clock::now();
+        SearchInfo info = search.search(position, limits);
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - startTime;
+        
+        double seconds = std::max(elapsed.count(), 1e-6);
+        double rate = static_cast<double>(info.nodes) / seconds;
+        if (threads == 1) {
+            baseSeconds = seconds;
+            baseRate = rate;
+        }
+        
+        std::printf("threads %3d  time %8.3f s  nodes %12llu  %10.0f nodes/s  speedup %5.2fx  nps scaling %5.2fx  best ",
+                    threads,
+                    seconds,
+                    static_cast<unsigned long long>(info.nodes),
+                    rate,
+                    baseSeconds / seconds,
+                    rate / baseRate);
+        printMove(info.bestMove);
+        std::printf("\n");
+        std::fflush(stdout);
+    }
+}
+
+enum class EvalMode {
+    None,
+    Full,       // Evaluate every node from scratch
+    Incremental // Update the accumulator on each move
+};
+
+// Walks the whole tree to depth like perft, evaluating every node the way
+// Mode says. Scores are summed into checksum so none can be optimised away.
+template <EvalMode Mode>
+std::uint64_t evalWalk(Position& position, int depth, Eval::Accumulator* accumulators, std::int64_t& checksum)
+{
+    if (Mode == EvalMode::Full) {
+        checksum += Eval::evaluate(position);
+    } else if (Mode == EvalMode::Incremental) {
+        checksum += Eval::evaluate(position, accumulators[0]);
+    }
+    if (depth == 0) return 1;
+    
+    MoveList moves;
+    position.generateMoves(moves);
+    
+    std::uint64_t nodes = 1;
+    UndoRecord undo;
+    for (const Move& move : moves) {
+        position.doMove(move, undo);
+        if (Mode == EvalMode::Incremental) {
+            Eval::update(position, undo, accumulators[0], accumulators[1]);
+        }
+        nodes += evalWalk<Mode>(position, depth - 1, accumulators + 1, checksum);
+        position.undoMove(undo);
+    }
+    return nodes;
+}
+
+// Times the walk without evaluation, then with full and incremental
+// evaluation; the difference is the evaluation's cost
+void printEvalCost(Position position, int depth)
+{
+    std::vector<Eval::Accumulator> accumulators(static_cast<size_t>(depth) + 1);
+    Eval::refresh(position, accumulators[0]);
+    
+    auto timeWalk = [&](auto walk, std::int64_t& checksum) {
+        auto startTime = std::chrono::steady_clock::now();
+        std::uint64_t nodes = walk(position, depth, accumulators.data(), checksum);
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - startTime;
+        return std::make_pair(nodes, elapsed.count());
+    };
+    
+    std::int64_t unused = 0;
+    std::int64_t fullChecksum = 0;
+    std::int64_t incrementalChecksum = 0;
+    auto none = timeWalk(evalWalk<EvalMode::None>, unused);
+    auto full = timeWalk(evalWalk<EvalMode::Full>, fullChecksum);
+    auto incremental = timeWalk(evalWalk<EvalMode::Incremental>, incrementalChecksum);
+    
+    const double nodes = static_cast<double>(none.first);
+    auto nsPerNode = [nodes, &none](double seconds) {
+        return nodes > 0 ? std::max(seconds - none.second, 0.0) * 1e9 / nodes : 0.0;
+    };
+    
+    std::printf("depth %d  nodes %llu  simd %s\n", depth, static_cast<unsigned long long>(none.first), Eval::simdName());
+    std::printf("walk only    %8.3f s\n", none.second);
+    std::printf("full         %8.3f s  %6.1f ns/node eval\n", full.second, nsPerNode(full.second));
+    std::printf("incremental  %8.3f s  %6.1f ns/node eval\n", incremental.second, nsPerNode(incremental.second));
+    std::printf("checksums %s\n", fullChecksum == incrementalChecksum ? "match" : "DIFFER");
+}
+
+// The move, list and undo types perft needs from each kind of position
+template <class PositionType>
+struct PerftTypes {
+    using MoveType = typename PositionType::Move;
+    using MoveListType = typename PositionType::MoveList;
+    using UndoType = typename PositionType::UndoRecord;
+};
+
+template <>
+struct PerftTypes<Position> {
+    using MoveType = Move;
+    using MoveListType = MoveList;
+    using UndoType = UndoRecord;
+};
+
+template <class PositionType>
+std::vector<RootResult<typename PerftTypes<PositionType>::MoveType>> perftRoots(const PositionType& root,
+                                                                               int depth, int threadCount)
+{
+    using Types = PerftTypes<PositionType>;
+    
+    typename Types::MoveListType moves;
+    root.generateMoves(moves);
+    
+    std::vector<RootResult<typename Types::MoveType>> results(static_cast<size_t>(moves.size()));
+    std::atomic<int> next{0};
+    
+    // Each thread pulls the next unclaimed root move until none are left
+    auto worker = [&]() {
+        PositionType position = root;
+        
+        for (int i = next++; i < moves.size(); i = next++) {
+            std::uint64_t before = t_allocations;
+            typename Types::UndoType undo;
+            position.doMove(moves[i], undo);
+            std::uint64_t nodes = position.perft(depth - 1);
+            position.undoMove(undo);
+            results[static_cast<size_t>(i)] = {moves[i], nodes, t_allocations - before};
+        }
+    };
+    
+    std::vector<std::thread> threads;
+    for (int i = 1; i < threadCount; ++i) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    
+    return results;
+}
+
+template <class PositionType>
+void printPerft(const PositionType& position, int depth, int threadCount, bool divide)
+{
+    auto startTime = std::chrono::steady_clock::now();
+    auto results = perftRoots(position, depth, threadCount);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - startTime;
+    
+    std::uint64_t nodes = 0;
+    std::uint64_t allocations = 0;
+    for (const auto& result : results) {
+        if (divide) {
+            printMove(result.move);
+            std::printf(": %llu\n", static_cast<unsigned long long>(result.nodes));
+        }
+        nodes += result.nodes;
+        allocations += result.allocations;
+    }
+    
+    double seconds = elapsed.count();
+    std::printf("depth %d  nodes %llu  time %.3f s  %.0f nodes/s  threads %d  allocations %llu\n",
+                depth,
+                static_cast<unsigned long long>(nodes),
+                seconds,
+                seconds > 0 ? static_cast<double>(nodes) / seconds : 0.0,
+                threadCount,
+                static_cast<unsigned long long>(allocations));
+}
+
+// perft/divide for a rules variant, from its own start position or fen
+template <class Rules>
+int printVariantPerft(const char* fen, int depth, int threadCount, bool divide)
+{
+    Variants::Position<Rules> position;
+    if (fen && !position.fromFen(fen)) {
+        std::fprintf(stderr, "Invalid FEN position: %s\n", fen);
+        return 1;
+    }
+    printPerft(position, depth, threadCount, divide);
+    return 0;
+}
+
+} // namespace
+
+void* operator new(std::size_t size)
+{
+    ++t_allocations;
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 3) {
+        printUsage();
+        return 1;
+    }
+    
+    const bool divide = std::strcmp(argv[1], "divide") == 0;
+    const bool search = std::strcmp(argv[1], "search") == 0;
+    const bool scaling = std::strcmp(argv[1], "scaling") == 0;
+    const bool eval = std::strcmp(argv[1], "eval") == 0;
+    if (!divide && !search && !scaling && !eval && std::strcmp(argv[1], "perft") != 0) {
+        printUsage();
+        return 1;
+    }
+    
+    const int depth = std::atoi(argv[2]);
+    if (depth < 1) {
+        std::fprintf(stderr, "Depth must be at least 1\n");
+        return 1;
+    }
+    
+    Position position;
+    const char* fen = nullptr;
+    bool useVariant = false;
+    Variants::Variant variant = Variants::Variant::American;
+    int threadCount = static_cast<int>(std::thread::hardware_concurrency());
+    int moveTimeMs = 0;
+    std::size_t hashMegabytes = 64;
+    Tablebase tablebase;
+    
+    for (int i = 3; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--position") == 0 && i + 1 < argc) {
+            fen = argv[++i];
+        } else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            threadCount = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--movetime") == 0 && i + 1 < argc) {
+            moveTimeMs = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--hash") == 0 && i + 1 < argc) {
+            hashMegabytes = static_cast<std::size_t>(std::max(std::atoi(argv[++i]), 1));
+        } else if (std::strcmp(argv[i], "--tablebase") == 0 && i + 1 < argc) {
+            if (tablebase.load(argv[++i]) == 0) {
+                std::fprintf(stderr, "No tablebase files in %s\n", argv[i]);
+                return 1;
+            }
+        } else if (std::strcmp(argv[i], "--variant") == 0 && i + 1 < argc) {
+            if (!Variants::parseVariant(argv[++i], variant)) {
+                std::fprintf(stderr, "Unknown variant: %s\n", argv[i]);
+                return 1;
+            }
+            useVariant = true;
+        } else {
+            printUsage();
+            return 1;
+        }
+    }
+    
+    if (threadCount < 1) {
+        threadCount = 1;
+    }
+    
+    // The engine only plays American checkers; the variants have perft alone
+    if (useVariant) {
+        if (search || scaling || eval) {
+            std::fprintf(stderr, "--variant only works with perft and divide\n");
+            return 1;
+        }
+        switch (variant) {
+            case Variants::Variant::American:
+                return printVariantPerft<Variants::American>(fen, depth, threadCount, divide);
+            case Variants::Variant::Russian:
+                return printVariantPerft<Variants::Russian>(fen, depth, threadCount, divide);
+            case Variants::Variant::Brazilian:
+                return printVariantPerft<Variants::Brazilian>(fen, depth, threadCount, divide);
+            case Variants::Variant::International:
+                return printVariantPerft<Variants::International>(fen, depth, threadCount, divide);
+        }
+    }
+    
+    if (fen && !position.fromFen(fen)) {
+        std::fprintf(stderr, "Invalid FEN position: %s\n", fen);
+        return 1;
+    }
+    
+    if (scaling) {
+        printScaling(position, depth, threadCount, hashMegabytes);
+        return 0;
+    }
+    
+    if (eval) {
+        printEvalCost(position, depth);
+        return 0;
+    }
+    
+    if (search) {
+        SearchLimits limits;
+        limits.maxDepth = depth;
+        limits.moveTimeMs = moveTimeMs;
+        
+        ParallelSearch parallelSearch(threadCount, hashMegabytes);
+        if (tablebase.sliceCount() > 0) {
+            parallelSearch.setTablebase(&tablebase);
+        }
+        SearchInfo info = parallelSearch.search(position, limits, printSearchInfo);
+        std::printf("bestmove ");
+        printMove(info.bestMove);
+        std::printf("  nodes %llu  time %lld ms  %llu nodes/s  tablebase hits %llu\n",
+                    static_cast<unsigned long long>(info.nodes),
+                    static_cast<long long>(info.timeMs),
+                    static_cast<unsigned long long>(info.nodesPerSecond()),
+                    static_cast<unsigned long long>(info.tablebaseHits));
+        return 0;
+    }
+    
+    printPerft(position, depth, threadCount, divide);
+    return 0;
+}
@@ -0,0 +1,168 @@
+#ifndef BITBOARD_H
+#define BITBOARD_H
+
+#include <cstdint>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// 32-square bitboards for the playable (dark) squares of the 8x8 board.
+//
+// Square index = row * 4 + col / 2, with row 0 at the top (Black's home
+// rows) and only squares where (row + col) is odd counted. Even rows hold
+// their squares in columns 1, 3, 5, 7 and odd rows in columns 0, 2, 4, 6,
+// so a diagonal step is a shift by 3, 4 or 5 depending on row parity.
+namespace Bitboard {
+
+using Mask = std::uint32_t;
+
+constexpr int SQUARES = 32;
+
+constexpr Mask EVEN_ROWS  = 0x0F0F0F0Fu;
+constexpr Mask ODD_ROWS   = 0xF0F0F0F0u;
+constexpr Mask LEFT_EDGE  = 0x11111111u; // First square of each row
+constexpr Mask RIGHT_EDGE = 0x88888888u; // Last square of each row
+constexpr Mask TOP_ROW    = 0x0000000Fu; // Red crowns here
+constexpr Mask BOTTOM_ROW = 0xF0000000u; // Black crowns here
+
+enum class Direction : int {
+    UpLeft = 0,
+    UpRight = 1,
+    DownLeft = 2,
+    DownRight = 3
+};
+
+constexpr Mask bit(int square) { return Mask(1) << square; }
+
+// Returns -1 for light squares and positions off the board
+constexpr int squareIndex(int row, int col)
+{
+    if (row < 0 || row >= 8 || col < 0 || col >= 8 || (row + col) % 2 == 0) {
+        return -1;
+    }
+    return row * 4 + col / 2;
+}
+
+constexpr int squareRow(int square) { return square >> 2; }
+constexpr int squareCol(int square) { return ((square & 3) << 1) + (((square >> 2) & 1) ^ 1); }
+
+// One diagonal step for every set bit; squares stepping off the board vanish
+constexpr Mask upLeft(Mask m)    { return ((m & EVEN_ROWS) >> 4) | ((m & ODD_ROWS & ~LEFT_EDGE) >> 5); }
+constexpr Mask upRight(Mask m)   { return ((m & EVEN_ROWS & ~RIGHT_EDGE) >> 3) | ((m & ODD_ROWS) >> 4); }
+constexpr Mask downLeft(Mask m)  { return ((m & EVEN_ROWS) << 4) | ((m & ODD_ROWS & ~LEFT_EDGE) << 3); }
+constexpr Mask downRight(Mask m) { return ((m & EVEN_ROWS & ~RIGHT_EDGE) << 5) | ((m & ODD_ROWS) << 4); }
+
+constexpr Mask shift(Mask m, Direction dir)
+{
+    switch (dir) {
+        case Direction::UpLeft:    return upLeft(m);
+        case Direction::UpRight:   return upRight(m);
+        case Direction::DownLeft:  return downLeft(m);
+        case Direction::DownRight: return downRight(m);
+    }
+    return 0;
+}
+
+// Movement classes for the geometry tables. A man's directions are a
+// contiguous run of Direction values, so each class is a [first, end) range.
+enum Mover : int {
+    RedMan = 0,
+    BlackMan = 1,
+    King = 2
+};
+
+constexpr int FIRST_DIRECTION[3] = {0, 2, 0};
+constexpr int END_DIRECTION[3]   = {2, 4, 4};
+
+// Per-square neighbours, indexed by Direction, so the move generator does a
+// lookup instead of a shift and edge mask for every step. Squares off the
+// board are an empty mask, which never matches a piece or an empty square.
+struct Geometry {
+    Mask neighbour[SQUARES][4] = {};  // One diagonal step
+    Mask landing[SQUARES][4] = {};    // Two steps: where a jump over neighbour lands
+    Mask steps[3][SQUARES] = {};      // Neighbours each Mover may step to
+};
+
+constexpr Geometry makeGeometry()
+{
+    const int rowStep[4] = {-1, -1, 1, 1};
+    const int colStep[4] = {-1, 1, -1, 1};
+    
+    Geometry geometry;
+    for (int square = 0; square < SQUARES; ++square) {
+        int row = squareRow(square);
+        int col = squareCol(square);
+        for (int dir = 0; dir < 4; ++dir) {
+            int next = squareIndex(row + rowStep[dir], col + colStep[dir]);
+            int land = squareIndex(row + 2 * rowStep[dir], col + 2 * colStep[dir]);
+            geometry.neighbour[square][dir] = next < 0 ? 0 : bit(next);
+            geometry.landing[square][dir] = land < 0 ? 0 : bit(land);
+        }
+        for (int mover = RedMan; mover <= King; ++mover) {
+            for (int dir = FIRST_DIRECTION[mover]; dir < END_DIRECTION[mover]; ++dir) {
+                geometry.steps[mover][square] |= geometry.neighbour[square][dir];
+            }
+        }
+    }
+    return geometry;
+}
+
+inline constexpr Geometry GEOMETRY = makeGeometry();
+
+// The tables and the shift helpers describe the same board
+constexpr bool geometryMatchesShifts()
+{
+    for (int square = 0; square < SQUARES; ++square) {
+        for (int dir = 0; dir < 4; ++dir) {
+            Mask next = shift(bit(square), static_cast<Direction>(dir));
+            if (GEOMETRY.neighbour[square][dir] != next) return false;
+            if (GEOMETRY.landing[square][dir] != shift(next, static_cast<Direction>(dir))) return false;
+        }
+    }
+    return true;
+}
+
+static_assert(geometryMatchesShifts(), "Geometry tables disagree with the shift helpers");
+
+inline int popCount(Mask m)
+{
+#if defined(_MSC_VER)
+    return static_cast<int>(__popcnt(m));
+#else
+    return __builtin_popcount(m);
+#endif
+}
+
+// Index of the lowest set bit; m must be non-zero
+inline int lowestSquare(Mask m)
+{
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, m);
+    return static_cast<int>(index);
+#else
+    return __builtin_ctz(m);
+#endif
+}
+
+inline int popLowestSquare(Mask& m)
+{
+    int square = lowestSquare(m);
+    m &= m - 1;
+    return square;
+}
+
+// Piece placement: one mask per colour plus a mask of which pieces are kings
+struct Board {
+    Mask red = 0;
+    Mask black = 0;
+    Mask kings = 0;
+    
+    Mask occupied() const { return red | black; }
+    Mask empty() const { return ~(red | black); }
+};
+
+} // namespace Bitboard
+
+#endif // BITBOARD_H
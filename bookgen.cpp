@@ -0,0 +1,336 @@
+#include "openingbook.h"
+#include "pdn.h"
+#include "search.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+// Opening book builder.
+//
+//   checkers-bookgen build <book> [options]   Build a book from games and/or self-play
+//   checkers-bookgen probe <book> [options]   List the book moves for a position
+//
+// Options:
+//   --games <file>      Games to learn from, one per line in numeric notation
+//                       ("11-15 23-19 8-11 22-17 ..."). Move numbers, results
+//                       and lines starting with '[' or '#' are skipped. Games
+//                       numbered with the first player on 1-12, as in most
+//                       published games, are mirrored onto this board.
+//   --selfplay <n>      Also play n engine games (default: 0)
+//   --plies <n>         Book depth: moves recorded per game (default: 16)
+//   --random-plies <n>  Self-play moves chosen at random among those scoring
+//                       within --margin of the best (default: 4)
+//   --margin <n>        Score margin for random moves (default: 20)
+//   --depth <n>         Self-play search depth (default: 10)
+//   --min-count <n>     Drop moves played fewer than n times (default: 1)
+//   --threads <n>       Self-play games run in parallel (default: all cores)
+//   --seed <n>          Self-play random seed (default: 1)
+//   --position <fen>    Position to probe (default: the start position)
+
+namespace {
+
+using Record = OpeningBook::Record;
+
+struct Options {
+    std::string gamesPath;
+    int selfPlayGames = 0;
+    int plies = 16;
+    int randomPlies = 4;
+    int margin = 20;
+    int depth = 10;
+    std::uint32_t minCount = 1;
+    int threadCount = 1;
+    std::uint64_t seed = 1;
+    Position position;
+};
+
+void printUsage()
+{
+    std::fprintf(stderr,
+        "Usage: checkers-bookgen build|probe <book> [--games <file>] [--selfplay <n>] [--plies <n>]\n"
+        "                        [--random-plies <n>] [--margin <n>] [--depth <n>] [--min-count <n>] [--threads <n>]\n"
+        "                        [--seed <n>] [--position <fen>]\n");
+}
+
+void printMove(const Move& move)
+{
+    std::printf("%d%c%d", move.from + 1, move.isCapture() ? 'x' : '-', move.to + 1);
+}
+
+// Parses "11-15" or "9x18x27" and finds the legal move it names. Mirrored
+// squares are numbered from the other side of the board.
+bool parseMove(const Position& position, const std::string& token, bool mirrored, Move& move)
+{
+    std::vector<int> squares;
+    if (!Pdn::parseSquares(token, squares)) return false;
+    if (mirrored) {
+        for (int& square : squares) {
+            square = Bitboard::SQUARES + 1 - square;
+        }
+    }
+    return Pdn::findMove(position, squares, move);
+}
+
+// Records the first plies moves of every game in the file
+bool readGames(const Options& options, std::vector<Record>& records, int& games)
+{
+    std::ifstream in(options.gamesPath);
+    if (!in) {
+        std::fprintf(stderr, "Cannot read %s\n", options.gamesPath.c_str());
+        return false;
+    }
+    
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(in, line)) {
+        ++lineNumber;
+        if (line.empty() || line[0] == '[' || line[0] == '#') continue;
+        
+        Position position;
+        std::istringstream tokens(line);
+        std::string token;
+        int ply = 0;
+        bool moved = false;
+        bool mirrored = false;
+        while (ply < options.plies && tokens >> token) {
+            // Move numbers ("12.") and results ("1-0", "1/2-1/2", "*")
+            if (token.back() == '.' || token == "*" || token == "1-0" || token == "0-1"
+                || token == "2-0" || token == "0-2" || token.find('/') != std::string::npos) {
+                continue;
+            }
+            
+            Move move;
+            if (ply == 0 && !parseMove(position, token, false, move)) {
+                mirrored = true;
+            }
+            if (!parseMove(position, token, mirrored, move)) {
+                std::fprintf(stderr, "Line %d: illegal move %s, rest of game skipped\n", lineNumber, token.c_str());
+                break;
+            }
+            records.push_back({position.hash(), move, 1});
+            UndoRecord undo;
+            position.doMove(move, undo);
+            ++ply;
+            moved = true;
+        }
+        if (moved) ++games;
+    }
+    return true;
+}
+
+// Picks at random among the moves whose own search scores within margin of
+// the best one
+Move pickVariedMove(ParallelSearch& search, Position& position, const MoveList& moves,
+                    const Options& options, std::mt19937_64& random)
+{
+    SearchLimits limits;
+    limits.maxDepth = std::max(options.depth - 1, 1);
+    
+    std::vector<int> scores;
+    int best = -Searcher::MATE_SCORE;
+    for (const Move& move : moves) {
+        UndoRecord undo;
+        position.doMove(move, undo);
+        int score = -search.search(position, limits).score;
+        position.undoMove(undo);
+        scores.push_back(score);
+        best = std::max(best, score);
+    }
+    
+    std::vector<Move> candidates;
+    for (int i = 0; i < moves.size(); ++i) {
+        if (scores[static_cast<std::size_t>(i)] >= best - options.margin) {
+            candidates.push_back(moves[i]);
+        }
+    }
+    return candidates[random() % candidates.size()];
+}
+
+// Plays games between two copies of the engine. The first few moves vary
+// at random so the games spread over different openings.
+void playSelfGames(const Options& options, std::vector<Record>& records)
+{
+    std::atomic<int> nextGame{0};
+    std::mutex recordsMutex;
+    
+    auto worker = [&]() {
+        ParallelSearch search(1, 16);
+        SearchLimits limits;
+        limits.maxDepth = options.depth;
+        std::vector<Record> local;
+        
+        for (int game = nextGame++; game < options.selfPlayGames; game = nextGame++) {
+            std::mt19937_64 random(options.seed * 1000003 + static_cast<std::uint64_t>(game));
+            Position position;
+            search.clearHash();
+            
+            for (int ply = 0; ply < options.plies; ++ply) {
+                MoveList moves;
+                position.generateMoves(moves);
+                if (moves.isEmpty()) break;
+                
+                Move move = ply < options.randomPlies
+                          ? pickVariedMove(search, position, moves, options, random)
+                          : search.search(position, limits).bestMove;
+                local.push_back({position.hash(), move, 1});
+                
+                UndoRecord undo;
+                position.doMove(move, undo);
+            }
+        }
+        
+        std::lock_guard<std::mutex> lock(recordsMutex);
+        records.insert(records.end(), local.begin(), local.end());
+    };
+    
+    std::vector<std::thread> threads;
+    for (int i = 1; i < options.threadCount; ++i) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+}
+
+int build(const std::string& path, const Options& options)
+{
+    if (options.gamesPath.empty() && options.selfPlayGames == 0) {
+        std::fprintf(stderr, "Nothing to build from: give --games and/or --selfplay\n");
+        return 1;
+    }
+    
+    auto startTime = std::chrono::steady_clock::now();
+    std::vector<Record> records;
+    
+    int games = 0;
+    if (!options.gamesPath.empty() && !readGames(options, records, games)) {
+        return 1;
+    }
+    playSelfGames(options, records);
+    games += options.selfPlayGames;
+    
+    // Merge here too so rare moves can be dropped before writing
+    std::sort(records.begin(), records.end(), [](const Record& a, const Record& b) {
+        if (a.key != b.key) return a.key < b.key;
+        if (a.move.from != b.move.from) return a.move.from < b.move.from;
+        if (a.move.to != b.move.to) return a.move.to < b.move.to;
+        return a.move.captures < b.move.captures;
+    });
+    std::vector<Record> merged;
+    for (const Record& record : records) {
+        if (!merged.empty() && merged.back().key == record.key && merged.back().move == record.move
+            && merged.back().move.captures == record.move.captures) {
+            merged.back().weight += record.weight;
+        } else {
+            merged.push_back(record);
+        }
+    }
+    merged.erase(std::remove_if(merged.begin(), merged.end(), [&options](const Record& record) {
+        return record.weight < options.minCount;
+    }), merged.end());
+    
+    std::size_t positions = 0;
+    for (std::size_t i = 0; i < merged.size(); ++i) {
+        if (i == 0 || merged[i].key != merged[i - 1].key) ++positions;
+    }
+    
+    if (!OpeningBook::write(path, merged)) {
+        return 1;
+    }
+    
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - startTime;
+    std::printf("%d games  %llu positions  %llu moves  %.1f s\n",
+                games,
+                static_cast<unsigned long long>(positions),
+                static_cast<unsigned long long>(merged.size()),
+                elapsed.count());
+    return 0;
+}
+
+int probe(const std::string& path, const Options& options)
+{
+    auto startTime = std::chrono::steady_clock::now();
+    OpeningBook book;
+    if (!book.load(path)) {
+        std::fprintf(stderr, "Cannot open %s\n", path.c_str());
+        return 1;
+    }
+    std::vector<OpeningBook::BookMove> moves = book.probe(options.position);
+    std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - startTime;
+    
+    for (const OpeningBook::BookMove& bookMove : moves) {
+        printMove(bookMove.move);
+        std::printf("  weight %d\n", bookMove.weight);
+    }
+    std::printf("%llu records  %d book moves  open and probe %.0f us\n",
+                static_cast<unsigned long long>(book.recordCount()),
+                static_cast<int>(moves.size()),
+                elapsed.count());
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    if (argc < 3) {
+        printUsage();
+        return 1;
+    }
+    
+    const bool building = std::strcmp(argv[1], "build") == 0;
+    if (!building && std::strcmp(argv[1], "probe") != 0) {
+        printUsage();
+        return 1;
+    }
+    
+    std::string path = argv[2];
+    Options options;
+    options.threadCount = static_cast<int>(std::thread::hardware_concurrency());
+    
+    for (int i = 3; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--games") == 0 && i + 1 < argc) {
+            options.gamesPath = argv[++i];
+        } else if (std::strcmp(argv[i], "--selfplay") == 0 && i + 1 < argc) {
+            options.selfPlayGames = std::max(std::atoi(argv[++i]), 0);
+        } else if (std::strcmp(argv[i], "--plies") == 0 && i + 1 < argc) {
+            options.plies = std::max(std::atoi(argv[++i]), 1);
+        } else if (std::strcmp(argv[i], "--random-plies") == 0 && i + 1 < argc) {
+            options.randomPlies = std::max(std::atoi(argv[++i]), 0);
+        } else if (std::strcmp(argv[i], "--margin") == 0 && i + 1 < argc) {
+            options.margin = std::max(std::atoi(argv[++i]), 0);
+        } else if (std::strcmp(argv[i], "--depth") == 0 && i + 1 < argc) {
+            options.depth = std::max(std::atoi(argv[++i]), 1);
+        } else if (std::strcmp(argv[i], "--min-count") == 0 && i + 1 < argc) {
+            options.minCount = static_cast<std::uint32_t>(std::max(std::atoi(argv[++i]), 1));
+        } else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            options.threadCount = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            options.seed = std::strtoull(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--position") == 0 && i + 1 < argc) {
+            if (!options.position.fromFen(argv[++i])) {
+                std::fprintf(stderr, "Invalid FEN position: %s\n", argv[i]);
+                return 1;
+            }
+        } else {
+            printUsage();
+            return 1;
+        }
+    }
+    
+    if (options.threadCount < 1) {
+        options.threadCount = 1;
+    }
+    
+    return building ? build(path, options) : probe(path, options);
+}
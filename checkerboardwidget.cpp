@@ -21,6 +21,8 @@ void CheckerBoardWidget::setGame(CheckersGame* game)
     
     if (m_game) {
         connect(m_game, &CheckersGame::boardChanged, this, [this]() {
+            m_bookMoves.clear();
+            m_hasAnalysis = false;
             clearHighlights();
             update();
         });
@@ -61,7 +63,7 @@ void CheckerBoardWidget::clearHighlights()
     update();
 }
 
-void CheckerBoardWidget::highlightValidMoves(const QVector<Move>& moves)
+void CheckerBoardWidget::highlightValidMoves(const MoveList& moves)
 {
     m_validMoves = moves;
     update();
@@ -73,6 +75,25 @@ void CheckerBoardWidget::highlightMovablePieces(const QVector<QPoint>& pieces)
     update();
 }
 
+void CheckerBoardWidget::setBookMoves(const MoveList& moves)
+{
+    m_bookMoves = moves;
+    update();
+}
+
+void CheckerBoardWidget::setAnalysis(const SearchInfo& info)
+{
+    m_analysis = info;
+    m_hasAnalysis = true;
+    update();
+}
+
+void CheckerBoardWidget::clearAnalysis()
+{
+    m_hasAnalysis = false;
+    update();
+}
+
 int CheckerBoardWidget::squareSize() const
 {
     int availableSize = qMin(width(), height()) - 2 * m_boardMargin;
@@ -141,6 +162,8 @@ void CheckerBoardWidget::paintEvent(QPaintEvent* event)
     drawBoard(painter);
     drawHighlights(painter);
     drawPieces(painter);
+    drawBookMoves(painter);
+    drawAnalysis(painter);
     drawDraggedPiece(painter);
 }
 
@@ -184,7 +207,7 @@ void CheckerBoardWidget::drawHighlights(QPainter& painter)
     
     // Highlight valid move destinations
     for (const Move& move : m_validMoves) {
-        QRect rect = squareRect(move.to);
+        QRect rect = squareRect(CheckersGame::squareToPoint(move.to));
         painter.fillRect(rect, m_validMoveColor);
         
         // Draw a circle indicator
@@ -195,6 +218,70 @@ void CheckerBoardWidget::drawHighlights(QPainter& painter)
     }
 }
 
+void CheckerBoardWidget::drawArrow(QPainter& painter, const Move& move, const QColor& color, int width)
+{
+    int size = squareSize();
+    painter.setPen(QPen(color, width, Qt::SolidLine, Qt::RoundCap));
+    painter.setBrush(color);
+    
+    QPointF from = squareRect(CheckersGame::squareToPoint(move.from)).center();
+    QPointF to = squareRect(CheckersGame::squareToPoint(move.to)).center();
+    painter.drawLine(from, to);
+    
+    // Arrow head
+    QLineF back(to, from);
+    QLineF left = QLineF::fromPolar(size / 4.0, back.angle() + 30).translated(to);
+    QLineF right = QLineF::fromPolar(size / 4.0, back.angle() - 30).translated(to);
+    painter.drawPolygon(QPolygonF({to, left.p2(), right.p2()}));
+}
+
+void CheckerBoardWidget::drawBookMoves(QPainter& painter)
+{
+    for (const Move& move : m_bookMoves) {
+        drawArrow(painter, move, m_bookMoveColor, qMax(2, squareSize() / 12));
+    }
+}
+
+void CheckerBoardWidget::drawAnalysis(QPainter& painter)
+{
+    if (!m_hasAnalysis || !m_game) return;
+    
+    // The reply first, so the best move's arrow is on top
+    int size = squareSize();
+    if (m_analysis.pv.size() >= 2) {
+        drawArrow(painter, m_analysis.pv[1], m_hintReplyColor, qMax(1, size / 20));
+    }
+    if (m_analysis.bestMove.isValid()) {
+        drawArrow(painter, m_analysis.bestMove, m_hintMoveColor, qMax(2, size / 10));
+    }
+    
+    // Score for the side to move, in men
+    PlayerColor side = m_game->currentPlayer();
+    QString sideName = (side == PlayerColor::Red) ? tr("Red") : tr("Black");
+    QString text;
+    if (!m_analysis.bestMove.isValid()) {
+        text = tr("%1 has no moves").arg(sideName);
+    } else if (m_analysis.score > Searcher::MATE_BOUND) {
+        text = tr("%1 wins in %2 plies").arg(sideName).arg(Searcher::MATE_SCORE - m_analysis.score);
+    } else if (m_analysis.score < -Searcher::MATE_BOUND) {
+        text = tr("%1 loses in %2 plies").arg(sideName).arg(Searcher::MATE_SCORE + m_analysis.score);
+    } else {
+        text = tr("%1 %2%3").arg(sideName, m_analysis.score >= 0 ? QStringLiteral("+") : QString())
+                   .arg(m_analysis.score / 100.0, 0, 'f', 2);
+    }
+    text += tr("  depth %1").arg(m_analysis.depth);
+    
+    QRect board = squareRect(QPoint(0, 0)).united(squareRect(QPoint(CheckersGame::BOARD_SIZE - 1,
+                                                                    CheckersGame::BOARD_SIZE - 1)));
+    QRect label = painter.fontMetrics().boundingRect(text).adjusted(-6, -3, 6, 3);
+    label.moveTopLeft(board.topLeft() + QPoint(4, 4));
+    painter.setPen(Qt::NoPen);
+    painter.setBrush(QColor(0, 0, 0, 150));
+    painter.drawRoundedRect(label, 4, 4);
+    painter.setPen(Qt::white);
+    painter.drawText(label, Qt::AlignCenter, text);
+}
+
 void CheckerBoardWidget::drawPieces(QPainter& painter)
 {
     if (!m_game) return;
@@ -314,7 +401,7 @@ void CheckerBoardWidget::mousePressEvent(QMouseEvent* event)
     // Check if clicking on own piece
     if (m_game->isPlayerPiece(boardPos, m_localColor)) {
         // Check if this piece can move
-        QVector<Move> moves = m_game->getValidMoves(boardPos);
+        MoveList moves = m_game->getValidMoves(boardPos);
         
         // Only allow selecting pieces that can actually move
         QVector<QPoint> movable = m_game->getAllMovablePieces(m_localColor);
@@ -333,8 +420,9 @@ void CheckerBoardWidget::mousePressEvent(QMouseEvent* event)
     }
     // Check if clicking on valid move destination
     else if (m_selectedSquare.x() >= 0) {
+        int target = CheckersGame::pointToSquare(boardPos);
         for (const Move& move : m_validMoves) {
-            if (move.to == boardPos) {
+            if (move.to == target) {
                 emit moveRequested(move);
                 clearHighlights();
                 return;
@@ -354,8 +442,9 @@ void CheckerBoardWidget::mouseReleaseEvent(QMouseEvent* event)
     
     // Check if releasing on valid destination
     if (boardPos.x() >= 0) {
+        int target = CheckersGame::pointToSquare(boardPos);
         for (const Move& move : m_validMoves) {
-            if (move.to == boardPos) {
+            if (move.to == target) {
                 emit moveRequested(move);
                 clearHighlights();
                 return;
@@ -5,6 +5,7 @@
 #include <QPoint>
 #include <QVector>
 #include "checkersgame.h"
+#include "search.h"
 
 class CheckerBoardWidget : public QWidget
 {
@@ -20,9 +21,17 @@ public:
     
     // Highlight valid moves
     void clearHighlights();
-    void highlightValidMoves(const QVector<Move>& moves);
+    void highlightValidMoves(const MoveList& moves);
     void highlightMovablePieces(const QVector<QPoint>& pieces);
     
+    // Opening book suggestions, drawn as arrows until the board changes
+    void setBookMoves(const MoveList& moves);
+    
+    // Hint analysis of the current position: the best move and the reply
+    // expected to it as arrows, and the score, until the board changes
+    void setAnalysis(const SearchInfo& info);
+    void clearAnalysis();
+    
 signals:
     void squareClicked(const QPoint& pos);
     void moveRequested(const Move& move);
@@ -39,6 +48,9 @@ private:
     void drawBoard(QPainter& painter);
     void drawPieces(QPainter& painter);
     void drawHighlights(QPainter& painter);
+    void drawBookMoves(QPainter& painter);
+    void drawAnalysis(QPainter& painter);
+    void drawArrow(QPainter& painter, const Move& move, const QColor& color, int width);
     void drawDraggedPiece(QPainter& painter);
     void drawPiece(QPainter& painter, const QRect& rect, Piece piece, bool isGhost = false);
     
@@ -57,8 +69,11 @@ private:
     
     // Selection state
     QPoint m_selectedSquare{-1, -1};
-    QVector<Move> m_validMoves;
+    MoveList m_validMoves;
     QVector<QPoint> m_movablePieces;
+    MoveList m_bookMoves;
+    SearchInfo m_analysis;
+    bool m_hasAnalysis = false;
     
     // Drag state
     bool m_dragging = false;
@@ -72,6 +87,9 @@ private:
     QColor m_highlightColor{255, 255, 0, 100};
     QColor m_selectedColor{0, 255, 0, 150};
     QColor m_validMoveColor{0, 200, 0, 100};
+    QColor m_bookMoveColor{30, 90, 220, 160};
+    QColor m_hintMoveColor{20, 170, 60, 190};
+    QColor m_hintReplyColor{220, 120, 20, 130};
     QColor m_redPieceColor{200, 50, 50};
     QColor m_blackPieceColor{40, 40, 40};
     QColor m_kingMarkerColor{255, 215, 0};
@@ -1,84 +1,82 @@
 #include "checkersgame.h"
+#include "packed.h"
+#include "pdn.h"
 #include <QDataStream>
-#include <QIODevice>
 
-CheckersGame::CheckersGame(QObject *parent)
-    : QObject(parent)
-    , m_currentPlayer(PlayerColor::Red)
-    , m_winner(PlayerColor::None)
-{
-    resetGame();
-}
+using Bitboard::Mask;
 
-void CheckersGame::resetGame()
-{
-    m_currentPlayer = PlayerColor::Red; // Red goes first
-    m_winner = PlayerColor::None;
-    initializeBoard();
-    emit boardChanged();
-    emit turnChanged(m_currentPlayer);
-}
+namespace {
+
+// What serialize wrote before Packed: a QDataStream of 64 piece codes, row
+// by row from the top, then the side to move and the winner
+constexpr int LEGACY_STATE_SIZE = (64 + 2) * 4;
 
-void CheckersGame::initializeBoard()
+bool deserializeLegacy(const QByteArray& data, Position& position, PlayerColor& winner)
 {
-    // Clear board
-    for (int row = 0; row < BOARD_SIZE; ++row) {
-        for (int col = 0; col < BOARD_SIZE; ++col) {
-            m_board[row][col] = Piece::Empty;
-        }
-    }
+    if (data.size() != LEGACY_STATE_SIZE) return false;
+    
+    QDataStream stream(data);
+    stream.setVersion(QDataStream::Qt_5_15);
     
-    // Place black pieces (top 3 rows)
-    for (int row = 0; row < 3; ++row) {
-        for (int col = 0; col < BOARD_SIZE; ++col) {
-            // Only on dark squares (where row + col is odd)
-            if ((row + col) % 2 == 1) {
-                m_board[row][col] = Piece::Black;
+    // Light squares can never hold a piece
+    position.clear();
+    for (int row = 0; row < CheckersGame::BOARD_SIZE; ++row) {
+        for (int col = 0; col < CheckersGame::BOARD_SIZE; ++col) {
+            int piece;
+            stream >> piece;
+            if (piece < 0 || piece > static_cast<int>(Piece::BlackKing)) return false;
+            int square = Bitboard::squareIndex(row, col);
+            if (square >= 0) {
+                position.setPiece(square, static_cast<Piece>(piece));
             }
         }
     }
     
-    // Place red pieces (bottom 3 rows)
-    for (int row = 5; row < BOARD_SIZE; ++row) {
-        for (int col = 0; col < BOARD_SIZE; ++col) {
-            // Only on dark squares
-            if ((row + col) % 2 == 1) {
-                m_board[row][col] = Piece::Red;
-            }
-        }
+    int currentPlayer, winnerCode;
+    stream >> currentPlayer >> winnerCode;
+    if (currentPlayer != static_cast<int>(PlayerColor::Red) && currentPlayer != static_cast<int>(PlayerColor::Black)) {
+        return false;
     }
+    if (winnerCode < 0 || winnerCode > static_cast<int>(PlayerColor::Black)) return false;
+    
+    position.setSideToMove(static_cast<PlayerColor>(currentPlayer));
+    winner = static_cast<PlayerColor>(winnerCode);
+    return true;
 }
 
-Piece CheckersGame::pieceAt(int row, int col) const
+} // namespace
+
+CheckersGame::CheckersGame(QObject *parent)
+    : QObject(parent)
+    , m_winner(PlayerColor::None)
 {
-    if (row < 0 || row >= BOARD_SIZE || col < 0 || col >= BOARD_SIZE) {
-        return Piece::Empty;
-    }
-    return m_board[row][col];
+    resetGame();
 }
 
-Piece CheckersGame::pieceAt(const QPoint& pos) const
+void CheckersGame::resetGame()
 {
-    return pieceAt(pos.y(), pos.x());
+    m_position.reset(); // Red goes first
+    m_startPosition = m_position;
+    m_history.clear();
+    m_winner = PlayerColor::None;
+    m_legalMovesValid = false;
+    ++m_stateSequence;
+    emit boardChanged();
+    emit turnChanged(m_position.sideToMove());
 }
 
-PlayerColor CheckersGame::pieceOwner(Piece piece)
+Piece CheckersGame::pieceAt(int row, int col) const
 {
-    switch (piece) {
-        case Piece::Red:
-        case Piece::RedKing:
-            return PlayerColor::Red;
-        case Piece::Black:
-        case Piece::BlackKing:
-            return PlayerColor::Black;
-        default:
-            return PlayerColor::None;
+    int square = Bitboard::squareIndex(row, col);
+    if (square < 0) {
+        return Piece::Empty;
     }
+    return m_position.pieceOn(square);
 }
 
-bool CheckersGame::isKing(Piece piece)
+Piece CheckersGame::pieceAt(const QPoint& pos) const
 {
-    return piece == Piece::RedKing || piece == Piece::BlackKing;
+    return pieceAt(pos.y(), pos.x());
 }
 
 bool CheckersGame::isPlayerPiece(const QPoint& pos, PlayerColor player) const
@@ -86,367 +84,287 @@ bool CheckersGame::isPlayerPiece(const QPoint& pos, PlayerColor player) const
     return pieceOwner(pieceAt(pos)) == player;
 }
 
-bool CheckersGame::isValidPosition(const QPoint& pos) const
+QPoint CheckersGame::squareToPoint(int square)
 {
-    return pos.x() >= 0 && pos.x() < BOARD_SIZE && 
-           pos.y() >= 0 && pos.y() < BOARD_SIZE;
+    return QPoint(Bitboard::squareCol(square), Bitboard::squareRow(square));
 }
 
-bool CheckersGame::isEmpty(const QPoint& pos) const
+int CheckersGame::pointToSquare(const QPoint& pos)
 {
-    return isValidPosition(pos) && pieceAt(pos) == Piece::Empty;
-}
-
-bool CheckersGame::isOpponent(const QPoint& pos, PlayerColor player) const
-{
-    if (!isValidPosition(pos)) return false;
-    PlayerColor owner = pieceOwner(pieceAt(pos));
-    return owner != PlayerColor::None && owner != player;
+    return Bitboard::squareIndex(pos.y(), pos.x());
 }
 
 QVector<QPoint> CheckersGame::getAllMovablePieces(PlayerColor player) const
 {
     QVector<QPoint> movable;
-    bool mustCapture = playerHasCapture(player);
+    Mask pieces = 0;
     
-    for (int row = 0; row < BOARD_SIZE; ++row) {
-        for (int col = 0; col < BOARD_SIZE; ++col) {
-            QPoint pos(col, row);
-            if (isPlayerPiece(pos, player)) {
-                QVector<Move> moves = getValidMoves(pos);
-                if (!moves.isEmpty()) {
-                    // If there's a capture available, only show pieces that can capture
-                    if (mustCapture) {
-                        for (const Move& m : moves) {
-                            if (!m.captures.isEmpty()) {
-                                movable.append(pos);
-                                break;
-                            }
-                        }
-                    } else {
-                        movable.append(pos);
-                    }
-                }
-            }
+    if (player == m_position.sideToMove()) {
+        for (const Move& move : legalMoves()) {
+            pieces |= Bitboard::bit(move.from);
         }
+    } else {
+        pieces = m_position.movablePieces(player);
     }
     
-    return movable;
-}
-
-bool CheckersGame::playerHasCapture(PlayerColor player) const
-{
-    for (int row = 0; row < BOARD_SIZE; ++row) {
-        for (int col = 0; col < BOARD_SIZE; ++col) {
-            QPoint pos(col, row);
-            if (isPlayerPiece(pos, player) && canCapture(pos, player)) {
-                return true;
-            }
-        }
-    }
-    return false;
-}
-
-bool CheckersGame::canCapture(const QPoint& from, PlayerColor player) const
-{
-    Piece piece = pieceAt(from);
-    bool isK = isKing(piece);
-    
-    // Direction vectors for diagonal moves
-    QVector<QPoint> directions;
-    
-    if (player == PlayerColor::Red || isK) {
-        directions.append(QPoint(-1, -1)); // Up-left
-        directions.append(QPoint(1, -1));  // Up-right
-    }
-    if (player == PlayerColor::Black || isK) {
-        directions.append(QPoint(-1, 1));  // Down-left
-        directions.append(QPoint(1, 1));   // Down-right
-    }
-    
-    for (const QPoint& dir : directions) {
-        QPoint mid = from + dir;
-        QPoint to = from + dir * 2;
-        
-        if (isOpponent(mid, player) && isEmpty(to)) {
-            return true;
-        }
+    while (pieces) {
+        movable.append(squareToPoint(Bitboard::popLowestSquare(pieces)));
     }
     
-    return false;
+    return movable;
 }
 
-QVector<Move> CheckersGame::getValidMoves(const QPoint& from) const
+MoveList CheckersGame::getValidMoves(const QPoint& from) const
 {
-    if (!isValidPosition(from)) return {};
-    
-    Piece piece = pieceAt(from);
-    PlayerColor owner = pieceOwner(piece);
+    MoveList moves;
+    int square = pointToSquare(from);
     
-    if (owner == PlayerColor::None) return {};
+    if (square < 0) return moves;
     
-    // If the current player has any capture available, they must capture
-    bool mustCapture = playerHasCapture(owner);
+    PlayerColor owner = pieceOwner(pieceAt(from));
     
-    QVector<Move> captures = getCaptureMoves(from);
+    if (owner == PlayerColor::None) return moves;
     
-    if (mustCapture) {
-        return captures; // Must return only capture moves
-    }
-    
-    if (!captures.isEmpty()) {
-        return captures; // Prefer captures
-    }
-    
-    return getSimpleMoves(from);
-}
-
-QVector<Move> CheckersGame::getSimpleMoves(const QPoint& from) const
-{
-    QVector<Move> moves;
-    Piece piece = pieceAt(from);
-    PlayerColor owner = pieceOwner(piece);
-    bool isK = isKing(piece);
-    
-    QVector<QPoint> directions;
-    
-    // Red moves up (negative y), Black moves down (positive y)
-    if (owner == PlayerColor::Red || isK) {
-        directions.append(QPoint(-1, -1));
-        directions.append(QPoint(1, -1));
-    }
-    if (owner == PlayerColor::Black || isK) {
-        directions.append(QPoint(-1, 1));
-        directions.append(QPoint(1, 1));
-    }
-    
-    for (const QPoint& dir : directions) {
-        QPoint to = from + dir;
-        if (isEmpty(to)) {
-            moves.append({from, to, {}});
+    if (owner == m_position.sideToMove()) {
+        for (const Move& move : legalMoves()) {
+            if (move.from == square) {
+                moves.append(move);
+            }
         }
+    } else {
+        m_position.generateMoves(owner, Bitboard::bit(square), moves);
     }
-    
     return moves;
 }
 
-QVector<Move> CheckersGame::getCaptureMoves(const QPoint& from) const
+const MoveList& CheckersGame::legalMoves() const
 {
-    QVector<Move> moves;
-    Piece piece = pieceAt(from);
-    
-    if (piece == Piece::Empty) return moves;
-    
-    // Create a temporary board for multi-jump calculations
-    Piece tempBoard[BOARD_SIZE][BOARD_SIZE];
-    for (int r = 0; r < BOARD_SIZE; ++r) {
-        for (int c = 0; c < BOARD_SIZE; ++c) {
-            tempBoard[r][c] = m_board[r][c];
-        }
+    if (!m_legalMovesValid) {
+        m_position.generateMoves(m_legalMoves);
+        m_legalMovesValid = true;
     }
-    
-    QVector<QPoint> captured;
-    findMultiJumps(from, from, piece, captured, moves, tempBoard);
-    
-    return moves;
+    return m_legalMoves;
 }
 
-void CheckersGame::findMultiJumps(const QPoint& current, const QPoint& original,
-                                   Piece piece, QVector<QPoint>& captured,
-                                   QVector<Move>& moves, 
-                                   Piece tempBoard[BOARD_SIZE][BOARD_SIZE]) const
+const Move* CheckersGame::findLegalMove(const Move& move) const
 {
-    PlayerColor owner = pieceOwner(piece);
-    bool isK = isKing(piece);
-    
-    QVector<QPoint> directions;
-    
-    if (owner == PlayerColor::Red || isK) {
-        directions.append(QPoint(-1, -1));
-        directions.append(QPoint(1, -1));
-    }
-    if (owner == PlayerColor::Black || isK) {
-        directions.append(QPoint(-1, 1));
-        directions.append(QPoint(1, 1));
-    }
+    if (!move.isValid()) return nullptr;
     
-    bool foundJump = false;
-    
-    for (const QPoint& dir : directions) {
-        QPoint mid = current + dir;
-        QPoint to = current + dir * 2;
-        
-        if (!isValidPosition(to)) continue;
-        
-        Piece midPiece = tempBoard[mid.y()][mid.x()];
-        Piece toPiece = tempBoard[to.y()][to.x()];
-        
-        // Check if we can jump over an opponent piece to an empty square
-        if (pieceOwner(midPiece) != PlayerColor::None && 
-            pieceOwner(midPiece) != owner && 
-            toPiece == Piece::Empty) {
-            
-            foundJump = true;
-            
-            // Temporarily make the jump
-            tempBoard[current.y()][current.x()] = Piece::Empty;
-            tempBoard[mid.y()][mid.x()] = Piece::Empty;
-            tempBoard[to.y()][to.x()] = piece;
-            
-            captured.append(mid);
-            
-            // Recursively find more jumps
-            findMultiJumps(to, original, piece, captured, moves, tempBoard);
-            
-            // Undo the jump
-            captured.removeLast();
-            tempBoard[current.y()][current.x()] = piece;
-            tempBoard[mid.y()][mid.x()] = midPiece;
-            tempBoard[to.y()][to.x()] = Piece::Empty;
+    for (const Move& legal : legalMoves()) {
+        if (legal.from == move.from && legal.to == move.to) {
+            return &legal;
         }
     }
-    
-    // If no more jumps found and we've made at least one capture, record the move
-    if (!foundJump && !captured.isEmpty()) {
-        moves.append({original, current, captured});
-    }
+    return nullptr;
 }
 
 bool CheckersGame::isValidMove(const Move& move) const
 {
-    if (!move.isValid()) return false;
-    
-    QVector<Move> validMoves = getValidMoves(move.from);
-    
-    for (const Move& valid : validMoves) {
-        if (valid.from == move.from && valid.to == move.to) {
-            return true;
-        }
-    }
-    
-    return false;
+    return findLegalMove(move) != nullptr;
 }
 
 bool CheckersGame::makeMove(const Move& move)
 {
-    if (!isValidMove(move)) return false;
-    
     // Find the full move with captures
-    QVector<Move> validMoves = getValidMoves(move.from);
-    Move fullMove = Move::invalid();
-    
-    for (const Move& valid : validMoves) {
-        if (valid.from == move.from && valid.to == move.to) {
-            fullMove = valid;
-            break;
-        }
-    }
+    const Move* legal = findLegalMove(move);
     
-    if (!fullMove.isValid()) return false;
+    if (!legal) return false;
     
-    Piece piece = pieceAt(fullMove.from);
+    // Copy it out; doMove invalidates the cached list
+    const Move fullMove = *legal;
     
-    // Move the piece
-    m_board[fullMove.from.y()][fullMove.from.x()] = Piece::Empty;
-    m_board[fullMove.to.y()][fullMove.to.x()] = piece;
+    UndoRecord undo;
+    doMove(fullMove, undo);
+    m_history.append(fullMove);
+    ++m_stateSequence;
     
-    // Remove captured pieces
-    if (!fullMove.captures.isEmpty()) {
-        for (const QPoint& cap : fullMove.captures) {
-            m_board[cap.y()][cap.x()] = Piece::Empty;
+    if (fullMove.captures) {
+        QVector<QPoint> captured;
+        for (Mask caps = fullMove.captures; caps; ) {
+            captured.append(squareToPoint(Bitboard::popLowestSquare(caps)));
         }
-        emit piecesCaptured(fullMove.captures);
+        emit piecesCaptured(captured);
     }
     
-    // Check for king promotion
-    bool crowned = false;
-    if (piece == Piece::Red && fullMove.to.y() == 0) {
-        m_board[fullMove.to.y()][fullMove.to.x()] = Piece::RedKing;
-        crowned = true;
-    } else if (piece == Piece::Black && fullMove.to.y() == BOARD_SIZE - 1) {
-        m_board[fullMove.to.y()][fullMove.to.x()] = Piece::BlackKing;
-        crowned = true;
-    }
-    
-    if (crowned) {
-        emit pieceCrowned(fullMove.to);
+    if (undo.crowned) {
+        emit pieceCrowned(squareToPoint(fullMove.to));
     }
     
     emit boardChanged();
-    
-    // Switch turns
-    switchPlayer();
+    emit turnChanged(m_position.sideToMove());
     checkForWinner();
     
     return true;
 }
 
-void CheckersGame::switchPlayer()
+void CheckersGame::doMove(const Move& move, UndoRecord& undo)
 {
-    m_currentPlayer = (m_currentPlayer == PlayerColor::Red) 
-                      ? PlayerColor::Black 
-                      : PlayerColor::Red;
-    emit turnChanged(m_currentPlayer);
+    m_legalMovesValid = false;
+    m_position.doMove(move, undo);
+}
+
+void CheckersGame::undoMove(const UndoRecord& undo)
+{
+    m_legalMovesValid = false;
+    m_position.undoMove(undo);
+}
+
+bool CheckersGame::probeTablebase(Tablebase::Entry& entry) const
+{
+    return m_tablebase && m_tablebase->probe(m_position, entry);
+}
+
+bool CheckersGame::tablebaseMove(Move& move, Tablebase::Entry& entry) const
+{
+    return m_tablebase && m_tablebase->bestMove(m_position, move, entry);
 }
 
 void CheckersGame::checkForWinner()
 {
     // Check if current player has any valid moves
-    QVector<QPoint> movable = getAllMovablePieces(m_currentPlayer);
-    
-    if (movable.isEmpty()) {
+    if (legalMoves().isEmpty()) {
         // Current player can't move - they lose
-        m_winner = (m_currentPlayer == PlayerColor::Red) 
-                   ? PlayerColor::Black 
-                   : PlayerColor::Red;
+        m_winner = Position::opponent(m_position.sideToMove());
         emit gameOver(m_winner);
     }
 }
 
 QByteArray CheckersGame::serialize() const
 {
-    QByteArray data;
-    QDataStream stream(&data, QIODevice::WriteOnly);
-    stream.setVersion(QDataStream::Qt_5_15);
+    Packed::Record record = Packed::encode(m_position, m_winner);
+    return QByteArray(reinterpret_cast<const char*>(record.data()), static_cast<int>(record.size()));
+}
+
+bool CheckersGame::deserialize(const QByteArray& data)
+{
+    const auto* bytes = reinterpret_cast<const std::uint8_t*>(data.constData());
+    const auto size = static_cast<std::size_t>(data.size());
+    
+    Position position;
+    PlayerColor winner = PlayerColor::None;
+    if (Packed::isPacked(bytes, size)) {
+        if (!Packed::decode(bytes, size, position, winner)) return false;
+    } else if (!deserializeLegacy(data, position, winner)) {
+        return false;
+    }
+    
+    m_position = position;
+    m_winner = winner;
+    m_startPosition = m_position;
+    m_history.clear();
+    m_legalMovesValid = false;
+    ++m_stateSequence;
     
-    // Write board state
-    for (int row = 0; row < BOARD_SIZE; ++row) {
-        for (int col = 0; col < BOARD_SIZE; ++col) {
-            stream << static_cast<int>(m_board[row][col]);
+    emit boardChanged();
+    emit turnChanged(m_position.sideToMove());
+    
+    if (m_winner != PlayerColor::None) {
+        emit gameOver(m_winner);
+    }
+    
+    return true;
+}
+
+QByteArray CheckersGame::stateDelta(const Position& base) const
+{
+    std::vector<std::uint8_t> delta = Packed::encodeDelta(base, m_position, m_winner, m_stateSequence);
+    return QByteArray(reinterpret_cast<const char*>(delta.data()), static_cast<int>(delta.size()));
+}
+
+Packed::DeltaResult CheckersGame::applyStateDelta(const QByteArray& delta)
+{
+    Position position = m_position;
+    PlayerColor winner = m_winner;
+    Packed::DeltaResult result = Packed::applyDelta(reinterpret_cast<const std::uint8_t*>(delta.constData()),
+                                                    static_cast<std::size_t>(delta.size()),
+                                                    position, winner, m_stateSequence);
+    if (result == Packed::DeltaResult::AlreadyApplied) {
+        // The board is right, but the game may only now be known to be over
+        bool ended = (winner != PlayerColor::None && m_winner != winner);
+        m_winner = winner;
+        if (ended) {
+            emit gameOver(m_winner);
+        }
+    } else if (result == Packed::DeltaResult::Applied) {
+        // The board changed under the move list, so start a new history
+        m_position = position;
+        m_winner = winner;
+        m_startPosition = m_position;
+        m_history.clear();
+        m_legalMovesValid = false;
+        
+        emit boardChanged();
+        emit turnChanged(m_position.sideToMove());
+        
+        if (m_winner != PlayerColor::None) {
+            emit gameOver(m_winner);
         }
     }
+    return result;
+}
+
+QString CheckersGame::toPdn(const QMap<QString, QString>& tags) const
+{
+    PdnGame game;
+    for (auto it = tags.constBegin(); it != tags.constEnd(); ++it) {
+        game.setTag(it.key().toStdString(), it.value().toStdString());
+    }
     
-    // Write game state
-    stream << static_cast<int>(m_currentPlayer);
-    stream << static_cast<int>(m_winner);
+    // Scored from Red's (PDN's White's) side
+    if (m_winner == PlayerColor::Red) {
+        game.result = "1-0";
+    } else if (m_winner == PlayerColor::Black) {
+        game.result = "0-1";
+    }
+    game.setTag("Result", game.result);
+    game.setTag("GameType", "21"); // American checkers
+    game.setTag("FEN", m_startPosition.toFen());
     
-    return data;
+    game.start = m_startPosition;
+    game.moves.assign(m_history.constBegin(), m_history.constEnd());
+    return QString::fromStdString(Pdn::writeGame(game));
 }
 
-void CheckersGame::deserialize(const QByteArray& data)
+bool CheckersGame::loadPdn(const QString& text, QString* error)
 {
-    QDataStream stream(data);
-    stream.setVersion(QDataStream::Qt_5_15);
-    
-    // Read board state
-    for (int row = 0; row < BOARD_SIZE; ++row) {
-        for (int col = 0; col < BOARD_SIZE; ++col) {
-            int piece;
-            stream >> piece;
-            m_board[row][col] = static_cast<Piece>(piece);
+    const std::string data = text.toStdString();
+    PdnReader reader;
+    reader.setData(data);
+    
+    PdnGame game;
+    PdnReader::Status status = reader.readGame(game);
+    if (status != PdnReader::Status::Game) {
+        if (error) {
+            *error = (status == PdnReader::Status::End) ? QStringLiteral("No game found")
+                                                        : QString::fromStdString(reader.error());
         }
+        return false;
     }
     
-    // Read game state
-    int currentPlayer, winner;
-    stream >> currentPlayer >> winner;
-    m_currentPlayer = static_cast<PlayerColor>(currentPlayer);
-    m_winner = static_cast<PlayerColor>(winner);
+    m_startPosition = game.start;
+    m_position = game.start;
+    m_history.clear();
+    for (const Move& move : game.moves) {
+        UndoRecord undo;
+        m_position.doMove(move, undo);
+        m_history.append(move);
+    }
+    m_winner = PlayerColor::None;
+    m_legalMovesValid = false;
+    ++m_stateSequence;
     
     emit boardChanged();
-    emit turnChanged(m_currentPlayer);
+    emit turnChanged(m_position.sideToMove());
+    checkForWinner();
     
-    if (m_winner != PlayerColor::None) {
-        emit gameOver(m_winner);
+    // A game that ended by resignation or adjudication still has moves left.
+    // The movetext's result counts, or the Result tag's if it has none.
+    if (m_winner == PlayerColor::None) {
+        PlayerColor winner = Pdn::resultWinner(game.result != "*" ? game.result : game.tag("Result"));
+        if (winner != PlayerColor::None) {
+            m_winner = winner;
+            emit gameOver(m_winner);
+        }
     }
+    return true;
 }
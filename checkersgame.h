@@ -1,40 +1,19 @@
 #ifndef CHECKERSGAME_H
 #define CHECKERSGAME_H
 
+#include <QMap>
 #include <QObject>
 #include <QPoint>
+#include <QString>
 #include <QVector>
+#include <memory>
+#include "packed.h"
+#include "position.h"
+#include "tablebase.h"
 
-// Piece types
-enum class Piece : int {
-    Empty = 0,
-    Red = 1,
-    Black = 2,
-    RedKing = 3,
-    BlackKing = 4
-};
-
-// Player colors
-enum class PlayerColor : int {
-    None = 0,
-    Red = 1,
-    Black = 2
-};
-
-// Move structure
-struct Move {
-    QPoint from;
-    QPoint to;
-    QVector<QPoint> captures; // Pieces captured during this move (for multi-jumps)
-    
-    bool isValid() const { return from != QPoint(-1, -1); }
-    static Move invalid() { return {{-1, -1}, {-1, -1}, {}}; }
-    
-    bool operator==(const Move& other) const {
-        return from == other.from && to == other.to;
-    }
-};
-
+// The rules live in Position (the Qt-free checkers-core library); this class
+// adds the game result, a cached legal move list and change notifications
+// for the GUI and network code.
 class CheckersGame : public QObject
 {
     Q_OBJECT
@@ -48,24 +27,80 @@ public:
     void resetGame();
     Piece pieceAt(int row, int col) const;
     Piece pieceAt(const QPoint& pos) const;
-    PlayerColor currentPlayer() const { return m_currentPlayer; }
+    PlayerColor currentPlayer() const { return m_position.sideToMove(); }
     PlayerColor winner() const { return m_winner; }
     bool isGameOver() const { return m_winner != PlayerColor::None; }
     
+    // 64-bit Zobrist key of the pieces and side to move, kept up to date
+    // incrementally by every move
+    quint64 hash() const { return m_position.hash(); }
+    
+    // Current position by value, e.g. for an engine or worker thread
+    const Position& position() const { return m_position; }
+    
     // Move validation and execution
-    QVector<Move> getValidMoves(const QPoint& from) const;
+    MoveList getValidMoves(const QPoint& from) const;
+    void generateMoves(MoveList& moves) const { m_position.generateMoves(moves); }
+    
+    // The current player's legal moves, generated once per position and
+    // shared by getValidMoves, getAllMovablePieces, isValidMove and the
+    // game-over check. Not thread-safe; search code should use generateMoves.
+    const MoveList& legalMoves() const;
     QVector<QPoint> getAllMovablePieces(PlayerColor player) const;
     bool isValidMove(const Move& move) const;
     bool makeMove(const Move& move);
     
+    // Unchecked, signal-free make/unmake for search and analysis. The move
+    // must be legal for the current player (e.g. from generateMoves), and
+    // moves must be undone in reverse order. The winner is not updated.
+    void doMove(const Move& move, UndoRecord& undo);
+    void undoMove(const UndoRecord& undo);
+    
+    // Endgame analysis. Both return false when no tablebase is set or the
+    // current position isn't covered by it.
+    void setTablebase(std::shared_ptr<const Tablebase> tablebase) { m_tablebase = std::move(tablebase); }
+    std::shared_ptr<const Tablebase> tablebase() const { return m_tablebase; }
+    bool probeTablebase(Tablebase::Entry& entry) const;
+    bool tablebaseMove(Move& move, Tablebase::Entry& entry) const;
+    
     // Utility
     bool isPlayerPiece(const QPoint& pos, PlayerColor player) const;
-    static PlayerColor pieceOwner(Piece piece);
-    static bool isKing(Piece piece);
+    static PlayerColor pieceOwner(Piece piece) { return Position::pieceOwner(piece); }
+    static bool isKing(Piece piece) { return Position::isKing(piece); }
+    static QPoint squareToPoint(int square);
+    static int pointToSquare(const QPoint& pos); // -1 for light or off-board squares
     
-    // Serialization for network
+    // Serialization for network: a 14-byte Packed record (packed.h).
+    // deserialize also reads the 264-byte QDataStream layout of older
+    // versions, and returns false, leaving the game alone, for anything else.
     QByteArray serialize() const;
-    void deserialize(const QByteArray& data);
+    bool deserialize(const QByteArray& data); // Starts a new move history
+    
+    // Network sync. Every change to the game (a move, a reset, a loaded or
+    // received position) advances stateSequence; the client adopts the
+    // host's numbering. stateDelta describes the current state as changes
+    // from base (Packed::encodeDelta); applyStateDelta also adopts the
+    // delta's sequence when it succeeds, and starts a new move history if
+    // it had to change the board. A move or delta whose sequence is not the
+    // one after stateSequence means one was missed or replayed.
+    quint32 stateSequence() const { return m_stateSequence; }
+    void setStateSequence(quint32 sequence) { m_stateSequence = sequence; }
+    QByteArray stateDelta(const Position& base) const;
+    Packed::DeltaResult applyStateDelta(const QByteArray& delta);
+    
+    // Every move made with makeMove since the game started from
+    // startPosition(); deserialize starts over from the received position
+    const Position& startPosition() const { return m_startPosition; }
+    const QVector<Move>& moveHistory() const { return m_history; }
+    
+    // Portable Draughts Notation. toPdn adds the given tags (Event, White
+    // for Red's player, Black, ...) to the FEN and Result tags it writes
+    // itself. loadPdn replays the first game in text, checking every move,
+    // and leaves the game unchanged if it fails. A decided result ("1-0",
+    // "0-2", ...) ends the loaded game even if moves are left; draws and
+    // "*" leave it to the position.
+    QString toPdn(const QMap<QString, QString>& tags = QMap<QString, QString>()) const;
+    bool loadPdn(const QString& text, QString* error = nullptr);
     
 signals:
     void boardChanged();
@@ -75,23 +110,19 @@ signals:
     void pieceCrowned(const QPoint& position);
     
 private:
-    Piece m_board[BOARD_SIZE][BOARD_SIZE];
-    PlayerColor m_currentPlayer;
+    Position m_position;
+    Position m_startPosition;
+    QVector<Move> m_history;
     PlayerColor m_winner;
+    quint32 m_stateSequence = 0;
+    std::shared_ptr<const Tablebase> m_tablebase;
+    
+    // Legal move cache, invalidated on every board change
+    mutable MoveList m_legalMoves;
+    mutable bool m_legalMovesValid = false;
     
-    void initializeBoard();
-    void switchPlayer();
     void checkForWinner();
-    bool canCapture(const QPoint& from, PlayerColor player) const;
-    bool playerHasCapture(PlayerColor player) const;
-    QVector<Move> getCaptureMoves(const QPoint& from) const;
-    QVector<Move> getSimpleMoves(const QPoint& from) const;
-    void findMultiJumps(const QPoint& current, const QPoint& original, 
-                        Piece piece, QVector<QPoint>& captured,
-                        QVector<Move>& moves, Piece tempBoard[BOARD_SIZE][BOARD_SIZE]) const;
-    bool isValidPosition(const QPoint& pos) const;
-    bool isEmpty(const QPoint& pos) const;
-    bool isOpponent(const QPoint& pos, PlayerColor player) const;
+    const Move* findLegalMove(const Move& move) const;
 };
 
 #endif // CHECKERSGAME_H
@@ -123,7 +123,17 @@ void ConnectionDialog::setupUI()
     m_joinButton->setStyleSheet("QPushButton { font-weight: bold; }");
     m_joinButton->setEnabled(false);
     connect(m_joinButton, &QPushButton::clicked, this, &ConnectionDialog::onJoinClicked);
-    joinLayout->addWidget(m_joinButton);
+    
+    m_watchButton = new QPushButton(tr("Watch Game"));
+    m_watchButton->setMinimumHeight(40);
+    m_watchButton->setToolTip(tr("Follow the game without playing"));
+    m_watchButton->setEnabled(false);
+    connect(m_watchButton, &QPushButton::clicked, this, &ConnectionDialog::onWatchClicked);
+    
+    QHBoxLayout* joinButtonLayout = new QHBoxLayout();
+    joinButtonLayout->addWidget(m_joinButton, 2);
+    joinButtonLayout->addWidget(m_watchButton, 1);
+    joinLayout->addLayout(joinButtonLayout);
     
     m_tabWidget->addTab(joinTab, tr("Join Game"));
     
@@ -194,6 +204,7 @@ void ConnectionDialog::updateJoinButtonState()
     bool hasHost = !m_manualHostEdit->text().trimmed().isEmpty();
     bool hasName = !m_joinNameEdit->text().trimmed().isEmpty();
     m_joinButton->setEnabled(hasHost && hasName);
+    m_watchButton->setEnabled(hasHost && hasName);
 }
 
 void ConnectionDialog::onHostClicked()
@@ -214,6 +225,16 @@ void ConnectionDialog::onHostClicked()
 }
 
 void ConnectionDialog::onJoinClicked()
+{
+    requestJoin(Result::Join);
+}
+
+void ConnectionDialog::onWatchClicked()
+{
+    requestJoin(Result::Watch);
+}
+
+void ConnectionDialog::requestJoin(Result result)
 {
     QString name = m_joinNameEdit->text().trimmed();
     QString host = m_manualHostEdit->text().trimmed();
@@ -233,8 +254,12 @@ void ConnectionDialog::onJoinClicked()
     }
     
     stopDiscovery();
-    m_result = Result::Join;
-    emit joinRequested(name, host, m_joinPortSpinBox->value());
+    m_result = result;
+    if (result == Result::Watch) {
+        emit watchRequested(name, host, m_joinPortSpinBox->value());
+    } else {
+        emit joinRequested(name, host, m_joinPortSpinBox->value());
+    }
     accept();
 }
 
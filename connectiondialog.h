@@ -18,7 +18,8 @@ public:
     enum class Result {
         Cancelled,
         Host,
-        Join
+        Join,
+        Watch
     };
     
     explicit ConnectionDialog(NetworkManager* networkManager, QWidget *parent = nullptr);
@@ -31,10 +32,12 @@ public:
 signals:
     void hostRequested(const QString& playerName, quint16 port);
     void joinRequested(const QString& playerName, const QString& host, quint16 port);
+    void watchRequested(const QString& playerName, const QString& host, quint16 port);
     
 private slots:
     void onHostClicked();
     void onJoinClicked();
+    void onWatchClicked();
     void onPeerSelected(QListWidgetItem* item);
     void onPeerDoubleClicked(QListWidgetItem* item);
     void refreshPeerList();
@@ -42,6 +45,7 @@ private slots:
     
 private:
     void setupUI();
+    void requestJoin(Result result);
     void startDiscovery();
     void stopDiscovery();
     
@@ -63,6 +67,7 @@ private:
     QLineEdit* m_manualHostEdit;
     QSpinBox* m_joinPortSpinBox;
     QPushButton* m_joinButton;
+    QPushButton* m_watchButton;
     QPushButton* m_refreshButton;
     QLabel* m_statusLabel;
 };
@@ -0,0 +1,303 @@
+#include "eval.h"
+#include "zobrist.h"
+#include <cstring>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define CHECKERS_EVAL_AVX2 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define CHECKERS_EVAL_SSE2 1
+#endif
+
+using Bitboard::Mask;
+using namespace Eval;
+
+namespace {
+
+// Bonus for a man by how many rows it has advanced from its own back rank
+constexpr int ADVANCE_BONUS[8] = {0, 1, 3, 6, 10, 15, 21, 0};
+
+// Men left on the back rank keep the opponent from crowning
+constexpr int BACK_RANK_BONUS = 8;
+
+// The four central squares (15, 16, 19 and 20 in 1-32 numbering)
+constexpr Mask CENTER = Bitboard::bit(13) | Bitboard::bit(14) | Bitboard::bit(17) | Bitboard::bit(18);
+constexpr int CENTER_BONUS = 6;
+
+// Per step of king centrality, at full strength once the board is empty
+constexpr int KING_CENTRALITY_BONUS = 2;
+
+constexpr int STARTING_PIECES = 24;
+
+// Men on diagonally adjacent squares can't be jumped one over the other
+constexpr int PAIR_BONUS = 2;
+
+// Men on the first and third squares of their own back rank between them
+// guard every crowning square against a lone man
+constexpr int BRIDGE_BONUS = 10;
+constexpr Mask RED_BRIDGE = Bitboard::bit(29) | Bitboard::bit(31);
+constexpr Mask BLACK_BRIDGE = Bitboard::bit(0) | Bitboard::bit(2);
+
+// For each square, the squares whose men form a pattern with a man on it
+struct PatternTable {
+    Mask neighbours[Bitboard::SQUARES];
+    Mask bridge[2][Bitboard::SQUARES]; // Red's, then Black's
+};
+
+constexpr PatternTable makePatterns()
+{
+    PatternTable table{};
+    for (int square = 0; square < Bitboard::SQUARES; ++square) {
+        Mask m = Bitboard::bit(square);
+        table.neighbours[square] = Bitboard::upLeft(m) | Bitboard::upRight(m)
+                                   | Bitboard::downLeft(m) | Bitboard::downRight(m);
+        table.bridge[0][square] = (RED_BRIDGE & m) ? (RED_BRIDGE & ~m) : 0;
+        table.bridge[1][square] = (BLACK_BRIDGE & m) ? (BLACK_BRIDGE & ~m) : 0;
+    }
+    return table;
+}
+
+constexpr PatternTable PATTERNS = makePatterns();
+
+// What a man of one side on square adds to Patterns, given the side's
+// other men
+inline int patternScore(bool red, int square, Mask men)
+{
+    int score = Bitboard::popCount(PATTERNS.neighbours[square] & men) * PAIR_BONUS;
+    if (PATTERNS.bridge[red ? 0 : 1][square] & men) {
+        score += BRIDGE_BONUS;
+    }
+    return score;
+}
+
+// Patterns for all of one side's men; every pair is seen from both ends
+int patternTotal(bool red, Mask men)
+{
+    int total = 0;
+    for (Mask rest = men; rest; ) {
+        int square = Bitboard::popLowestSquare(rest);
+        total += patternScore(red, square, men & ~Bitboard::bit(square));
+    }
+    return total / 2;
+}
+
+// Feature weights for one piece kind (see Zobrist::PieceKind) on one square
+struct alignas(32) WeightTable {
+    std::int16_t rows[4][Bitboard::SQUARES][LANES];
+};
+
+constexpr int min4(int a, int b, int c, int d)
+{
+    int m = a < b ? a : b;
+    m = m < c ? m : c;
+    return m < d ? m : d;
+}
+
+constexpr WeightTable makeWeights()
+{
+    WeightTable table{};
+    for (int kind = 0; kind < 4; ++kind) {
+        const bool red = (kind == Zobrist::RedMan || kind == Zobrist::RedKing);
+        const bool king = (kind == Zobrist::RedKing || kind == Zobrist::BlackKing);
+        const int side = red ? 0 : FEATURES_PER_SIDE;
+        
+        for (int square = 0; square < Bitboard::SQUARES; ++square) {
+            std::int16_t* row = table.rows[kind][square];
+            const int r = Bitboard::squareRow(square);
+            const int c = Bitboard::squareCol(square);
+            
+            row[side + Center] = (CENTER & Bitboard::bit(square)) ? 1 : 0;
+            if (king) {
+                row[side + Material] = KING_VALUE;
+                row[side + Kings] = 1;
+                row[side + KingCentrality] = static_cast<std::int16_t>(min4(r, 7 - r, c, 7 - c));
+            } else {
+                row[side + Material] = MAN_VALUE;
+                row[side + Men] = 1;
+                row[side + Advancement] = static_cast<std::int16_t>(ADVANCE_BONUS[red ? 7 - r : r]);
+                row[side + BackRank] = (Bitboard::bit(square) & (red ? Bitboard::BOTTOM_ROW : Bitboard::TOP_ROW)) ? 1 : 0;
+            }
+        }
+    }
+    return table;
+}
+
+constexpr WeightTable WEIGHTS = makeWeights();
+
+const std::int16_t* weightRow(Zobrist::PieceKind kind, int square)
+{
+    return WEIGHTS.rows[kind][square];
+}
+
+// child = parent - remove + add
+inline void moveRows(const Accumulator& parent, const std::int16_t* remove, const std::int16_t* add, Accumulator& child)
+{
+#if defined(CHECKERS_EVAL_AVX2)
+    __m256i v = _mm256_load_si256(reinterpret_cast<const __m256i*>(parent.lanes));
+    v = _mm256_sub_epi16(v, _mm256_load_si256(reinterpret_cast<const __m256i*>(remove)));
+    v = _mm256_add_epi16(v, _mm256_load_si256(reinterpret_cast<const __m256i*>(add)));
+    _mm256_store_si256(reinterpret_cast<__m256i*>(child.lanes), v);
+#elif defined(CHECKERS_EVAL_SSE2)
+    for (int i = 0; i < LANES; i += 8) {
+        __m128i v = _mm_load_si128(reinterpret_cast<const __m128i*>(parent.lanes + i));
+        v = _mm_sub_epi16(v, _mm_load_si128(reinterpret_cast<const __m128i*>(remove + i)));
+        v = _mm_add_epi16(v, _mm_load_si128(reinterpret_cast<const __m128i*>(add + i)));
+        _mm_store_si128(reinterpret_cast<__m128i*>(child.lanes + i), v);
+    }
+#else
+    for (int i = 0; i < LANES; ++i) {
+        child.lanes[i] = static_cast<std::int16_t>(parent.lanes[i] - remove[i] + add[i]);
+    }
+#endif
+}
+
+inline void addRow(Accumulator& accumulator, const std::int16_t* row)
+{
+#if defined(CHECKERS_EVAL_AVX2)
+    __m256i v = _mm256_load_si256(reinterpret_cast<const __m256i*>(accumulator.lanes));
+    v = _mm256_add_epi16(v, _mm256_load_si256(reinterpret_cast<const __m256i*>(row)));
+    _mm256_store_si256(reinterpret_cast<__m256i*>(accumulator.lanes), v);
+#elif defined(CHECKERS_EVAL_SSE2)
+    for (int i = 0; i < LANES; i += 8) {
+        __m128i v = _mm_load_si128(reinterpret_cast<const __m128i*>(accumulator.lanes + i));
+        v = _mm_add_epi16(v, _mm_load_si128(reinterpret_cast<const __m128i*>(row + i)));
+        _mm_store_si128(reinterpret_cast<__m128i*>(accumulator.lanes + i), v);
+    }
+#else
+    for (int i = 0; i < LANES; ++i) {
+        accumulator.lanes[i] = static_cast<std::int16_t>(accumulator.lanes[i] + row[i]);
+    }
+#endif
+}
+
+inline void subtractRow(Accumulator& accumulator, const std::int16_t* row)
+{
+#if defined(CHECKERS_EVAL_AVX2)
+    __m256i v = _mm256_load_si256(reinterpret_cast<const __m256i*>(accumulator.lanes));
+    v = _mm256_sub_epi16(v, _mm256_load_si256(reinterpret_cast<const __m256i*>(row)));
+    _mm256_store_si256(reinterpret_cast<__m256i*>(accumulator.lanes), v);
+#elif defined(CHECKERS_EVAL_SSE2)
+    for (int i = 0; i < LANES; i += 8) {
+        __m128i v = _mm_load_si128(reinterpret_cast<const __m128i*>(accumulator.lanes + i));
+        v = _mm_sub_epi16(v, _mm_load_si128(reinterpret_cast<const __m128i*>(row + i)));
+        _mm_store_si128(reinterpret_cast<__m128i*>(accumulator.lanes + i), v);
+    }
+#else
+    for (int i = 0; i < LANES; ++i) {
+        accumulator.lanes[i] = static_cast<std::int16_t>(accumulator.lanes[i] - row[i]);
+    }
+#endif
+}
+
+void addPieces(Accumulator& accumulator, Zobrist::PieceKind kind, Mask squares)
+{
+    while (squares) {
+        addRow(accumulator, weightRow(kind, Bitboard::popLowestSquare(squares)));
+    }
+}
+
+} // namespace
+
+void Eval::refresh(const Position& position, Accumulator& accumulator)
+{
+    const Bitboard::Board& board = position.board();
+    std::memset(accumulator.lanes, 0, sizeof(accumulator.lanes));
+    addPieces(accumulator, Zobrist::RedMan, board.red & ~board.kings);
+    addPieces(accumulator, Zobrist::BlackMan, board.black & ~board.kings);
+    addPieces(accumulator, Zobrist::RedKing, board.red & board.kings);
+    addPieces(accumulator, Zobrist::BlackKing, board.black & board.kings);
+    
+    accumulator.lanes[Patterns] = static_cast<std::int16_t>(patternTotal(true, board.red & ~board.kings));
+    accumulator.lanes[FEATURES_PER_SIDE + Patterns] =
+        static_cast<std::int16_t>(patternTotal(false, board.black & ~board.kings));
+}
+
+void Eval::update(const Position& position, const UndoRecord& undo, const Accumulator& parent, Accumulator& child)
+{
+    // The mover is the side not to move now
+    const bool red = (position.sideToMove() == PlayerColor::Black);
+    const bool kingAfter = (position.board().kings & Bitboard::bit(undo.move.to)) != 0;
+    const bool kingBefore = kingAfter && !undo.crowned;
+    
+    moveRows(parent,
+             weightRow(Zobrist::pieceKind(red, kingBefore), undo.move.from),
+             weightRow(Zobrist::pieceKind(red, kingAfter), undo.move.to),
+             child);
+    
+    for (Mask captured = undo.move.captures; captured; ) {
+        int square = Bitboard::popLowestSquare(captured);
+        bool king = (undo.capturedKings & Bitboard::bit(square)) != 0;
+        subtractRow(child, weightRow(Zobrist::pieceKind(!red, king), square));
+    }
+    
+    // Patterns: the mover's man leaves its pairs at from and joins those at
+    // to, unless it is a king by then; each captured man leaves its pairs
+    // with the men still on the board, taken off one at a time so a pair
+    // of captured men is only counted once
+    const Bitboard::Board& board = position.board();
+    const Mask moverMen = (red ? board.red : board.black) & ~board.kings & ~Bitboard::bit(undo.move.to);
+    int moverDelta = 0;
+    if (!kingBefore) {
+        moverDelta -= patternScore(red, undo.move.from, moverMen);
+    }
+    if (!kingAfter) {
+        moverDelta += patternScore(red, undo.move.to, moverMen);
+    }
+    
+    int capturedDelta = 0;
+    Mask opponentMen = ((red ? board.black : board.red) & ~board.kings)
+                       | (undo.move.captures & ~undo.capturedKings);
+    for (Mask captured = undo.move.captures & ~undo.capturedKings; captured; ) {
+        int square = Bitboard::popLowestSquare(captured);
+        opponentMen &= ~Bitboard::bit(square);
+        capturedDelta -= patternScore(!red, square, opponentMen);
+    }
+    
+    const int moverLane = (red ? 0 : FEATURES_PER_SIDE) + Patterns;
+    const int opponentLane = (red ? FEATURES_PER_SIDE : 0) + Patterns;
+    child.lanes[moverLane] = static_cast<std::int16_t>(child.lanes[moverLane] + moverDelta);
+    child.lanes[opponentLane] = static_cast<std::int16_t>(child.lanes[opponentLane] + capturedDelta);
+}
+
+int Eval::evaluate(const Position& position, const Accumulator& accumulator)
+{
+    const std::int16_t* red = accumulator.lanes;
+    const std::int16_t* black = accumulator.lanes + FEATURES_PER_SIDE;
+    
+    int score = red[Material] - black[Material];
+    
+    // The same lead is worth more with fewer pieces left, so the side that
+    // is ahead prefers to trade down
+    int pieces = red[Men] + red[Kings] + black[Men] + black[Kings];
+    score += score * (STARTING_PIECES - pieces) / 48;
+    
+    score += red[Advancement] - black[Advancement];
+    score += (red[BackRank] - black[BackRank]) * BACK_RANK_BONUS;
+    score += (red[Center] - black[Center]) * CENTER_BONUS;
+    score += red[Patterns] - black[Patterns];
+    
+    // Central kings matter more as the board empties
+    score += (red[KingCentrality] - black[KingCentrality]) * KING_CENTRALITY_BONUS
+           * (STARTING_PIECES - pieces) / STARTING_PIECES;
+    
+    return position.sideToMove() == PlayerColor::Red ? score : -score;
+}
+
+int Eval::evaluate(const Position& position)
+{
+    Accumulator accumulator;
+    refresh(position, accumulator);
+    return evaluate(position, accumulator);
+}
+
+const char* Eval::simdName()
+{
+#if defined(CHECKERS_EVAL_AVX2)
+    return "avx2";
+#elif defined(CHECKERS_EVAL_SSE2)
+    return "sse2";
+#else
+    return "scalar";
+#endif
+}
@@ -0,0 +1,57 @@
+#ifndef EVAL_H
+#define EVAL_H
+
+#include <cstdint>
+#include "position.h"
+
+// Static evaluation for the search. Scores are in hundredths of a man and
+// always from the point of view of the side to move.
+//
+// The evaluation keeps an accumulator of feature sums. Most terms are sums
+// over pieces: one row of feature weights per piece kind and square, summed
+// over the pieces on the board, so a move only adds and subtracts the rows
+// of the squares it touches. Patterns depend on pairs of men instead; a
+// move changes that sum by the pairs the men it moves, crowns or captures
+// belonged to, looked up in per-square partner masks. The final score
+// combines the sums.
+namespace Eval {
+
+constexpr int MAN_VALUE = 100;
+constexpr int KING_VALUE = 150;
+
+// One AVX2 register, or two SSE2 ones. Lanes 0-7 hold Red's features and
+// lanes 8-15 Black's, in the order of Feature.
+constexpr int LANES = 16;
+
+enum Feature : int {
+    Material = 0,
+    Advancement, // ADVANCE_BONUS summed over men
+    BackRank,    // Men still on their own back rank
+    Center,      // Pieces on the four central squares
+    Men,
+    Kings,
+    KingCentrality, // 0 on the edge up to 3 in the middle, per king
+    Patterns,    // Weighted pairs of men: diagonal neighbours, and the bridge
+    FEATURES_PER_SIDE
+};
+
+struct alignas(32) Accumulator {
+    std::int16_t lanes[LANES];
+};
+
+// From scratch, e.g. at the root of a search
+void refresh(const Position& position, Accumulator& accumulator);
+
+// The accumulator for position, which is parent's position after the move
+// in undo was made
+void update(const Position& position, const UndoRecord& undo, const Accumulator& parent, Accumulator& child);
+
+int evaluate(const Position& position, const Accumulator& accumulator);
+int evaluate(const Position& position); // Refreshes a temporary accumulator
+
+// "avx2", "sse2" or "scalar"
+const char* simdName();
+
+} // namespace Eval
+
+#endif // EVAL_H
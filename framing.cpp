@@ -0,0 +1,151 @@
+#include "framing.h"
+#include <algorithm>
+#include <cstring>
+
+namespace Framing {
+
+namespace {
+
+constexpr std::size_t INITIAL_CAPACITY = 4096;
+constexpr std::uint32_t NULL_PAYLOAD = 0xFFFFFFFFu;
+
+void writeUint32(std::uint8_t* out, std::uint32_t value)
+{
+    for (int i = 0; i < 4; ++i) {
+        out[i] = static_cast<std::uint8_t>(value >> (8 * (3 - i)));
+    }
+}
+
+std::uint32_t readUint32(const std::uint8_t* data)
+{
+    return (std::uint32_t(data[0]) << 24) | (std::uint32_t(data[1]) << 16)
+           | (std::uint32_t(data[2]) << 8) | std::uint32_t(data[3]);
+}
+
+// Smallest ring that holds a whole maximum-size frame with its length
+std::size_t ringLimit(std::size_t maxFrameSize)
+{
+    std::size_t limit = INITIAL_CAPACITY;
+    while (limit < maxFrameSize + LENGTH_SIZE) {
+        limit *= 2;
+    }
+    return limit;
+}
+
+} // namespace
+
+FrameReader::FrameReader(std::size_t maxFrameSize)
+    : m_ring(INITIAL_CAPACITY)
+    , m_mask(INITIAL_CAPACITY - 1)
+    , m_maxFrameSize(maxFrameSize)
+{
+}
+
+std::uint8_t* FrameReader::writePointer(std::size_t& size)
+{
+    if (buffered() == m_ring.size() && m_ring.size() < ringLimit(m_maxFrameSize)) {
+        grow();
+    }
+    
+    std::size_t offset = m_tail & m_mask;
+    size = std::min(m_ring.size() - offset, m_ring.size() - buffered());
+    return m_ring.data() + offset;
+}
+
+void FrameReader::commit(std::size_t bytes)
+{
+    m_tail += bytes;
+}
+
+FrameReader::Status FrameReader::next(Frame& frame)
+{
+    if (buffered() < LENGTH_SIZE) return Status::NeedMore;
+    
+    std::uint8_t lengthBytes[LENGTH_SIZE];
+    for (std::size_t i = 0; i < LENGTH_SIZE; ++i) {
+        lengthBytes[i] = byteAt(i);
+    }
+    std::size_t length = readUint32(lengthBytes);
+    if (length < BODY_HEADER_SIZE || length > m_maxFrameSize) return Status::Malformed;
+    if (buffered() < LENGTH_SIZE + length) return Status::NeedMore;
+    
+    // In place unless the body wraps around the end of the ring
+    const std::uint8_t* body;
+    std::size_t start = (m_head + LENGTH_SIZE) & m_mask;
+    if (start + length <= m_ring.size()) {
+        body = m_ring.data() + start;
+    } else {
+        std::size_t first = m_ring.size() - start;
+        m_scratch.resize(length);
+        std::memcpy(m_scratch.data(), m_ring.data() + start, first);
+        std::memcpy(m_scratch.data() + first, m_ring.data(), length - first);
+        body = m_scratch.data();
+    }
+    
+    std::uint32_t payloadSize = readUint32(body + 1);
+    if (payloadSize == NULL_PAYLOAD) {
+        payloadSize = 0;
+    } else if (payloadSize > length - BODY_HEADER_SIZE) {
+        return Status::Malformed;
+    }
+    
+    frame.type = body[0];
+    frame.payload = body + BODY_HEADER_SIZE;
+    frame.payloadSize = payloadSize;
+    
+    // The bytes stay where they are until the next write, so frame is
+    // still good after the head moves past it
+    m_head += LENGTH_SIZE + length;
+    if (m_head == m_tail) {
+        m_head = m_tail = 0;
+    }
+    return Status::Frame;
+}
+
+void FrameReader::clear()
+{
+    m_head = m_tail = 0;
+}
+
+void FrameReader::setMaxFrameSize(std::size_t maxFrameSize)
+{
+    // The ring never shrinks; a lower limit only stops it growing further
+    m_maxFrameSize = maxFrameSize;
+}
+
+// Doubles the ring, unwrapping what is buffered to the start of it
+void FrameReader::grow()
+{
+    std::vector<std::uint8_t> ring(m_ring.size() * 2);
+    std::size_t count = buffered();
+    std::size_t start = m_head & m_mask;
+    std::size_t first = std::min(count, m_ring.size() - start);
+    std::memcpy(ring.data(), m_ring.data() + start, first);
+    std::memcpy(ring.data() + first, m_ring.data(), count - first);
+    
+    m_ring.swap(ring);
+    m_mask = m_ring.size() - 1;
+    m_head = 0;
+    m_tail = count;
+}
+
+bool FrameWriter::build(std::uint8_t type, const std::uint8_t* payload, std::size_t payloadSize)
+{
+    std::size_t length = BODY_HEADER_SIZE + payloadSize;
+    if (length > m_maxFrameSize) {
+        m_buffer.clear();
+        return false;
+    }
+    
+    // resize keeps the capacity of earlier frames, so this rarely allocates
+    m_buffer.resize(LENGTH_SIZE + length);
+    writeUint32(m_buffer.data(), static_cast<std::uint32_t>(length));
+    m_buffer[LENGTH_SIZE] = type;
+    writeUint32(m_buffer.data() + LENGTH_SIZE + 1, static_cast<std::uint32_t>(payloadSize));
+    if (payloadSize > 0) {
+        std::memcpy(m_buffer.data() + FRAME_OVERHEAD, payload, payloadSize);
+    }
+    return true;
+}
+
+} // namespace Framing
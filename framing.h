@@ -0,0 +1,103 @@
+#ifndef FRAMING_H
+#define FRAMING_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Length-prefixed message frames for the TCP protocol, laid out the way
+// QDataStream writes them so older peers keep reading us:
+//
+//   bytes 0-3   body length (big-endian)
+//   byte 4      MessageType
+//   bytes 5-8   payload length (big-endian; 0xFFFFFFFF for a null
+//               QByteArray, read as empty)
+//   then the payload
+//
+// No Qt here, so the client and the headless tools share one parser.
+namespace Framing {
+
+constexpr std::size_t LENGTH_SIZE = 4;
+constexpr std::size_t BODY_HEADER_SIZE = 5;
+constexpr std::size_t FRAME_OVERHEAD = LENGTH_SIZE + BODY_HEADER_SIZE;
+
+// Largest body either side accepts; the biggest real messages are chat lines
+constexpr std::size_t DEFAULT_MAX_FRAME_SIZE = 64 * 1024;
+
+struct Frame {
+    std::uint8_t type = 0;
+    const std::uint8_t* payload = nullptr;
+    std::size_t payloadSize = 0;
+};
+
+// Socket bytes go straight into a power-of-two ring and frames are parsed
+// where they lie; only a frame that wraps past the end of the ring is
+// copied, into a scratch buffer. The ring starts small and doubles while a
+// frame in progress needs the room, up to one maximum-size frame, so a
+// flood of messages never holds more than that per connection.
+class FrameReader
+{
+public:
+    enum class Status {
+        Frame,      // frame is set
+        NeedMore,   // no complete frame buffered yet
+        Malformed   // the length is over the maximum or the body is inconsistent
+    };
+    
+    explicit FrameReader(std::size_t maxFrameSize = DEFAULT_MAX_FRAME_SIZE);
+    
+    // Contiguous free space for the next read from the socket; hand the
+    // number of bytes actually read to commit. Empty only when a complete
+    // frame is waiting to be taken with next.
+    std::uint8_t* writePointer(std::size_t& size);
+    void commit(std::size_t bytes);
+    
+    // The next complete frame, which stays valid until the reader is used
+    // again. Once Malformed the stream can't be resynchronised; drop the
+    // connection.
+    Status next(Frame& frame);
+    
+    void clear();
+    
+    std::size_t buffered() const { return m_tail - m_head; }
+    std::size_t capacity() const { return m_ring.size(); }
+    std::size_t maxFrameSize() const { return m_maxFrameSize; }
+    void setMaxFrameSize(std::size_t maxFrameSize);
+    
+private:
+    std::uint8_t byteAt(std::size_t offset) const { return m_ring[(m_head + offset) & m_mask]; }
+    void grow();
+    
+    std::vector<std::uint8_t> m_ring;
+    std::vector<std::uint8_t> m_scratch;
+    std::size_t m_mask = 0;
+    std::size_t m_head = 0;  // Read position; both grow without wrapping
+    std::size_t m_tail = 0;  // Write position
+    std::size_t m_maxFrameSize;
+};
+
+// Builds each frame once, header and payload together, in a buffer that is
+// reused from frame to frame
+class FrameWriter
+{
+public:
+    explicit FrameWriter(std::size_t maxFrameSize = DEFAULT_MAX_FRAME_SIZE)
+        : m_maxFrameSize(maxFrameSize) {}
+    
+    // False, leaving the buffer empty, if the body would be over the maximum
+    bool build(std::uint8_t type, const std::uint8_t* payload, std::size_t payloadSize);
+    
+    const std::uint8_t* data() const { return m_buffer.data(); }
+    std::size_t size() const { return m_buffer.size(); }
+    
+    std::size_t maxFrameSize() const { return m_maxFrameSize; }
+    void setMaxFrameSize(std::size_t maxFrameSize) { m_maxFrameSize = maxFrameSize; }
+    
+private:
+    std::vector<std::uint8_t> m_buffer;
+    std::size_t m_maxFrameSize;
+};
+
+} // namespace Framing
+
+#endif // FRAMING_H
@@ -0,0 +1,347 @@
+#include "checkersgame.h"
+#include "framing.h"
+#include "protocol.h"
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QHostAddress>
+#include <QTcpSocket>
+#include <QThread>
+#include <QTimer>
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+// Load generator for checkers-server.
+//
+//   checkers-loadbot [options]
+//
+// Connects two bot clients per game. Each plays random legal moves through
+// the normal client protocol, as soon as the server relays the opponent's
+// move or after a fixed think time. Red starts a new game whenever one ends
+// or runs too long. Prints a line every second and a summary at the end:
+//
+//   <seconds>s <n>/<bots> playing, <games finished> games, <moves> moves
+//   (<moves per second>/s), <n> resyncs
+//
+// A bot counts as playing once the server has paired it, not when its
+// connection opens: a connection the server's full listen backlog dropped
+// still looks open to the client.
+//
+// Options:
+//   --host <address>   Server address (default: 127.0.0.1)
+//   --port <n>         Server port (default: 45678)
+//   --games <n>        Games played at once, two bots each (default: 100)
+//   --threads <n>      Threads the bots are spread over (default: 1)
+//   --seconds <n>      How long to run (default: 30)
+//   --delay <ms>       Think time before each move (default: 0)
+//   --max-plies <n>    Longer games are restarted (default: 200)
+
+namespace {
+
+struct Options {
+    QHostAddress host = QHostAddress(QHostAddress::LocalHost);
+    quint16 port = Protocol::DEFAULT_PORT;
+    int games = 100;
+    int threadCount = 1;
+    int seconds = 30;
+    int delayMs = 0;
+    int maxPlies = 200;
+};
+
+// Bots connect this many at a time, so a burst of them does not overflow
+// the server's listen backlog (50 before Qt 6.3)
+constexpr int CONNECT_BATCH = 25;
+constexpr int CONNECT_INTERVAL_MS = 10;
+
+struct BotStats {
+    std::atomic<int> playing{0};
+    std::atomic<quint64> gamesFinished{0};
+    std::atomic<quint64> moves{0};
+    std::atomic<quint64> resyncs{0};
+};
+
+// One client. Lives on one of the bot threads together with its socket.
+class LoadBot : public QObject
+{
+public:
+    LoadBot(int index, const Options& options, BotStats* stats)
+        : m_game(new CheckersGame(this))
+        , m_name(QStringLiteral("bot-%1").arg(index))
+        , m_options(options)
+        , m_stats(stats)
+        , m_random(static_cast<std::mt19937::result_type>(index + 1))
+    {
+    }
+    
+    // On the bot's thread, where the socket is created and stays
+    void start()
+    {
+        m_socket = new QTcpSocket(this);
+        connect(m_socket, &QTcpSocket::connected, this, [this]() {
+            send(MessageType::PlayerReady, Protocol::playerReadyPayload(m_name));
+        });
+        connect(m_socket, &QTcpSocket::disconnected, this, [this]() { setPlaying(false); });
+        connect(m_socket, &QTcpSocket::readyRead, this, &LoadBot::onReadyRead);
+        m_socket->connectToHost(m_options.host, m_options.port);
+    }
+    
+private:
+    void onReadyRead()
+    {
+        Protocol::ReadResult result = Protocol::readFrames(m_socket, m_reader,
+            [this](MessageType type, const QByteArray& payload) {
+                return handleMessage(type, payload);
+            });
+            
+        if (result == Protocol::ReadResult::Malformed) {
+            m_socket->abort();
+        }
+    }
+    
+    bool handleMessage(MessageType type, const QByteArray& payload)
+    {
+        switch (type) {
+            case MessageType::SeatAssignment:
+                Protocol::readSeat(payload, m_color);
+                break;
+                
+            case MessageType::PlayerReady:
+                // Paired: the game starts now, as it does for a person
+                m_game->resetGame();
+                setPlaying(true);
+                m_awaitingState = true;
+                break;
+                
+            case MessageType::StateDelta: {
+                Packed::DeltaResult result = m_game->applyStateDelta(payload);
+                if (result == Packed::DeltaResult::Applied || result == Packed::DeltaResult::AlreadyApplied) {
+                    m_awaitingState = false;
+                    play();
+                } else {
+                    requestState();
+                }
+                break;
+            }
+            
+            case MessageType::GameState: {
+                QByteArray state;
+                quint32 sequence;
+                if (Protocol::readGameState(payload, state, sequence) && m_game->deserialize(state)) {
+                    m_game->setStateSequence(sequence);
+                    m_awaitingState = false;
+                    play();
+                }
+                break;
+            }
+            
+            case MessageType::Move: {
+                Move move;
+                quint32 sequence;
+                quint64 hash;
+                if (!Protocol::readMove(payload, move, sequence, hash)) break;
+                
+                if (sequence != m_game->stateSequence() + 1 || !m_game->makeMove(move) || m_game->hash() != hash) {
+                    requestState();
+                    break;
+                }
+                m_game->setStateSequence(sequence);
+                play();
+                break;
+            }
+            
+            case MessageType::GameReset:
+                m_game->resetGame();
+                m_awaitingState = true;
+                break;
+                
+            case MessageType::Ping:
+                send(MessageType::Pong);
+                break;
+                
+            case MessageType::Disconnect:
+                setPlaying(false);
+                m_socket->disconnectFromHost();
+                return false;
+                
+            default:
+                break;
+        }
+        return true;
+    }
+    
+    // Moves if it is this bot's turn; Red also starts the next game. After
+    // a reset nobody moves until the server's delta has confirmed the new
+    // game, or a move made meanwhile would make that delta a mismatch.
+    void play()
+    {
+        if (!m_playing || m_awaitingState || m_moveScheduled) return;
+        
+        if (m_game->isGameOver() || m_game->moveHistory().size() >= m_options.maxPlies) {
+            // The server passes the reset on to Black. As on the server,
+            // only a game played to a result counts as finished.
+            if (m_color != PlayerColor::Red) return;
+            if (m_game->isGameOver()) {
+                ++m_stats->gamesFinished;
+            }
+            m_game->resetGame();
+            m_awaitingState = true;
+            send(MessageType::GameReset);
+            return;
+        }
+        if (m_game->currentPlayer() != m_color) return;
+        
+        if (m_options.delayMs > 0) {
+            m_moveScheduled = true;
+            QTimer::singleShot(m_options.delayMs, this, [this]() {
+                m_moveScheduled = false;
+                makeRandomMove();
+            });
+        } else {
+            makeRandomMove();
+        }
+    }
+    
+    void makeRandomMove()
+    {
+        // The position may have changed while the move was scheduled
+        if (!m_playing || m_awaitingState || m_game->isGameOver() || m_game->currentPlayer() != m_color) return;
+        
+        const MoveList& moves = m_game->legalMoves();
+        Move move = moves[static_cast<int>(m_random() % static_cast<unsigned>(moves.size()))];
+        m_game->makeMove(move);
+        send(MessageType::Move, Protocol::movePayload(move, m_game->stateSequence(), m_game->hash()));
+        ++m_stats->moves;
+        play();
+    }
+    
+    void setPlaying(bool playing)
+    {
+        if (playing == m_playing) return;
+        m_playing = playing;
+        m_stats->playing += playing ? 1 : -1;
+    }
+    
+    void requestState()
+    {
+        ++m_stats->resyncs;
+        send(MessageType::StateRequest);
+    }
+    
+    void send(MessageType type, const QByteArray& payload = QByteArray())
+    {
+        Protocol::writeFrame(m_socket, m_writer, type, payload);
+    }
+    
+    QTcpSocket* m_socket = nullptr;
+    CheckersGame* m_game;
+    QString m_name;
+    const Options& m_options;
+    BotStats* m_stats;
+    std::mt19937 m_random;
+    Framing::FrameReader m_reader;
+    Framing::FrameWriter m_writer;
+    PlayerColor m_color = PlayerColor::None;
+    bool m_playing = false;
+    bool m_awaitingState = false;
+    bool m_moveScheduled = false;
+};
+
+void printUsage()
+{
+    std::fprintf(stderr,
+        "Usage: checkers-loadbot [--host <address>] [--port <n>] [--games <n>] [--threads <n>]\n"
+        "                        [--seconds <n>] [--delay <ms>] [--max-plies <n>]\n");
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+    
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--host") == 0 && i + 1 < argc) {
+            options.host = QHostAddress(QString::fromLocal8Bit(argv[++i]));
+        } else if (std::strcmp(argv[i], "--port") == 0 && i + 1 < argc) {
+            options.port = static_cast<quint16>(std::atoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "--games") == 0 && i + 1 < argc) {
+            options.games = std::max(std::atoi(argv[++i]), 1);
+        } else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            options.threadCount = std::max(std::atoi(argv[++i]), 1);
+        } else if (std::strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) {
+            options.seconds = std::max(std::atoi(argv[++i]), 1);
+        } else if (std::strcmp(argv[i], "--delay") == 0 && i + 1 < argc) {
+            options.delayMs = std::max(std::atoi(argv[++i]), 0);
+        } else if (std::strcmp(argv[i], "--max-plies") == 0 && i + 1 < argc) {
+            options.maxPlies = std::max(std::atoi(argv[++i]), 1);
+        } else {
+            printUsage();
+            return 1;
+        }
+    }
+    if (options.host.isNull()) {
+        std::fprintf(stderr, "Not an IP address\n");
+        return 1;
+    }
+    
+    BotStats stats;
+    std::vector<QThread*> threads;
+    for (int i = 0; i < options.threadCount; ++i) {
+        threads.push_back(new QThread);
+        threads.back()->start();
+    }
+    
+    int botCount = options.games * 2;
+    for (int i = 0; i < botCount; ++i) {
+        QThread* thread = threads[i % threads.size()];
+        LoadBot* bot = new LoadBot(i, options, &stats);
+        bot->moveToThread(thread);
+        QObject::connect(thread, &QThread::finished, bot, &QObject::deleteLater);
+        QTimer::singleShot(i / CONNECT_BATCH * CONNECT_INTERVAL_MS, bot, [bot]() { bot->start(); });
+    }
+    
+    QElapsedTimer clock;
+    clock.start();
+    qint64 lastElapsed = 0;
+    quint64 lastMoves = 0;
+    
+    QTimer reportTimer;
+    QObject::connect(&reportTimer, &QTimer::timeout, &app, [&]() {
+        qint64 elapsed = clock.elapsed();
+        quint64 moves = stats.moves;
+        double rate = (moves - lastMoves) * 1000.0 / std::max<qint64>(elapsed - lastElapsed, 1);
+        lastElapsed = elapsed;
+        lastMoves = moves;
+        
+        std::printf("%4llds %d/%d playing, %llu games, %llu moves (%.0f/s), %llu resyncs\n",
+                    static_cast<long long>(elapsed / 1000), stats.playing.load(), botCount,
+                    static_cast<unsigned long long>(stats.gamesFinished), static_cast<unsigned long long>(moves),
+                    rate, static_cast<unsigned long long>(stats.resyncs));
+        std::fflush(stdout);
+        
+        if (elapsed >= options.seconds * 1000LL) {
+            app.quit();
+        }
+    });
+    reportTimer.start(1000);
+    
+    app.exec();
+    
+    double seconds = clock.elapsed() / 1000.0;
+    std::printf("%d games on %d threads for %.1f s: %llu moves, %.0f moves/s, %llu games finished, %llu resyncs\n",
+                options.games, options.threadCount, seconds, static_cast<unsigned long long>(stats.moves),
+                stats.moves / seconds, static_cast<unsigned long long>(stats.gamesFinished),
+                static_cast<unsigned long long>(stats.resyncs));
+    
+    for (QThread* thread : threads) {
+        thread->quit();
+        thread->wait();
+        delete thread;
+    }
+    return 0;
+}
@@ -0,0 +1,173 @@
+#include "lobbyserver.h"
+#include <QTcpSocket>
+#include <QThread>
+#include <utility>
+
+LobbyServer::LobbyServer(int ioThreads, QObject* parent)
+    : QTcpServer(parent)
+{
+#if QT_VERSION >= QT_VERSION_CHECK(6, 3, 0)
+    setListenBacklogSize(LISTEN_BACKLOG);
+#endif
+    
+    for (int i = 0; i < ioThreads; ++i) {
+        QThread* thread = new QThread(this);
+        thread->setObjectName(QStringLiteral("io-%1").arg(i));
+        
+        // Created here before the thread runs, so no socket exists yet
+        LobbyWorker* worker = new LobbyWorker(&m_stats);
+        worker->moveToThread(thread);
+        connect(thread, &QThread::finished, worker, &QObject::deleteLater);
+        
+        thread->start();
+        m_threads.append(thread);
+        m_workers.append(worker);
+    }
+}
+
+LobbyServer::~LobbyServer()
+{
+    close();
+    for (QThread* thread : m_threads) {
+        thread->quit();
+        thread->wait();
+    }
+}
+
+int LobbyServer::waitingPlayers() const
+{
+    int count = 0;
+    for (const LobbyWorker* worker : m_workers) {
+        count += worker->unpaired();
+    }
+    return count;
+}
+
+void LobbyServer::incomingConnection(qintptr descriptor)
+{
+    LobbyWorker* worker = nullptr;
+    for (LobbyWorker* candidate : m_workers) {
+        if (candidate->unpaired() % 2 != 0) {
+            worker = candidate;
+            break;
+        }
+    }
+    if (!worker) {
+        worker = m_workers[m_nextThread];
+        m_nextThread = (m_nextThread + 1) % m_workers.size();
+    }
+    
+    worker->reserve();
+    QMetaObject::invokeMethod(worker, [worker, descriptor]() { worker->accept(descriptor); }, Qt::QueuedConnection);
+}
+
+LobbyWorker::LobbyWorker(ServerStats* stats)
+    : m_stats(stats)
+{
+}
+
+void LobbyWorker::accept(qintptr descriptor)
+{
+    QTcpSocket* socket = new QTcpSocket(this);
+    if (!socket->setSocketDescriptor(descriptor)) {
+        delete socket;
+        --m_unpaired;
+        return;
+    }
+    socket->setReadBufferSize(Framing::DEFAULT_MAX_FRAME_SIZE + Framing::FRAME_OVERHEAD);
+    ++m_stats->connections;
+    
+    m_waiting.insert(socket, Waiting());
+    connect(socket, &QTcpSocket::readyRead, this, [this, socket]() { onWaitingReadyRead(socket); });
+    connect(socket, &QTcpSocket::disconnected, this, [this, socket]() { removeWaiting(socket); });
+    
+    // PlayerReady may have come with the connection
+    onWaitingReadyRead(socket);
+}
+
+void LobbyWorker::onWaitingReadyRead(QTcpSocket* socket)
+{
+    auto it = m_waiting.find(socket);
+    if (it == m_waiting.end()) return;
+    
+    // Closing the socket can remove waiting at once, so that waits until
+    // the reader is done with it
+    Waiting& waiting = it.value();
+    bool leaving = false;
+    Protocol::ReadResult result = Protocol::readFrames(socket, waiting.reader,
+        [this, socket, &waiting, &leaving](MessageType type, const QByteArray& payload) {
+            switch (type) {
+                case MessageType::PlayerReady:
+                    waiting.name = Protocol::readPlayerName(payload);
+                    if (waiting.name.isEmpty()) {
+                        waiting.name = socket->peerAddress().toString();
+                    }
+                    if (!waiting.ready) {
+                        waiting.ready = true;
+                        m_ready.append(socket);
+                    }
+                    
+                    // Once a pair is ready, leave the rest of the input
+                    // in the reader for the match
+                    return m_ready.size() < 2;
+                    
+                case MessageType::Ping:
+                    Protocol::writeFrame(socket, m_writer, MessageType::Pong);
+                    return true;
+                    
+                case MessageType::Disconnect:
+                    leaving = true;
+                    return false;
+                    
+                default:
+                    // Nothing else means anything before a game starts
+                    return true;
+            }
+        });
+        
+    if (result == Protocol::ReadResult::Malformed) {
+        socket->abort();
+        removeWaiting(socket);
+        return;
+    }
+    if (leaving) {
+        m_ready.removeOne(socket);
+        socket->disconnectFromHost();
+        return;
+    }
+    pairPlayers();
+}
+
+void LobbyWorker::removeWaiting(QTcpSocket* socket)
+{
+    if (m_waiting.remove(socket) == 0) return;
+    
+    --m_unpaired;
+    --m_stats->connections;
+    m_ready.removeOne(socket);
+    socket->deleteLater();
+}
+
+void LobbyWorker::pairPlayers()
+{
+    while (m_ready.size() >= 2) {
+        ServerMatch::Seat seats[2];
+        for (ServerMatch::Seat& seat : seats) {
+            QTcpSocket* socket = m_ready.takeFirst();
+            Waiting waiting = m_waiting.take(socket);
+            --m_unpaired;
+            
+            // The match takes the socket over; both stay on this thread
+            disconnect(socket, nullptr, this, nullptr);
+            
+            seat.socket = socket;
+            seat.name = waiting.name;
+            seat.reader = std::move(waiting.reader);
+        }
+        
+        ServerMatch* match = new ServerMatch(std::move(seats[0]), std::move(seats[1]), m_stats);
+        match->setParent(this);
+        connect(match, &ServerMatch::finished, match, &QObject::deleteLater);
+        match->start();
+    }
+}
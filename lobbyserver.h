@@ -0,0 +1,85 @@
+#ifndef LOBBYSERVER_H
+#define LOBBYSERVER_H
+
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QTcpServer>
+#include <QVector>
+#include <atomic>
+#include "servermatch.h"
+
+class QThread;
+
+// The lobby on one I/O thread. It creates the QTcpSocket for each
+// descriptor the LobbyServer hands it, reads the client's PlayerReady,
+// pairs its own waiting clients and runs their ServerMatch, all on this
+// thread, so a socket never changes threads.
+class LobbyWorker : public QObject
+{
+    Q_OBJECT
+    
+public:
+    explicit LobbyWorker(ServerStats* stats);
+    
+    // Clients handed to this worker and not in a match yet. The server
+    // counts a client in before handing its descriptor over, so its next
+    // choice of thread already sees it.
+    int unpaired() const { return m_unpaired; }
+    void reserve() { ++m_unpaired; }
+    
+public slots:
+    void accept(qintptr descriptor);
+    
+private:
+    struct Waiting {
+        Framing::FrameReader reader;
+        QString name;
+        bool ready = false;
+    };
+    
+    void onWaitingReadyRead(QTcpSocket* socket);
+    void removeWaiting(QTcpSocket* socket);
+    void pairPlayers();
+    
+    QHash<QTcpSocket*, Waiting> m_waiting; // Connected, not in a match yet
+    QList<QTcpSocket*> m_ready;            // Sent PlayerReady, oldest first
+    Framing::FrameWriter m_writer;
+    ServerStats* m_stats;
+    std::atomic<int> m_unpaired{0};
+};
+
+// Headless lobby: accepts any number of clients and pairs them into games
+// in the order they send PlayerReady, the first of each pair playing Red.
+// Each accepted descriptor goes straight to the LobbyWorker of one of a
+// fixed set of I/O threads, so the games run in parallel. Clients are only
+// paired within a thread, so a new one goes to a thread with an odd number
+// of unpaired clients if there is one, and round robin otherwise; a client
+// whose partner left before the game started waits for the next arrival.
+class LobbyServer : public QTcpServer
+{
+    Q_OBJECT
+    
+public:
+    // Pending connections the OS queues while the accepting thread is busy,
+    // where Qt lets it be set (6.3 on); before that Qt always asks for 50
+    static constexpr int LISTEN_BACKLOG = 1024;
+    
+    explicit LobbyServer(int ioThreads, QObject* parent = nullptr);
+    ~LobbyServer(); // Stops the I/O threads, ending every match
+    
+    int ioThreadCount() const { return m_threads.size(); }
+    int waitingPlayers() const;
+    const ServerStats& stats() const { return m_stats; }
+    
+protected:
+    void incomingConnection(qintptr descriptor) override;
+    
+private:
+    QVector<QThread*> m_threads;
+    QVector<LobbyWorker*> m_workers;  // One per thread, living on it
+    int m_nextThread = 0;
+    ServerStats m_stats;
+};
+
+#endif // LOBBYSERVER_H
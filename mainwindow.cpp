@@ -1,6 +1,11 @@
 #include "mainwindow.h"
 #include "./ui_mainwindow.h"
 #include "connectiondialog.h"
+#include <QCoreApplication>
+#include <QDate>
+#include <QFile>
+#include <QFileDialog>
+#include <QFileInfo>
 #include <QVBoxLayout>
 #include <QHBoxLayout>
 #include <QGroupBox>
@@ -14,12 +19,18 @@ MainWindow::MainWindow(QWidget *parent)
     , m_game(new CheckersGame(this))
     , m_boardWidget(new CheckerBoardWidget(this))
     , m_networkManager(new NetworkManager(this))
+    , m_aiPlayer(new AiPlayer(this))
+    , m_analyzer(new Analyzer(this))
 {
     ui->setupUi(this);
     
     setWindowTitle(tr("LAN Checkers"));
     setMinimumSize(900, 700);
     
+    // Before the menus, which only offer what was found
+    loadTablebases();
+    loadOpeningBook();
+    
     setupUI();
     setupMenus();
     setupConnections();
@@ -27,6 +38,7 @@ MainWindow::MainWindow(QWidget *parent)
     // Initial state
     m_boardWidget->setGame(m_game);
     m_boardWidget->setInteractive(false);
+    m_networkManager->setGame(m_game);
     updateStatus();
 }
 
@@ -35,6 +47,29 @@ MainWindow::~MainWindow()
     delete ui;
 }
 
+void MainWindow::loadTablebases()
+{
+    // Generated with checkers-tbgen into a "tablebases" folder next to the executable
+    std::shared_ptr<Tablebase> tablebase = std::make_shared<Tablebase>();
+    QString directory = QCoreApplication::applicationDirPath() + "/tablebases";
+    if (tablebase->load(directory.toStdString()) == 0) return;
+    
+    m_game->setTablebase(tablebase);
+    m_aiPlayer->setTablebase(tablebase);
+    m_analyzer->setTablebase(tablebase);
+}
+
+void MainWindow::loadOpeningBook()
+{
+    // Built with checkers-bookgen; mapped, not parsed, so this costs nothing
+    std::shared_ptr<OpeningBook> book = std::make_shared<OpeningBook>();
+    QString path = QCoreApplication::applicationDirPath() + "/book.ckb";
+    if (!book->load(path.toStdString())) return;
+    
+    m_openingBook = book;
+    m_aiPlayer->setOpeningBook(book);
+}
+
 void MainWindow::setupUI()
 {
     QWidget* centralWidget = new QWidget(this);
@@ -84,6 +119,12 @@ void MainWindow::setupUI()
     connect(m_newGameButton, &QPushButton::clicked, this, &MainWindow::onNewGame);
     buttonLayout->addWidget(m_newGameButton);
     
+    m_hintButton = new QPushButton(tr("Hint"));
+    m_hintButton->setCheckable(true);
+    m_hintButton->setToolTip(tr("Analyze the position in the background and show the best move"));
+    connect(m_hintButton, &QPushButton::toggled, this, &MainWindow::onHintToggled);
+    buttonLayout->addWidget(m_hintButton);
+    
     connectionLayout->addLayout(buttonLayout);
     rightLayout->addWidget(connectionGroup);
     
@@ -148,6 +189,30 @@ void MainWindow::setupMenus()
     newGameAction->setShortcut(QKeySequence::New);
     connect(newGameAction, &QAction::triggered, this, &MainWindow::onNewGame);
     
+    QAction* computerAction = gameMenu->addAction(tr("Play vs &Computer"));
+    connect(computerAction, &QAction::triggered, this, &MainWindow::onPlayComputer);
+    
+    QAction* openAction = gameMenu->addAction(tr("&Open Game..."));
+    openAction->setShortcut(QKeySequence::Open);
+    connect(openAction, &QAction::triggered, this, &MainWindow::onOpenGame);
+    
+    QAction* saveAction = gameMenu->addAction(tr("&Save Game..."));
+    saveAction->setShortcut(QKeySequence::Save);
+    connect(saveAction, &QAction::triggered, this, &MainWindow::onSaveGame);
+    
+    QAction* ponderAction = gameMenu->addAction(tr("Computer &Ponders"));
+    ponderAction->setCheckable(true);
+    ponderAction->setChecked(m_aiPlayer->ponderEnabled());
+    connect(ponderAction, &QAction::toggled, m_aiPlayer, &AiPlayer::setPonderEnabled);
+    
+    QAction* bookAction = gameMenu->addAction(tr("Show &Book Moves"));
+    bookAction->setCheckable(true);
+    bookAction->setEnabled(m_openingBook != nullptr);
+    connect(bookAction, &QAction::toggled, this, [this](bool checked) {
+        m_showBookMoves = checked;
+        updateBookMoves();
+    });
+    
     gameMenu->addSeparator();
     
     QAction* exitAction = gameMenu->addAction(tr("E&xit"));
@@ -186,8 +251,14 @@ void MainWindow::setupConnections()
             this, &MainWindow::onGameStateReceived);
     connect(m_networkManager, &NetworkManager::gameResetReceived, 
             this, &MainWindow::onGameResetReceived);
+    connect(m_networkManager, &NetworkManager::stateDeltaReceived, 
+            this, &MainWindow::onStateDeltaReceived);
+    connect(m_networkManager, &NetworkManager::stateRequestReceived, 
+            this, &MainWindow::onStateRequestReceived);
     connect(m_networkManager, &NetworkManager::chatMessageReceived, 
             this, &MainWindow::onChatMessageReceived);
+    connect(m_networkManager, &NetworkManager::spectatorsChanged, 
+            this, &MainWindow::updateStatus);
     
     // Game signals
     connect(m_game, &CheckersGame::turnChanged, 
@@ -198,6 +269,18 @@ void MainWindow::setupConnections()
     // Board widget signals
     connect(m_boardWidget, &CheckerBoardWidget::moveRequested, 
             this, &MainWindow::onMoveRequested);
+    
+    // Computer opponent signals
+    connect(m_aiPlayer, &AiPlayer::moveChosen, 
+            this, &MainWindow::onMoveRequested);
+    connect(m_aiPlayer, &AiPlayer::searchInfo, 
+            this, &MainWindow::onComputerSearchInfo);
+    
+    // Hint analysis; any change to the board makes the current one stale
+    connect(m_game, &CheckersGame::boardChanged, 
+            this, &MainWindow::restartAnalysis);
+    connect(m_analyzer, &Analyzer::analysisUpdated, 
+            m_boardWidget, &CheckerBoardWidget::setAnalysis);
 }
 
 void MainWindow::onConnect()
@@ -220,12 +303,21 @@ void MainWindow::onConnect()
         }
     });
     
+    connect(&dialog, &ConnectionDialog::watchRequested, 
+            this, [this](const QString& name, const QString& host, quint16 port) {
+        m_playerName = name;
+        if (!m_networkManager->watchGame(name, QHostAddress(host), port)) {
+            // Error is emitted by networkManager
+        }
+    });
+    
     dialog.exec();
     updateStatus();
 }
 
 void MainWindow::onDisconnect()
 {
+    stopComputerGame();
     m_networkManager->disconnect();
     m_gameStarted = false;
     m_boardWidget->setInteractive(false);
@@ -237,11 +329,14 @@ void MainWindow::onDisconnect()
 
 void MainWindow::onConnected()
 {
+    stopComputerGame();
     updateStatus();
     
     if (m_networkManager->isHost()) {
         appendChatMessage("", tr("Hosting game. Waiting for opponent..."), true);
         m_statusLabel->setText(tr("Hosting - Waiting for opponent"));
+    } else if (m_networkManager->isSpectator()) {
+        appendChatMessage("", tr("Watching the host's game."), true);
     } else {
         appendChatMessage("", tr("Connected to host."), true);
     }
@@ -275,6 +370,12 @@ void MainWindow::onOpponentDisconnected()
     m_gameStarted = false;
     m_boardWidget->setInteractive(false);
     updateStatus();
+    
+    if (m_networkManager->isSpectator()) {
+        appendChatMessage("", tr("The host has closed the game."), true);
+        return;
+    }
+    
     appendChatMessage("", tr("Opponent disconnected."), true);
     
     QMessageBox::information(this, tr("Opponent Left"), 
@@ -283,15 +384,17 @@ void MainWindow::onOpponentDisconnected()
 
 void MainWindow::startGame()
 {
+    stopComputerGame();
     m_gameStarted = true;
     m_game->resetGame();
     
     // Set up board for local player
     m_boardWidget->setLocalPlayerColor(m_networkManager->localPlayerColor());
     
-    // Host sends initial game state
+    // Both sides have just reset, so the host's initial state is an empty
+    // delta that only confirms the client is on the same position
     if (m_networkManager->isHost()) {
-        m_networkManager->sendGameState(m_game);
+        m_networkManager->sendStateDelta(m_game, m_game->position());
         m_networkManager->sendGameStart();
     }
     
@@ -302,27 +405,187 @@ void MainWindow::startGame()
         .arg(m_game->currentPlayer() == PlayerColor::Red ? tr("Red") : tr("Black")), true);
 }
 
-void MainWindow::onMoveReceived(const Move& move)
+void MainWindow::onPlayComputer()
 {
-    // Apply opponent's move
-    if (m_game->makeMove(move)) {
+    if (m_networkManager->isConnected() || m_networkManager->isHost()) {
+        if (QMessageBox::question(this, tr("Play vs Computer"),
+                tr("This will leave the network game. Continue?"),
+                QMessageBox::Yes | QMessageBox::No) != QMessageBox::Yes) {
+            return;
+        }
+        onDisconnect();
+    }
+    
+    // The human plays Red and moves first
+    m_vsComputer = true;
+    m_gameStarted = true;
+    m_aiPlayer->setColor(PlayerColor::Black);
+    m_boardWidget->setLocalPlayerColor(localPlayerColor());
+    
+    updateStatus();
+    m_game->resetGame();
+    
+    appendChatMessage("", tr("New game against the computer. You play Red and move first."), true);
+}
+
+void MainWindow::onOpenGame()
+{
+    // A network game's position belongs to both players
+    if (m_networkManager->isConnected() || m_networkManager->isHost()) {
+        QMessageBox::information(this, tr("Open Game"),
+            tr("Disconnect from the network game before opening a saved one."));
+        return;
+    }
+    
+    QString path = QFileDialog::getOpenFileName(this, tr("Open Game"), QString(),
+                                                tr("PDN games (*.pdn);;All files (*)"));
+    if (path.isEmpty()) return;
+    
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        QMessageBox::warning(this, tr("Open Game"), tr("Cannot open %1.").arg(path));
+        return;
+    }
+    
+    // Replays and checks every move; the current game is kept on failure
+    QString error;
+    if (!m_game->loadPdn(QString::fromUtf8(file.readAll()), &error)) {
+        QMessageBox::warning(this, tr("Open Game"),
+            tr("%1 is not a valid game:\n%2").arg(QFileInfo(path).fileName(), error));
+        return;
+    }
+    
+    updateGameControls();
+    appendChatMessage("", tr("Loaded %1 (%2 moves).")
+        .arg(QFileInfo(path).fileName()).arg(m_game->moveHistory().size()), true);
+}
+
+void MainWindow::onSaveGame()
+{
+    QString path = QFileDialog::getSaveFileName(this, tr("Save Game"), QStringLiteral("game.pdn"),
+                                                tr("PDN games (*.pdn);;All files (*)"));
+    if (path.isEmpty()) return;
+    
+    QString localName = m_playerName.isEmpty() ? tr("Player") : m_playerName;
+    QString opponentName = m_vsComputer ? tr("Computer") : m_networkManager->opponentName();
+    bool localIsRed = (localPlayerColor() == PlayerColor::Red);
+    
+    // PDN's White is Red
+    QMap<QString, QString> tags;
+    tags.insert(QStringLiteral("Event"), m_vsComputer ? tr("Game against the computer") : tr("LAN game"));
+    tags.insert(QStringLiteral("Date"), QDate::currentDate().toString(QStringLiteral("yyyy.MM.dd")));
+    tags.insert(QStringLiteral("White"), localIsRed ? localName : opponentName);
+    tags.insert(QStringLiteral("Black"), localIsRed ? opponentName : localName);
+    
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text | QIODevice::Truncate)
+        || file.write(m_game->toPdn(tags).toUtf8()) < 0) {
+        QMessageBox::warning(this, tr("Save Game"), tr("Cannot write %1.").arg(path));
+        return;
+    }
+    
+    appendChatMessage("", tr("Game saved to %1.").arg(QFileInfo(path).fileName()), true);
+}
+
+void MainWindow::stopComputerGame()
+{
+    if (!m_vsComputer) return;
+    
+    m_vsComputer = false;
+    m_gameStarted = false;
+    m_aiPlayer->stop();
+    ui->statusbar->clearMessage();
+}
+
+PlayerColor MainWindow::localPlayerColor() const
+{
+    if (m_vsComputer) {
+        return Position::opponent(m_aiPlayer->color());
+    }
+    return m_networkManager->localPlayerColor();
+}
+
+void MainWindow::onMoveReceived(const Move& move, quint32 sequence, quint64 hash)
+{
+    // Apply opponent's move; if it doesn't follow the last state we had,
+    // doesn't apply or leaves a different position than the sender's, the
+    // boards have drifted apart
+    if (sequence != m_game->stateSequence() + 1 || !m_game->makeMove(move) || m_game->hash() != hash) {
+        resyncState();
         updateGameControls();
+        return;
     }
+    
+    // The host numbers the states, and shows its spectators only the moves
+    // it accepted
+    if (m_networkManager->isHost()) {
+        m_networkManager->relayMove(move, m_game);
+    } else {
+        m_game->setStateSequence(sequence);
+    }
+    updateGameControls();
+}
+
+void MainWindow::onGameStateReceived(const QByteArray& state, quint32 sequence)
+{
+    if (!m_game->deserialize(state)) {
+        appendChatMessage("", tr("Received an unreadable game state; the board was left as it is."), true);
+        return;
+    }
+    m_game->setStateSequence(sequence);
+    updateGameControls();
 }
 
-void MainWindow::onGameStateReceived(const QByteArray& state)
+void MainWindow::onStateDeltaReceived(const QByteArray& delta)
 {
-    m_game->deserialize(state);
+    switch (m_game->applyStateDelta(delta)) {
+        case Packed::DeltaResult::Applied:
+        case Packed::DeltaResult::AlreadyApplied:
+            break;
+            
+        case Packed::DeltaResult::Mismatch:
+        case Packed::DeltaResult::OutOfSequence:
+        case Packed::DeltaResult::Invalid:
+            resyncState();
+            break;
+    }
     updateGameControls();
 }
 
+void MainWindow::onStateRequestReceived()
+{
+    if (m_networkManager->isHost()) {
+        m_networkManager->sendGameState(m_game);
+    }
+}
+
+// The host's board is authoritative: it resends its full state, and the
+// client asks for it
+void MainWindow::resyncState()
+{
+    // A spectator's board is only ever fixed quietly from the host's
+    if (m_networkManager->isSpectator()) {
+        m_networkManager->sendStateRequest();
+        return;
+    }
+    
+    appendChatMessage("", tr("The board is out of sync with your opponent's; resynchronising."), true);
+    
+    if (m_networkManager->isHost()) {
+        m_networkManager->sendGameState(m_game);
+    } else {
+        m_networkManager->sendStateRequest();
+    }
+}
+
 void MainWindow::onGameResetReceived()
 {
+    Position before = m_game->position();
     m_game->resetGame();
     
-    // Host sends new game state
+    // Host confirms the new game state as a delta from the old one
     if (m_networkManager->isHost()) {
-        m_networkManager->sendGameState(m_game);
+        m_networkManager->sendStateDelta(m_game, before);
     }
     
     updateGameControls();
@@ -331,6 +594,8 @@ void MainWindow::onGameResetReceived()
 
 void MainWindow::onNewGame()
 {
+    if (m_networkManager->isSpectator() && m_networkManager->isConnected()) return;
+    
     if (!m_networkManager->isConnected()) {
         m_game->resetGame();
         return;
@@ -340,9 +605,12 @@ void MainWindow::onNewGame()
             tr("Start a new game? This will reset the current game."),
             QMessageBox::Yes | QMessageBox::No) == QMessageBox::Yes) {
         
+        Position before = m_game->position();
         m_game->resetGame();
         m_networkManager->sendGameReset();
-        m_networkManager->sendGameState(m_game);
+        if (m_networkManager->isHost()) {
+            m_networkManager->sendStateDelta(m_game, before);
+        }
         
         updateGameControls();
         appendChatMessage("", tr("Game has been reset."), true);
@@ -351,11 +619,40 @@ void MainWindow::onNewGame()
 
 void MainWindow::onTurnChanged(PlayerColor player)
 {
+    // Whatever the computer was thinking about no longer applies, except
+    // against the computer itself, which checks its ponder against the
+    // position it is given
+    if (!m_vsComputer) {
+        m_aiPlayer->stop();
+    }
+    
     updateGameControls();
     
     QString playerName = (player == PlayerColor::Red) ? tr("Red") : tr("Black");
     
-    if (m_networkManager->isConnected()) {
+    if (m_vsComputer) {
+        if (player == m_aiPlayer->color()) {
+            m_turnLabel->setText(tr("Computer is thinking (%1)").arg(playerName));
+            m_turnLabel->setStyleSheet("font-size: 18px; font-weight: bold; padding: 10px; color: gray;");
+            
+            // turnChanged comes before gameOver, so check for a move first
+            if (m_gameStarted && !m_game->legalMoves().isEmpty()) {
+                m_aiPlayer->startThinking(m_game->position());
+            } else {
+                m_aiPlayer->stop();
+            }
+        } else {
+            m_turnLabel->setText(tr("Your turn (%1)").arg(playerName));
+            m_turnLabel->setStyleSheet("font-size: 18px; font-weight: bold; padding: 10px; color: green;");
+            
+            // Think on the player's time
+            if (m_gameStarted) {
+                m_aiPlayer->startPondering(m_game->position());
+            } else {
+                m_aiPlayer->stop();
+            }
+        }
+    } else if (m_networkManager->isConnected() && !m_networkManager->isSpectator()) {
         bool isMyTurn = (player == m_networkManager->localPlayerColor());
         if (isMyTurn) {
             m_turnLabel->setText(tr("Your turn (%1)").arg(playerName));
@@ -368,6 +665,18 @@ void MainWindow::onTurnChanged(PlayerColor player)
         m_turnLabel->setText(tr("%1's turn").arg(playerName));
         m_turnLabel->setStyleSheet("font-size: 18px; font-weight: bold; padding: 10px;");
     }
+    
+    Tablebase::Entry entry;
+    if (m_gameStarted && m_game->probeTablebase(entry)) {
+        QString opponentName = (player == PlayerColor::Red) ? tr("Black") : tr("Red");
+        if (entry.result == Tablebase::Result::Win) {
+            ui->statusbar->showMessage(tr("Endgame database: %1 wins in %2 plies").arg(playerName).arg(entry.plies));
+        } else if (entry.result == Tablebase::Result::Loss) {
+            ui->statusbar->showMessage(tr("Endgame database: %1 wins in %2 plies").arg(opponentName).arg(entry.plies));
+        } else {
+            ui->statusbar->showMessage(tr("Endgame database: draw"));
+        }
+    }
 }
 
 void MainWindow::onGameOver(PlayerColor winner)
@@ -377,16 +686,17 @@ void MainWindow::onGameOver(PlayerColor winner)
     
     QString winnerName = (winner == PlayerColor::Red) ? tr("Red") : tr("Black");
     
-    bool isLocalWinner = (winner == m_networkManager->localPlayerColor());
+    bool isLocalWinner = (winner == localPlayerColor());
+    QString opponentName = m_vsComputer ? tr("The computer") : m_networkManager->opponentName();
     
     QString message;
-    if (m_networkManager->isConnected()) {
+    if (m_networkManager->isConnected() || m_vsComputer) {
         if (isLocalWinner) {
             message = tr("Congratulations! You won!");
             m_turnLabel->setText(tr("You Won!"));
             m_turnLabel->setStyleSheet("font-size: 18px; font-weight: bold; padding: 10px; color: gold;");
         } else {
-            message = tr("%1 wins! Better luck next time.").arg(m_networkManager->opponentName());
+            message = tr("%1 wins! Better luck next time.").arg(opponentName);
             m_turnLabel->setText(tr("You Lost"));
             m_turnLabel->setStyleSheet("font-size: 18px; font-weight: bold; padding: 10px; color: red;");
         }
@@ -402,19 +712,57 @@ void MainWindow::onGameOver(PlayerColor winner)
 
 void MainWindow::onMoveRequested(const Move& move)
 {
+    // The computer moves for its own colour, the board for the local player
+    PlayerColor mover = (sender() == m_aiPlayer) ? m_aiPlayer->color() : localPlayerColor();
+    
     // Check if it's our turn
-    if (!m_gameStarted || m_game->currentPlayer() != m_networkManager->localPlayerColor()) {
+    if (!m_gameStarted || m_game->currentPlayer() != mover) {
         return;
     }
     
     // Make the move locally
     if (m_game->makeMove(move)) {
         // Send move to opponent
-        m_networkManager->sendMove(move);
+        if (m_networkManager->isConnected()) {
+            m_networkManager->sendMove(move, m_game);
+        }
         updateGameControls();
     }
 }
 
+void MainWindow::onComputerSearchInfo(const SearchInfo& info)
+{
+    if (info.fromBook) {
+        ui->statusbar->showMessage(tr("Computer: book move"));
+        return;
+    }
+    
+    ui->statusbar->showMessage(tr("Computer: depth %1, score %2, %3 nodes, %4 knodes/s")
+        .arg(info.depth)
+        .arg(info.score)
+        .arg(info.nodes)
+        .arg(info.nodesPerSecond() / 1000));
+}
+
+void MainWindow::onHintToggled(bool enabled)
+{
+    if (enabled) {
+        restartAnalysis();
+    } else {
+        m_analyzer->stop();
+        m_boardWidget->clearAnalysis();
+    }
+}
+
+void MainWindow::restartAnalysis()
+{
+    // Cancelling never waits for the old search, so this is cheap enough
+    // to run on every board change
+    if (m_hintButton->isChecked()) {
+        m_analyzer->analyze(m_game->position());
+    }
+}
+
 void MainWindow::updateGameControls()
 {
     if (!m_gameStarted || m_game->isGameOver()) {
@@ -423,27 +771,49 @@ void MainWindow::updateGameControls()
         return;
     }
     
-    bool isMyTurn = (m_game->currentPlayer() == m_networkManager->localPlayerColor());
+    bool isMyTurn = (m_game->currentPlayer() == localPlayerColor());
     m_boardWidget->setInteractive(isMyTurn);
     
     if (isMyTurn) {
         // Highlight pieces that can move
-        QVector<QPoint> movable = m_game->getAllMovablePieces(m_networkManager->localPlayerColor());
+        QVector<QPoint> movable = m_game->getAllMovablePieces(localPlayerColor());
         m_boardWidget->highlightMovablePieces(movable);
     } else {
         m_boardWidget->clearHighlights();
     }
+    
+    updateBookMoves();
+}
+
+void MainWindow::updateBookMoves()
+{
+    MoveList moves;
+    bool isMyTurn = m_gameStarted && !m_game->isGameOver() && m_game->currentPlayer() == localPlayerColor();
+    if (m_showBookMoves && m_openingBook && isMyTurn) {
+        for (const OpeningBook::BookMove& bookMove : m_openingBook->probe(m_game->position())) {
+            moves.append(bookMove.move);
+        }
+    }
+    m_boardWidget->setBookMoves(moves);
 }
 
 void MainWindow::updateStatus()
 {
     bool connected = m_networkManager->isConnected();
+    bool spectator = m_networkManager->isSpectator();
     
-    m_chatInput->setEnabled(connected);
-    m_sendChatButton->setEnabled(connected);
-    m_newGameButton->setEnabled(connected && m_gameStarted);
+    // The host does not pass chat on to spectators, or theirs to the players
+    m_chatInput->setEnabled(connected && !spectator);
+    m_sendChatButton->setEnabled(connected && !spectator);
+    m_newGameButton->setEnabled((connected && m_gameStarted) || m_vsComputer);
     
-    if (!connected && !m_networkManager->isHost()) {
+    if (m_vsComputer) {
+        m_statusLabel->setText(tr("Playing against the computer"));
+        m_statusLabel->setStyleSheet("font-weight: bold; color: green;");
+        m_playerInfoLabel->setText(tr("You: Red"));
+        m_opponentInfoLabel->setText(tr("Opponent: Computer (Black)"));
+        m_connectButton->setText(tr("Connect"));
+    } else if (!connected && !m_networkManager->isHost()) {
         m_statusLabel->setText(tr("Not connected"));
         m_statusLabel->setStyleSheet("font-weight: bold; color: gray;");
         m_playerInfoLabel->clear();
@@ -457,8 +827,15 @@ void MainWindow::updateStatus()
         m_playerInfoLabel->setText(tr("You: %1 (Red)").arg(m_playerName));
         m_opponentInfoLabel->setText(tr("Opponent: Waiting..."));
         m_connectButton->setText(tr("Disconnect"));
+    } else if (spectator) {
+        m_statusLabel->setText(tr("Watching"));
+        m_statusLabel->setStyleSheet("font-weight: bold; color: green;");
+        m_playerInfoLabel->setText(tr("You: %1 (spectator)").arg(m_playerName));
+        m_opponentInfoLabel->setText(tr("Red: host, Black: guest"));
+        m_connectButton->setText(tr("Disconnect"));
     } else if (connected) {
-        m_statusLabel->setText(tr("Connected"));
+        int spectators = m_networkManager->spectatorCount();
+        m_statusLabel->setText(spectators > 0 ? tr("Connected - %n watching", "", spectators) : tr("Connected"));
         m_statusLabel->setStyleSheet("font-weight: bold; color: green;");
         
         QString myColor = (m_networkManager->localPlayerColor() == PlayerColor::Red) ? tr("Red") : tr("Black");
@@ -9,6 +9,8 @@
 #include "checkersgame.h"
 #include "checkerboardwidget.h"
 #include "networkmanager.h"
+#include "aiplayer.h"
+#include "analyzer.h"
 
 QT_BEGIN_NAMESPACE
 namespace Ui {
@@ -27,6 +29,9 @@ public:
 private slots:
     // Menu actions
     void onNewGame();
+    void onPlayComputer();
+    void onOpenGame();
+    void onSaveGame();
     void onConnect();
     void onDisconnect();
     
@@ -36,8 +41,10 @@ private slots:
     void onConnectionError(const QString& error);
     void onOpponentConnected(const QString& name);
     void onOpponentDisconnected();
-    void onMoveReceived(const Move& move);
-    void onGameStateReceived(const QByteArray& state);
+    void onMoveReceived(const Move& move, quint32 sequence, quint64 hash);
+    void onGameStateReceived(const QByteArray& state, quint32 sequence);
+    void onStateDeltaReceived(const QByteArray& delta);
+    void onStateRequestReceived();
     void onGameResetReceived();
     
     // Game events
@@ -45,6 +52,13 @@ private slots:
     void onGameOver(PlayerColor winner);
     void onMoveRequested(const Move& move);
     
+    // Computer opponent
+    void onComputerSearchInfo(const SearchInfo& info);
+    
+    // Hint analysis
+    void onHintToggled(bool enabled);
+    void restartAnalysis();
+    
     // Chat
     void onSendChat();
     void onChatMessageReceived(const QString& from, const QString& message);
@@ -53,10 +67,16 @@ private:
     void setupUI();
     void setupMenus();
     void setupConnections();
+    void loadTablebases();
+    void loadOpeningBook();
+    void updateBookMoves();
     void updateStatus();
     void updateGameControls();
     void appendChatMessage(const QString& from, const QString& message, bool isSystem = false);
     void startGame();
+    void stopComputerGame();
+    void resyncState();
+    PlayerColor localPlayerColor() const;
     
     Ui::MainWindow *ui;
     
@@ -64,6 +84,9 @@ private:
     CheckersGame* m_game;
     CheckerBoardWidget* m_boardWidget;
     NetworkManager* m_networkManager;
+    AiPlayer* m_aiPlayer;
+    Analyzer* m_analyzer;
+    std::shared_ptr<const OpeningBook> m_openingBook;
     
     // UI components
     QLabel* m_statusLabel;
@@ -74,10 +97,13 @@ private:
     QLineEdit* m_chatInput;
     QPushButton* m_sendChatButton;
     QPushButton* m_newGameButton;
+    QPushButton* m_hintButton;
     QPushButton* m_connectButton;
     
     // State
     bool m_gameStarted = false;
+    bool m_vsComputer = false;
+    bool m_showBookMoves = false;
     QString m_playerName;
 };
 
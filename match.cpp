@@ -0,0 +1,541 @@
+#include "openingbook.h"
+#include "search.h"
+#include "tablebase.h"
+#include "threadpool.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Engine-vs-engine match runner.
+//
+//   checkers-match [options]
+//
+// Plays two engine configurations against each other, one game per thread
+// on a work-stealing pool. Every opening is played twice with the colours
+// reversed. Running Elo and SPRT figures are printed as games finish and
+// each game is appended to the output file as one line:
+//
+//   <red> <black> <result> <plies> <reason> : <moves>
+//
+// Options:
+//   --engine1 <spec>        First engine (default: "name=engine1")
+//   --engine2 <spec>        Second engine (default: "name=engine2")
+//   --games <n>             Games to play (default: two per opening)
+//   --concurrency <n>       Games played at once (default: all cores)
+//   --opening-plies <n>     Openings are every distinct position this many plies
+//                           from the start (default: 3)
+//   --openings <file>       Or read them from a file, one FEN per line
+//   --max-plies <n>         Longer games are drawn (default: 300)
+//   --adjudicate <dir>      Finish games once they reach these endgame tablebases
+//   --sprt <elo0> <elo1>    Stop once the SPRT accepts either hypothesis
+//   --alpha <a> --beta <b>  SPRT error rates (default: 0.05)
+//   --output <file>         Append finished games here
+//   --seed <n>              Opening order (default: 1)
+//
+// An engine spec is comma-separated key=value pairs: name, movetime (ms),
+// nodes, depth, hash (MB), threads, book (file), tablebase (directory).
+// Without movetime, nodes or depth an engine searches 100 ms per move.
+
+namespace {
+
+enum class GameResult {
+    RedWin,
+    BlackWin,
+    Draw
+};
+
+struct EngineSpec {
+    std::string name;
+    SearchLimits limits;
+    std::size_t hashMegabytes = 16;
+    int threadCount = 1;
+    std::shared_ptr<const OpeningBook> book;
+    std::shared_ptr<const Tablebase> tablebase;
+};
+
+struct Options {
+    EngineSpec engines[2];
+    int games = 0;
+    int concurrency = 1;
+    int openingPlies = 3;
+    std::string openingsPath;
+    int maxPlies = 300;
+    std::shared_ptr<const Tablebase> adjudication;
+    bool sprt = false;
+    double elo0 = 0.0;
+    double elo1 = 5.0;
+    double alpha = 0.05;
+    double beta = 0.05;
+    std::string outputPath;
+    std::uint64_t seed = 1;
+};
+
+void printUsage()
+{
+    std::fprintf(stderr,
+        "Usage: checkers-match [--engine1 <spec>] [--engine2 <spec>] [--games <n>] [--concurrency <n>]\n"
+        "                      [--opening-plies <n>] [--openings <file>] [--max-plies <n>] [--adjudicate <dir>]\n"
+        "                      [--sprt <elo0> <elo1>] [--alpha <a>] [--beta <b>] [--output <file>] [--seed <n>]\n"
+        "Engine spec: name=<s>,movetime=<ms>,nodes=<n>,depth=<n>,hash=<mb>,threads=<n>,book=<file>,tablebase=<dir>\n");
+}
+
+bool parseEngineSpec(const std::string& spec, EngineSpec& engine)
+{
+    bool limited = false;
+    std::size_t start = 0;
+    while (start < spec.size()) {
+        std::size_t end = spec.find(',', start);
+        if (end == std::string::npos) end = spec.size();
+        std::string item = spec.substr(start, end - start);
+        start = end + 1;
+        
+        std::size_t equals = item.find('=');
+        if (equals == std::string::npos) {
+            std::fprintf(stderr, "Bad engine option: %s\n", item.c_str());
+            return false;
+        }
+        std::string key = item.substr(0, equals);
+        std::string value = item.substr(equals + 1);
+        
+        if (key == "name") {
+            engine.name = value;
+        } else if (key == "movetime") {
+            engine.limits.moveTimeMs = std::atoi(value.c_str());
+            limited = true;
+        } else if (key == "nodes") {
+            engine.limits.maxNodes = std::strtoull(value.c_str(), nullptr, 10);
+            limited = true;
+        } else if (key == "depth") {
+            engine.limits.maxDepth = std::max(std::atoi(value.c_str()), 1);
+            limited = true;
+        } else if (key == "hash") {
+            engine.hashMegabytes = static_cast<std::size_t>(std::max(std::atoi(value.c_str()), 1));
+        } else if (key == "threads") {
+            engine.threadCount = std::max(std::atoi(value.c_str()), 1);
+        } else if (key == "book") {
+            auto book = std::make_shared<OpeningBook>();
+            if (!book->load(value)) {
+                std::fprintf(stderr, "Cannot open book %s\n", value.c_str());
+                return false;
+            }
+            engine.book = book;
+        } else if (key == "tablebase") {
+            auto tablebase = std::make_shared<Tablebase>();
+            if (tablebase->load(value) == 0) {
+                std::fprintf(stderr, "No tablebase files in %s\n", value.c_str());
+                return false;
+            }
+            engine.tablebase = tablebase;
+        } else {
+            std::fprintf(stderr, "Unknown engine option: %s\n", key.c_str());
+            return false;
+        }
+    }
+    
+    if (!limited) {
+        engine.limits.moveTimeMs = 100;
+    }
+    return true;
+}
+
+// Every distinct position plies moves from the start, in a seeded random order
+std::vector<Position> generateOpenings(int plies, std::uint64_t seed)
+{
+    std::vector<Position> openings(1);
+    for (int ply = 0; ply < plies; ++ply) {
+        std::vector<Position> next;
+        std::vector<std::uint64_t> seen;
+        for (const Position& position : openings) {
+            MoveList moves;
+            position.generateMoves(moves);
+            for (const Move& move : moves) {
+                Position child = position;
+                UndoRecord undo;
+                child.doMove(move, undo);
+                if (std::find(seen.begin(), seen.end(), child.hash()) != seen.end()) continue;
+                seen.push_back(child.hash());
+                next.push_back(child);
+            }
+        }
+        if (next.empty()) break;
+        openings = std::move(next);
+    }
+    
+    std::mt19937_64 random(seed);
+    std::shuffle(openings.begin(), openings.end(), random);
+    return openings;
+}
+
+bool readOpenings(const std::string& path, std::vector<Position>& openings)
+{
+    std::ifstream in(path);
+    if (!in) {
+        std::fprintf(stderr, "Cannot read %s\n", path.c_str());
+        return false;
+    }
+    
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        Position position;
+        if (!position.fromFen(line)) {
+            std::fprintf(stderr, "Skipping invalid FEN: %s\n", line.c_str());
+            continue;
+        }
+        openings.push_back(position);
+    }
+    return !openings.empty();
+}
+
+// Results from the first engine's point of view, with Elo and a
+// generalised SPRT on the per-game scores
+class MatchStats
+{
+public:
+    void add(double score)
+    {
+        if (score > 0.75) {
+            ++m_wins;
+        } else if (score < 0.25) {
+            ++m_losses;
+        } else {
+            ++m_draws;
+        }
+    }
+    
+    int games() const { return m_wins + m_draws + m_losses; }
+    
+    double score() const
+    {
+        return games() ? (m_wins + 0.5 * m_draws) / games() : 0.5;
+    }
+    
+    // Variance of a single game's score
+    double variance() const
+    {
+        if (games() == 0) return 0.0;
+        double s = score();
+        return (m_wins * (1 - s) * (1 - s) + m_draws * (0.5 - s) * (0.5 - s) + m_losses * s * s) / games();
+    }
+    
+    static double scoreToElo(double score)
+    {
+        score = std::min(std::max(score, 1e-6), 1 - 1e-6);
+        return -400.0 * std::log10(1.0 / score - 1.0);
+    }
+    
+    static double eloToScore(double elo)
+    {
+        return 1.0 / (1.0 + std::pow(10.0, -elo / 400.0));
+    }
+    
+    double elo() const { return scoreToElo(score()); }
+    
+    // Half the width of the 95% confidence interval
+    double eloMargin() const
+    {
+        if (games() == 0) return 0.0;
+        double deviation = std::sqrt(variance() / games());
+        return (scoreToElo(score() + 1.96 * deviation) - scoreToElo(score() - 1.96 * deviation)) / 2;
+    }
+    
+    double llr(double elo0, double elo1) const
+    {
+        double var = variance();
+        if (games() == 0 || var <= 0.0) return 0.0;
+        double s0 = eloToScore(elo0);
+        double s1 = eloToScore(elo1);
+        return games() * (s1 - s0) * (2 * score() - s0 - s1) / (2 * var);
+    }
+    
+    int wins() const { return m_wins; }
+    int draws() const { return m_draws; }
+    int losses() const { return m_losses; }
+    
+private:
+    int m_wins = 0;
+    int m_draws = 0;
+    int m_losses = 0;
+};
+
+class Match
+{
+public:
+    explicit Match(const Options& options)
+        : m_options(options)
+    {
+    }
+    
+    int run(const std::vector<Position>& openings);
+    
+private:
+    struct Game {
+        GameResult result = GameResult::Draw;
+        int plies = 0;
+        const char* reason = "";
+        std::vector<Move> moves;
+    };
+    
+    void playGame(int index, const Position& opening);
+    Game play(const Position& opening, ParallelSearch* red, const EngineSpec& redSpec,
+              ParallelSearch* black, const EngineSpec& blackSpec, std::mt19937_64& random);
+    void recordGame(int index, bool engine1IsRed, const Game& game);
+    
+    const Options& m_options;
+    std::atomic<bool> m_finished{false};
+    std::mutex m_mutex;
+    MatchStats m_stats;
+    std::FILE* m_output = nullptr;
+    std::chrono::steady_clock::time_point m_startTime;
+    std::atomic<std::uint64_t> m_nodes{0};
+};
+
+int Match::run(const std::vector<Position>& openings)
+{
+    if (!m_options.outputPath.empty()) {
+        m_output = std::fopen(m_options.outputPath.c_str(), "a");
+        if (!m_output) {
+            std::fprintf(stderr, "Cannot write %s\n", m_options.outputPath.c_str());
+            return 1;
+        }
+    }
+    
+    const int games = m_options.games > 0 ? m_options.games : 2 * static_cast<int>(openings.size());
+    std::printf("%s vs %s: %d games, %d openings, %d at a time\n",
+                m_options.engines[0].name.c_str(), m_options.engines[1].name.c_str(),
+                games, static_cast<int>(openings.size()), m_options.concurrency);
+    std::fflush(stdout);
+    
+    m_startTime = std::chrono::steady_clock::now();
+    {
+        ThreadPool pool(m_options.concurrency);
+        for (int i = 0; i < games; ++i) {
+            const Position& opening = openings[static_cast<size_t>(i / 2) % openings.size()];
+            pool.submit([this, i, &opening]() { playGame(i, opening); });
+        }
+        pool.wait();
+    }
+    
+    if (m_output) {
+        std::fclose(m_output);
+    }
+    return 0;
+}
+
+void Match::playGame(int index, const Position& opening)
+{
+    if (m_finished.load()) return;
+    
+    // Each pool thread keeps its engines (and their hash tables) between
+    // games, so there is one Match per process
+    thread_local std::unique_ptr<ParallelSearch> engines[2];
+    for (int i = 0; i < 2; ++i) {
+        const EngineSpec& spec = m_options.engines[i];
+        if (!engines[i]) {
+            engines[i] = std::make_unique<ParallelSearch>(spec.threadCount, spec.hashMegabytes);
+            engines[i]->setTablebase(spec.tablebase.get());
+        }
+        engines[i]->clearHash();
+    }
+    
+    // Game pairs share an opening with the colours swapped
+    const bool engine1IsRed = (index % 2) == 0;
+    const int red = engine1IsRed ? 0 : 1;
+    const int black = 1 - red;
+    std::mt19937_64 random(m_options.seed ^ (static_cast<std::uint64_t>(index) * 0x9E3779B97F4A7C15ull));
+    
+    Game game = play(opening, engines[red].get(), m_options.engines[red],
+                     engines[black].get(), m_options.engines[black], random);
+    recordGame(index, engine1IsRed, game);
+}
+
+Match::Game Match::play(const Position& opening, ParallelSearch* red, const EngineSpec& redSpec,
+                        ParallelSearch* black, const EngineSpec& blackSpec, std::mt19937_64& random)
+{
+    Game game;
+    Position position = opening;
+    std::vector<std::uint64_t> history{position.hash()};
+    
+    for (;;) {
+        MoveList moves;
+        position.generateMoves(moves);
+        if (moves.isEmpty()) {
+            game.result = position.sideToMove() == PlayerColor::Red ? GameResult::BlackWin : GameResult::RedWin;
+            game.reason = "no-moves";
+            break;
+        }
+        if (game.plies >= m_options.maxPlies) {
+            game.reason = "max-plies";
+            break;
+        }
+        if (std::count(history.begin(), history.end(), position.hash()) >= 3) {
+            game.reason = "repetition";
+            break;
+        }
+        
+        Tablebase::Entry entry;
+        if (m_options.adjudication && m_options.adjudication->probe(position, entry)) {
+            if (entry.result == Tablebase::Result::Win) {
+                game.result = position.sideToMove() == PlayerColor::Red ? GameResult::RedWin : GameResult::BlackWin;
+            } else if (entry.result == Tablebase::Result::Loss) {
+                game.result = position.sideToMove() == PlayerColor::Red ? GameResult::BlackWin : GameResult::RedWin;
+            }
+            game.reason = "tablebase";
+            break;
+        }
+        
+        const bool redToMove = position.sideToMove() == PlayerColor::Red;
+        const EngineSpec& spec = redToMove ? redSpec : blackSpec;
+        Move move;
+        if (!spec.book || !spec.book->pickMove(position, random(), move)) {
+            SearchInfo info = (redToMove ? red : black)->search(position, spec.limits);
+            move = info.bestMove;
+            m_nodes += info.nodes;
+        }
+        
+        UndoRecord undo;
+        position.doMove(move, undo);
+        history.push_back(position.hash());
+        game.moves.push_back(move);
+        ++game.plies;
+    }
+    return game;
+}
+
+void Match::recordGame(int index, bool engine1IsRed, const Game& game)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    
+    double redScore = game.result == GameResult::RedWin ? 1.0 : game.result == GameResult::BlackWin ? 0.0 : 0.5;
+    m_stats.add(engine1IsRed ? redScore : 1.0 - redScore);
+    
+    const char* result = game.result == GameResult::RedWin ? "1-0" : game.result == GameResult::BlackWin ? "0-1" : "1/2-1/2";
+    const EngineSpec& red = m_options.engines[engine1IsRed ? 0 : 1];
+    const EngineSpec& black = m_options.engines[engine1IsRed ? 1 : 0];
+    
+    if (m_output) {
+        std::fprintf(m_output, "%s %s %s %d %s :", red.name.c_str(), black.name.c_str(), result, game.plies, game.reason);
+        for (const Move& move : game.moves) {
+            std::fprintf(m_output, " %d%c%d", move.from + 1, move.isCapture() ? 'x' : '-', move.to + 1);
+        }
+        std::fprintf(m_output, "\n");
+        std::fflush(m_output);
+    }
+    
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - m_startTime;
+    std::printf("game %5d  %-7s  %d-%d-%d  score %.3f  elo %7.1f +- %5.1f",
+                index + 1, result,
+                m_stats.wins(), m_stats.losses(), m_stats.draws(),
+                m_stats.score(), m_stats.elo(), m_stats.eloMargin());
+    
+    const char* verdict = nullptr;
+    if (m_options.sprt) {
+        double llr = m_stats.llr(m_options.elo0, m_options.elo1);
+        double lower = std::log(m_options.beta / (1 - m_options.alpha));
+        double upper = std::log((1 - m_options.beta) / m_options.alpha);
+        std::printf("  llr %5.2f (%.2f, %.2f)", llr, lower, upper);
+        
+        // Games already under way still finish and are reported
+        if (!m_finished.load() && (llr <= lower || llr >= upper)) {
+            m_finished.store(true);
+            verdict = llr >= upper ? "H1" : "H0";
+        }
+    }
+    
+    std::printf("  %.0f games/min  %.0f knodes/s\n",
+                elapsed.count() > 0 ? m_stats.games() * 60.0 / elapsed.count() : 0.0,
+                elapsed.count() > 0 ? static_cast<double>(m_nodes.load()) / elapsed.count() / 1000 : 0.0);
+    if (verdict) {
+        std::printf("SPRT: %s accepted, elo %s %.1f\n", verdict,
+                    verdict[1] == '1' ? ">=" : "<=", verdict[1] == '1' ? m_options.elo1 : m_options.elo0);
+    }
+    std::fflush(stdout);
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    Options options;
+    options.engines[0].name = "engine1";
+    options.engines[1].name = "engine2";
+    std::string engineSpecs[2];
+    std::string adjudicationPath;
+    options.concurrency = static_cast<int>(std::thread::hardware_concurrency());
+    
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--engine1") == 0 && i + 1 < argc) {
+            engineSpecs[0] = argv[++i];
+        } else if (std::strcmp(argv[i], "--engine2") == 0 && i + 1 < argc) {
+            engineSpecs[1] = argv[++i];
+        } else if (std::strcmp(argv[i], "--games") == 0 && i + 1 < argc) {
+            options.games = std::max(std::atoi(argv[++i]), 1);
+        } else if (std::strcmp(argv[i], "--concurrency") == 0 && i + 1 < argc) {
+            options.concurrency = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--opening-plies") == 0 && i + 1 < argc) {
+            options.openingPlies = std::max(std::atoi(argv[++i]), 0);
+        } else if (std::strcmp(argv[i], "--openings") == 0 && i + 1 < argc) {
+            options.openingsPath = argv[++i];
+        } else if (std::strcmp(argv[i], "--max-plies") == 0 && i + 1 < argc) {
+            options.maxPlies = std::max(std::atoi(argv[++i]), 1);
+        } else if (std::strcmp(argv[i], "--adjudicate") == 0 && i + 1 < argc) {
+            adjudicationPath = argv[++i];
+        } else if (std::strcmp(argv[i], "--sprt") == 0 && i + 2 < argc) {
+            options.sprt = true;
+            options.elo0 = std::atof(argv[++i]);
+            options.elo1 = std::atof(argv[++i]);
+        } else if (std::strcmp(argv[i], "--alpha") == 0 && i + 1 < argc) {
+            options.alpha = std::atof(argv[++i]);
+        } else if (std::strcmp(argv[i], "--beta") == 0 && i + 1 < argc) {
+            options.beta = std::atof(argv[++i]);
+        } else if (std::strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+            options.outputPath = argv[++i];
+        } else if (std::strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            options.seed = std::strtoull(argv[++i], nullptr, 10);
+        } else {
+            printUsage();
+            return 1;
+        }
+    }
+    
+    for (int i = 0; i < 2; ++i) {
+        if (!parseEngineSpec(engineSpecs[i], options.engines[i])) return 1;
+    }
+    if (options.concurrency < 1) {
+        options.concurrency = 1;
+    }
+    if (options.alpha <= 0 || options.alpha >= 1 || options.beta <= 0 || options.beta >= 1) {
+        std::fprintf(stderr, "SPRT error rates must be between 0 and 1\n");
+        return 1;
+    }
+    
+    if (!adjudicationPath.empty()) {
+        auto tablebase = std::make_shared<Tablebase>();
+        if (tablebase->load(adjudicationPath) == 0) {
+            std::fprintf(stderr, "No tablebase files in %s\n", adjudicationPath.c_str());
+            return 1;
+        }
+        options.adjudication = tablebase;
+    }
+    
+    std::vector<Position> openings;
+    if (!options.openingsPath.empty()) {
+        if (!readOpenings(options.openingsPath, openings)) return 1;
+    } else {
+        openings = generateOpenings(options.openingPlies, options.seed);
+    }
+    
+    Match match(options);
+    return match.run(openings);
+}
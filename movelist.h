@@ -0,0 +1,68 @@
+#ifndef MOVELIST_H
+#define MOVELIST_H
+
+#include <cstdint>
+#include "bitboard.h"
+
+// Move structure. Squares are playable-square indices (see bitboard.h) and
+// every piece taken by a (multi-)jump is one bit in captures, so a move is a
+// plain 8-byte value that never allocates.
+struct Move {
+    static constexpr std::uint8_t NO_SQUARE = 0xFF;
+    
+    std::uint8_t from;
+    std::uint8_t to;
+    Bitboard::Mask captures;
+    
+    bool isValid() const { return from != NO_SQUARE && to != NO_SQUARE; }
+    bool isCapture() const { return captures != 0; }
+    static Move invalid() { return {NO_SQUARE, NO_SQUARE, 0}; }
+    
+    // Negative squares (off the board or light squares) give an invalid move
+    static Move between(int from, int to)
+    {
+        if (from < 0 || to < 0) return invalid();
+        return {static_cast<std::uint8_t>(from), static_cast<std::uint8_t>(to), 0};
+    }
+    
+    bool operator==(const Move& other) const {
+        return from == other.from && to == other.to;
+    }
+    bool operator!=(const Move& other) const { return !(*this == other); }
+};
+
+// Fixed-capacity, stack-resident list of moves. The storage is left
+// uninitialised, so constructing one costs nothing.
+class MoveList
+{
+public:
+    // Comfortably above the most moves any legal 8x8 position allows
+    static constexpr int CAPACITY = 128;
+    
+    MoveList() = default;
+    
+    void append(const Move& move)
+    {
+        if (m_size < CAPACITY) {
+            m_moves[m_size++] = move;
+        }
+    }
+    
+    void clear() { m_size = 0; }
+    int size() const { return m_size; }
+    bool isEmpty() const { return m_size == 0; }
+    
+    Move& operator[](int index) { return m_moves[index]; }
+    const Move& operator[](int index) const { return m_moves[index]; }
+    
+    Move* begin() { return m_moves; }
+    Move* end() { return m_moves + m_size; }
+    const Move* begin() const { return m_moves; }
+    const Move* end() const { return m_moves + m_size; }
+    
+private:
+    Move m_moves[CAPACITY];
+    int m_size = 0;
+};
+
+#endif // MOVELIST_H
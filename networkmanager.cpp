@@ -1,11 +1,21 @@
 #include "networkmanager.h"
 #include <QNetworkInterface>
-#include <QDataStream>
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QDateTime>
 #include <QIODevice>
 
+namespace {
+
+// What a spectator's board needs: everything that changes the host's
+bool isSpectated(MessageType type)
+{
+    return type == MessageType::Move || type == MessageType::GameState
+           || type == MessageType::StateDelta || type == MessageType::GameReset;
+}
+
+} // namespace
+
 NetworkManager::NetworkManager(QObject *parent)
     : QObject(parent)
     , m_server(new QTcpServer(this))
@@ -13,12 +23,14 @@ NetworkManager::NetworkManager(QObject *parent)
     , m_discoveryTimer(new QTimer(this))
     , m_cleanupTimer(new QTimer(this))
     , m_pingTimer(new QTimer(this))
+    , m_stallTimer(new QTimer(this))
 {
     connect(m_server, &QTcpServer::newConnection, this, &NetworkManager::onNewConnection);
     connect(m_discoverySocket, &QUdpSocket::readyRead, this, &NetworkManager::onDiscoveryReadyRead);
     connect(m_discoveryTimer, &QTimer::timeout, this, &NetworkManager::announcePresence);
     connect(m_cleanupTimer, &QTimer::timeout, this, &NetworkManager::cleanupStalePeers);
     connect(m_pingTimer, &QTimer::timeout, this, &NetworkManager::sendPing);
+    connect(m_stallTimer, &QTimer::timeout, this, &NetworkManager::dropStalledSpectators);
     
     // Collect local IP addresses for filtering
     updateLocalAddresses();
@@ -75,6 +87,9 @@ bool NetworkManager::hostGame(const QString& playerName, quint16 port)
         return false;
     }
     
+    // Spectators that stop reading are dropped even while no moves are made
+    m_stallTimer->start(SPECTATOR_CHECK_MS);
+    
     // Start announcing presence for discovery
     startDiscovery();
     
@@ -96,6 +111,8 @@ bool NetworkManager::joinGame(const QHostAddress& hostAddress, quint16 port)
     m_localColor = PlayerColor::Black; // Client plays as Black
     
     m_socket = new QTcpSocket(this);
+    m_socket->setReadBufferSize(m_maxFrameSize + Framing::FRAME_OVERHEAD);
+    m_reader.clear();
     
     connect(m_socket, &QTcpSocket::connected, this, &NetworkManager::onClientConnected);
     connect(m_socket, &QTcpSocket::readyRead, this, &NetworkManager::onReadyRead);
@@ -112,11 +129,25 @@ bool NetworkManager::joinGame(const QHostAddress& hostAddress, quint16 port)
     return true;
 }
 
+bool NetworkManager::watchGame(const QString& playerName, const QHostAddress& hostAddress, quint16 port)
+{
+    if (!joinGame(hostAddress, port)) {
+        return false;
+    }
+    
+    // Greets the host with Spectate rather than PlayerReady, see onClientConnected
+    m_playerName = playerName;
+    m_role = NetworkRole::Spectator;
+    m_localColor = PlayerColor::None;
+    return true;
+}
+
 void NetworkManager::disconnect()
 {
     // Stop discovery
     stopDiscovery();
     m_pingTimer->stop();
+    m_stallTimer->stop();
     
     // Send disconnect message if connected
     if (m_connected && m_socket) {
@@ -125,6 +156,16 @@ void NetworkManager::disconnect()
         m_socket->waitForBytesWritten(1000);
     }
     
+    // Spectators are told the game is over; connections that have not said
+    // what they want are just closed
+    const QList<QTcpSocket*> guests = m_guests.keys();
+    for (QTcpSocket* socket : guests) {
+        if (m_guests.value(socket).spectator) {
+            Protocol::writeFrame(socket, m_writer, MessageType::Disconnect);
+        }
+        removeGuest(socket);
+    }
+    
     // Close socket
     if (m_socket) {
         m_socket->disconnectFromHost();
@@ -140,7 +181,7 @@ void NetworkManager::disconnect()
     m_connected = false;
     m_role = NetworkRole::None;
     m_opponentName.clear();
-    m_readBuffer.clear();
+    m_reader.clear();
 }
 
 void NetworkManager::startDiscovery()
@@ -294,15 +335,110 @@ void NetworkManager::cleanupStalePeers()
 
 void NetworkManager::onNewConnection()
 {
-    if (m_connected) {
-        // Already have a player, reject
-        QTcpSocket* pending = m_server->nextPendingConnection();
-        pending->disconnectFromHost();
-        pending->deleteLater();
-        return;
+    // Every connection waits as a guest until its first message says
+    // whether it plays or watches
+    QTcpSocket* socket = m_server->nextPendingConnection();
+    if (!socket) return;
+    
+    socket->setReadBufferSize(m_maxFrameSize + Framing::FRAME_OVERHEAD);
+    m_guests[socket].reader.setMaxFrameSize(static_cast<std::size_t>(m_maxFrameSize));
+    
+    connect(socket, &QTcpSocket::readyRead, this, [this, socket]() { onGuestReadyRead(socket); });
+    connect(socket, &QTcpSocket::bytesWritten, this, [this, socket]() { onGuestBytesWritten(socket); });
+    connect(socket, &QTcpSocket::disconnected, this, [this, socket]() { removeGuest(socket); });
+    
+    QTimer::singleShot(GREETING_TIMEOUT_MS, socket, [this, socket]() {
+        auto it = m_guests.constFind(socket);
+        if (it != m_guests.constEnd() && !it->spectator) {
+            removeGuest(socket, true);
+        }
+    });
+}
+
+void NetworkManager::onGuestReadyRead(QTcpSocket* socket)
+{
+    auto it = m_guests.find(socket);
+    if (it == m_guests.end()) return;
+    Guest& guest = it.value();
+    
+    // The handler only decides; the guest is seated or closed, and anyone
+    // listening is told, once reading has stopped
+    enum class Outcome { Stay, Seat, Close } outcome = Outcome::Stay;
+    QByteArray greeting;
+    bool joined = false;
+    
+    Protocol::ReadResult result = Protocol::readFrames(socket, guest.reader,
+        [&](MessageType type, const QByteArray& payload) {
+            switch (type) {
+                case MessageType::PlayerReady:
+                    // The first player to arrive takes the seat
+                    if (guest.spectator || m_socket) {
+                        outcome = Outcome::Close;
+                    } else {
+                        greeting = QByteArray(payload.constData(), payload.size());
+                        outcome = Outcome::Seat;
+                    }
+                    return false;
+                    
+                case MessageType::Spectate:
+                    if (!guest.spectator) {
+                        if (spectatorCount() >= MAX_SPECTATORS) {
+                            outcome = Outcome::Close;
+                            return false;
+                        }
+                        guest.spectator = true;
+                        joined = true;
+                        sendSnapshot(socket);
+                    }
+                    return true;
+                    
+                case MessageType::StateRequest:
+                    if (guest.spectator) {
+                        sendSnapshot(socket);
+                    }
+                    return true;
+                    
+                case MessageType::Ping:
+                    Protocol::writeFrame(socket, m_writer, MessageType::Pong);
+                    return true;
+                    
+                case MessageType::Pong:
+                    return true;
+                    
+                case MessageType::Disconnect:
+                    outcome = Outcome::Close;
+                    return false;
+                    
+                default:
+                    // Spectators only watch; anything else as a greeting is
+                    // not this protocol
+                    if (!guest.spectator) {
+                        outcome = Outcome::Close;
+                        return false;
+                    }
+                    return true;
+            }
+        });
+        
+    bool malformed = (result == Protocol::ReadResult::Malformed);
+    if (joined) {
+        emit spectatorsChanged(spectatorCount());
+    }
+    if (outcome == Outcome::Seat && !malformed) {
+        takeSeat(socket, greeting);
+    } else if (outcome == Outcome::Close || malformed) {
+        removeGuest(socket, malformed);
     }
+}
+
+void NetworkManager::takeSeat(QTcpSocket* socket, const QByteArray& greeting)
+{
+    // Whatever arrived after the greeting is the opponent's first messages
+    m_reader = std::move(m_guests[socket].reader);
+    m_guests.remove(socket);
+    QObject::disconnect(socket, nullptr, this, nullptr);
     
-    m_socket = m_server->nextPendingConnection();
+    m_socket = socket;
     
     connect(m_socket, &QTcpSocket::readyRead, this, &NetworkManager::onReadyRead);
     connect(m_socket, &QTcpSocket::disconnected, this, &NetworkManager::onSocketDisconnected);
@@ -323,12 +459,129 @@ void NetworkManager::onNewConnection()
     m_discoveryTimer->stop();
     
     // Send our player info
-    QJsonObject info;
-    info["name"] = m_playerName;
-    sendMessage(MessageType::PlayerReady, QJsonDocument(info).toJson(QJsonDocument::Compact));
+    sendMessage(MessageType::PlayerReady, Protocol::playerReadyPayload(m_playerName));
     
     emit connected();
-    emit opponentConnected(m_opponentName);
+    
+    // The greeting names the opponent and starts the game
+    if (processMessage(MessageType::PlayerReady, greeting) && m_socket == socket) {
+        onReadyRead();
+    }
+}
+
+void NetworkManager::removeGuest(QTcpSocket* socket, bool abort)
+{
+    auto it = m_guests.find(socket);
+    if (it == m_guests.end()) return;
+    
+    bool spectator = it->spectator;
+    m_guests.erase(it);
+    QObject::disconnect(socket, nullptr, this, nullptr);
+    
+    if (abort || socket->state() == QAbstractSocket::UnconnectedState) {
+        socket->abort();
+        socket->deleteLater();
+    } else {
+        // Whatever is queued, such as a Disconnect, goes out first
+        connect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+        socket->disconnectFromHost();
+    }
+    
+    if (spectator) {
+        emit spectatorsChanged(spectatorCount());
+    }
+}
+
+int NetworkManager::spectatorCount() const
+{
+    int count = 0;
+    for (const Guest& guest : m_guests) {
+        if (guest.spectator) {
+            ++count;
+        }
+    }
+    return count;
+}
+
+void NetworkManager::sendSnapshot(QTcpSocket* socket)
+{
+    if (!m_game) return;
+    
+    Protocol::writeFrame(socket, m_writer, MessageType::GameState,
+                         Protocol::gameStatePayload(m_game->stateSequence(), m_game->serialize()));
+}
+
+// Sends the frame just built in m_writer to every spectator that keeps up.
+// One that has fallen behind skips it; dropStalledSpectators decides when it
+// has been behind too long.
+// The frame is copied out of the writer once and the same QByteArray is
+// queued on each socket, so its cost does not grow with the audience; Qt 6
+// sockets even share the bytes instead of copying them into their buffers.
+void NetworkManager::sendToSpectators()
+{
+    QByteArray frame;
+    
+    for (auto it = m_guests.begin(); it != m_guests.end(); ++it) {
+        Guest& guest = it.value();
+        if (!guest.spectator || guest.lagging) continue;
+        
+        QTcpSocket* socket = it.key();
+        if (socket->bytesToWrite() > SPECTATOR_BACKLOG) {
+            // More frames would only queue up behind the rest; it gets the
+            // whole position instead once it has caught up
+            guest.lagging = true;
+            guest.laggingSince = QDateTime::currentMSecsSinceEpoch();
+            continue;
+        }
+        
+        if (frame.isNull()) {
+            frame = QByteArray(reinterpret_cast<const char*>(m_writer.data()), static_cast<int>(m_writer.size()));
+        }
+        socket->write(frame);
+    }
+}
+
+void NetworkManager::dropStalledSpectators()
+{
+    QList<QTcpSocket*> stalled;
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    
+    for (auto it = m_guests.constBegin(); it != m_guests.constEnd(); ++it) {
+        if (it->lagging && now - it->laggingSince > SPECTATOR_STALL_MS) {
+            stalled.append(it.key());
+        }
+    }
+    
+    for (QTcpSocket* socket : stalled) {
+        removeGuest(socket, true);
+    }
+}
+
+void NetworkManager::relayMove(const Move& move, const CheckersGame* game)
+{
+    if (!game || !isHost()) return;
+    
+    relayToSpectators(MessageType::Move, Protocol::movePayload(move, game->stateSequence(), game->hash()));
+}
+
+void NetworkManager::relayToSpectators(MessageType type, const QByteArray& payload)
+{
+    if (m_guests.isEmpty()) return;
+    
+    if (m_writer.build(static_cast<std::uint8_t>(type), reinterpret_cast<const std::uint8_t*>(payload.constData()),
+                       static_cast<std::size_t>(payload.size()))) {
+        sendToSpectators();
+    }
+}
+
+void NetworkManager::onGuestBytesWritten(QTcpSocket* socket)
+{
+    auto it = m_guests.find(socket);
+    if (it == m_guests.end() || !it->lagging || socket->bytesToWrite() > 0) return;
+    
+    // Caught up; the snapshot replaces the frames it missed
+    it->lagging = false;
+    sendSnapshot(socket);
 }
 
 void NetworkManager::onClientConnected()
@@ -338,10 +591,9 @@ void NetworkManager::onClientConnected()
     // Start keep-alive
     m_pingTimer->start(5000);
     
-    // Send our player info
-    QJsonObject info;
-    info["name"] = m_playerName;
-    sendMessage(MessageType::PlayerReady, QJsonDocument(info).toJson(QJsonDocument::Compact));
+    // Send our player info, or ask to watch
+    sendMessage(isSpectator() ? MessageType::Spectate : MessageType::PlayerReady,
+                Protocol::playerReadyPayload(m_playerName));
     
     emit connected();
 }
@@ -350,60 +602,69 @@ void NetworkManager::onReadyRead()
 {
     if (!m_socket) return;
     
-    m_readBuffer.append(m_socket->readAll());
-    
-    // Process complete messages (length-prefixed protocol)
-    while (m_readBuffer.size() >= static_cast<int>(sizeof(quint32))) {
-        QDataStream stream(m_readBuffer);
-        stream.setVersion(QDataStream::Qt_5_15);
-        
-        quint32 packetSize;
-        stream >> packetSize;
+    // A Disconnect message or a slot may drop the connection mid-read
+    QTcpSocket* socket = m_socket;
+    Protocol::ReadResult result = Protocol::readFrames(socket, m_reader,
+        [this, socket](MessageType type, const QByteArray& payload) {
+            return processMessage(type, payload) && m_socket == socket;
+        });
         
-        if (m_readBuffer.size() < static_cast<int>(sizeof(quint32) + packetSize)) {
-            break; // Wait for more data
-        }
-        
-        QByteArray packet = m_readBuffer.mid(sizeof(quint32), packetSize);
-        m_readBuffer.remove(0, sizeof(quint32) + packetSize);
-        
-        processMessage(packet);
+    if (result == Protocol::ReadResult::Malformed) {
+        emit connectionError(tr("Received a malformed or oversized message; disconnecting."));
+        socket->abort();
     }
 }
 
-void NetworkManager::processMessage(const QByteArray& data)
+void NetworkManager::setMaxFrameSize(int bytes)
 {
-    if (data.isEmpty()) return;
-    
-    QDataStream stream(data);
-    stream.setVersion(QDataStream::Qt_5_15);
-    
-    quint8 typeValue;
-    stream >> typeValue;
-    MessageType type = static_cast<MessageType>(typeValue);
-    
-    QByteArray payload;
-    stream >> payload;
+    m_maxFrameSize = bytes;
+    m_reader.setMaxFrameSize(static_cast<std::size_t>(bytes));
+    m_writer.setMaxFrameSize(static_cast<std::size_t>(bytes));
+    if (m_socket) {
+        m_socket->setReadBufferSize(bytes + Framing::FRAME_OVERHEAD);
+    }
+    for (auto it = m_guests.begin(); it != m_guests.end(); ++it) {
+        it.value().reader.setMaxFrameSize(static_cast<std::size_t>(bytes));
+        it.key()->setReadBufferSize(bytes + Framing::FRAME_OVERHEAD);
+    }
+}
+
+bool NetworkManager::processMessage(MessageType type, const QByteArray& payload)
+{
+    // A reset always takes, so it reaches the spectators ahead of the delta
+    // the host confirms it with. The opponent's moves are only passed on
+    // once they have been accepted, see relayMove.
+    if (isHost() && type == MessageType::GameReset) {
+        relayToSpectators(type, payload);
+    }
     
     switch (type) {
-        case MessageType::GameState:
-            emit gameStateReceived(payload);
+        case MessageType::GameState: {
+            quint32 sequence;
+            QByteArray state;
+            if (Protocol::readGameState(payload, state, sequence)) {
+                emit gameStateReceived(state, sequence);
+            }
             break;
-            
+        }
+        
         case MessageType::Move: {
-            QDataStream moveStream(payload);
-            moveStream.setVersion(QDataStream::Qt_5_15);
-            
-            int fromX, fromY, toX, toY;
-            moveStream >> fromX >> fromY >> toX >> toY;
-            
             Move move;
-            move.from = QPoint(fromX, fromY);
-            move.to = QPoint(toX, toY);
-            
-            emit moveReceived(move);
+            quint32 sequence;
+            quint64 hash;
+            if (Protocol::readMove(payload, move, sequence, hash)) {
+                emit moveReceived(move, sequence, hash);
+            }
             break;
         }
+        
+        case MessageType::StateDelta:
+            emit stateDeltaReceived(QByteArray(payload.constData(), payload.size()));
+            break;
+            
+        case MessageType::StateRequest:
+            emit stateRequestReceived();
+            break;
             
         case MessageType::ChatMessage: {
             QString message = QString::fromUtf8(payload);
@@ -412,9 +673,9 @@ void NetworkManager::processMessage(const QByteArray& data)
         }
             
         case MessageType::PlayerReady: {
-            QJsonDocument doc = QJsonDocument::fromJson(payload);
-            if (doc.isObject()) {
-                m_opponentName = doc.object()["name"].toString();
+            QString name = Protocol::readPlayerName(payload);
+            if (!name.isEmpty()) {
+                m_opponentName = name;
             }
             emit playerReadyReceived();
             emit opponentConnected(m_opponentName);
@@ -437,50 +698,62 @@ void NetworkManager::processMessage(const QByteArray& data)
             // Connection is alive
             break;
             
+        case MessageType::SeatAssignment:
+            // A lobby server decides who plays which colour
+            if (m_role == NetworkRole::Client) {
+                Protocol::readSeat(payload, m_localColor);
+            }
+            break;
+            
+        case MessageType::Spectate:
+            // Only a new connection can ask to watch
+            break;
+            
         case MessageType::Disconnect:
             onSocketDisconnected();
-            break;
+            return false;
     }
+    return true;
 }
 
 void NetworkManager::sendMessage(MessageType type, const QByteArray& payload)
 {
     if (!m_socket || !m_socket->isOpen()) return;
     
-    QByteArray packet = createPacket(type, payload);
-    m_socket->write(packet);
+    // The peer would drop the connection over a frame this size
+    if (!Protocol::writeFrame(m_socket, m_writer, type, payload)) {
+        qWarning() << "Dropping oversized message of" << payload.size() << "bytes";
+        return;
+    }
+    
+    if (isHost() && isSpectated(type)) {
+        sendToSpectators();
+    }
 }
 
-QByteArray NetworkManager::createPacket(MessageType type, const QByteArray& payload)
+void NetworkManager::sendMove(const Move& move, const CheckersGame* game)
 {
-    QByteArray innerData;
-    QDataStream innerStream(&innerData, QIODevice::WriteOnly);
-    innerStream.setVersion(QDataStream::Qt_5_15);
-    innerStream << static_cast<quint8>(type) << payload;
-    
-    QByteArray packet;
-    QDataStream packetStream(&packet, QIODevice::WriteOnly);
-    packetStream.setVersion(QDataStream::Qt_5_15);
-    packetStream << static_cast<quint32>(innerData.size());
-    packet.append(innerData);
+    if (!game) return;
     
-    return packet;
+    sendMessage(MessageType::Move, Protocol::movePayload(move, game->stateSequence(), game->hash()));
 }
 
-void NetworkManager::sendMove(const Move& move)
+void NetworkManager::sendGameState(const CheckersGame* game)
 {
-    QByteArray payload;
-    QDataStream stream(&payload, QIODevice::WriteOnly);
-    stream.setVersion(QDataStream::Qt_5_15);
-    stream << move.from.x() << move.from.y() << move.to.x() << move.to.y();
+    if (!game) return;
     
-    sendMessage(MessageType::Move, payload);
+    sendMessage(MessageType::GameState, Protocol::gameStatePayload(game->stateSequence(), game->serialize()));
 }
 
-void NetworkManager::sendGameState(const CheckersGame* game)
+void NetworkManager::sendStateDelta(const CheckersGame* game, const Position& base)
 {
     if (!game) return;
-    sendMessage(MessageType::GameState, game->serialize());
+    sendMessage(MessageType::StateDelta, game->stateDelta(base));
+}
+
+void NetworkManager::sendStateRequest()
+{
+    sendMessage(MessageType::StateRequest);
 }
 
 void NetworkManager::sendChatMessage(const QString& message)
@@ -495,9 +768,7 @@ void NetworkManager::sendGameReset()
 
 void NetworkManager::sendPlayerReady()
 {
-    QJsonObject info;
-    info["name"] = m_playerName;
-    sendMessage(MessageType::PlayerReady, QJsonDocument(info).toJson(QJsonDocument::Compact));
+    sendMessage(MessageType::PlayerReady, Protocol::playerReadyPayload(m_playerName));
 }
 
 void NetworkManager::sendGameStart()
@@ -520,6 +791,7 @@ void NetworkManager::onSocketDisconnected()
         m_socket->deleteLater();
         m_socket = nullptr;
     }
+    m_reader.clear();
     
     // Resume announcing if still hosting
     if (m_role == NetworkRole::Host && m_server->isListening()) {
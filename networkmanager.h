@@ -8,26 +8,17 @@
 #include <QTimer>
 #include <QHostAddress>
 #include <QSet>
+#include <QHash>
 #include "checkersgame.h"
-
-// Message types for network protocol
-enum class MessageType : quint8 {
-    GameState = 1,      // Full game state sync
-    Move = 2,           // A move was made
-    ChatMessage = 3,    // Chat message
-    PlayerReady = 4,    // Player is ready to start
-    GameStart = 5,      // Game is starting
-    GameReset = 6,      // Reset the game
-    Ping = 7,           // Keep-alive ping
-    Pong = 8,           // Keep-alive response
-    Disconnect = 9      // Player disconnecting
-};
+#include "framing.h"
+#include "protocol.h"
 
 // Network role
 enum class NetworkRole {
     None,
     Host,
-    Client
+    Client,
+    Spectator   // Watches a hosted game without playing
 };
 
 // Discovered peer info
@@ -43,26 +34,51 @@ class NetworkManager : public QObject
     Q_OBJECT
     
 public:
-    static constexpr quint16 DEFAULT_PORT = 45678;
+    static constexpr quint16 DEFAULT_PORT = Protocol::DEFAULT_PORT;
     static constexpr quint16 DISCOVERY_PORT = 45679;
     static constexpr int DISCOVERY_INTERVAL_MS = 2000;
     static constexpr int PEER_TIMEOUT_MS = 6000;
     
+    // Spectators of a hosted game. One whose socket has more than
+    // SPECTATOR_BACKLOG bytes queued stops getting the move stream and is
+    // sent a snapshot once it has caught up; one that stays behind for
+    // SPECTATOR_STALL_MS is dropped, checked every SPECTATOR_CHECK_MS.
+    // The players never wait for either.
+    static constexpr int MAX_SPECTATORS = 32;
+    static constexpr qint64 SPECTATOR_BACKLOG = 64 * 1024;
+    static constexpr int SPECTATOR_STALL_MS = 15000;
+    static constexpr int SPECTATOR_CHECK_MS = 1000;
+    
+    // A connection to the host must say whether it plays or watches
+    static constexpr int GREETING_TIMEOUT_MS = 10000;
+    
     explicit NetworkManager(QObject *parent = nullptr);
     ~NetworkManager();
     
     // Connection management
     bool hostGame(const QString& playerName, quint16 port = DEFAULT_PORT);
     bool joinGame(const QHostAddress& hostAddress, quint16 port = DEFAULT_PORT);
+    bool watchGame(const QString& playerName, const QHostAddress& hostAddress, quint16 port = DEFAULT_PORT);
     void disconnect();
     
     // State
     bool isConnected() const { return m_connected; }
     bool isHost() const { return m_role == NetworkRole::Host; }
+    bool isSpectator() const { return m_role == NetworkRole::Spectator; }
     NetworkRole role() const { return m_role; }
     QString playerName() const { return m_playerName; }
     QString opponentName() const { return m_opponentName; }
     PlayerColor localPlayerColor() const { return m_localColor; }
+    int spectatorCount() const;
+    
+    // The host's game, sent whole to a spectator that joins or falls behind
+    void setGame(const CheckersGame* game) { m_game = game; }
+    
+    // Largest frame body accepted or sent; a peer that announces a bigger
+    // one is disconnected. Also caps the socket's own read buffer, so memory
+    // stays bounded however fast messages arrive.
+    int maxFrameSize() const { return m_maxFrameSize; }
+    void setMaxFrameSize(int bytes);
     
     // Discovery
     void startDiscovery();
@@ -70,13 +86,23 @@ public:
     QList<PeerInfo> discoveredPeers() const { return m_discoveredPeers.values(); }
     
     // Game communication
-    void sendMove(const Move& move);
+    // Moves carry the mover's state sequence and hash after the move, so
+    // the receiver can tell when the boards have drifted apart. Only the
+    // host sends state: a delta from base normally, and a full GameState
+    // when the client asks for one.
+    void sendMove(const Move& move, const CheckersGame* game);
     void sendGameState(const CheckersGame* game);
+    void sendStateDelta(const CheckersGame* game, const Position& base);
+    void sendStateRequest();
     void sendChatMessage(const QString& message);
     void sendGameReset();
     void sendPlayerReady();
     void sendGameStart();
     
+    // The host passes an opponent's move on to the spectators once its own
+    // game has accepted it
+    void relayMove(const Move& move, const CheckersGame* game);
+    
     // Utility
     static QString getLocalIPAddress();
     
@@ -85,8 +111,10 @@ signals:
     void disconnected();
     void connectionError(const QString& error);
     
-    void moveReceived(const Move& move);
-    void gameStateReceived(const QByteArray& state);
+    void moveReceived(const Move& move, quint32 sequence, quint64 hash);
+    void gameStateReceived(const QByteArray& state, quint32 sequence);
+    void stateDeltaReceived(const QByteArray& delta);
+    void stateRequestReceived();
     void chatMessageReceived(const QString& from, const QString& message);
     void playerReadyReceived();
     void gameStartReceived();
@@ -98,6 +126,7 @@ signals:
     
     void opponentConnected(const QString& name);
     void opponentDisconnected();
+    void spectatorsChanged(int count);
     
 private slots:
     void onNewConnection();
@@ -110,17 +139,37 @@ private slots:
     void announcePresence();
     void cleanupStalePeers();
     void sendPing();
+    void dropStalledSpectators();
     
 private:
-    void processMessage(const QByteArray& data);
+    // A connection to the host other than the opponent's: one that has not
+    // said yet whether it plays or watches, or a spectator
+    struct Guest {
+        Framing::FrameReader reader;
+        bool spectator = false;
+        bool lagging = false;       // Skipping frames until its backlog drains
+        qint64 laggingSince = 0;
+    };
+    
+    bool processMessage(MessageType type, const QByteArray& payload);
     void sendMessage(MessageType type, const QByteArray& payload = QByteArray());
-    QByteArray createPacket(MessageType type, const QByteArray& payload);
+    void takeSeat(QTcpSocket* socket, const QByteArray& greeting);
+    void onGuestReadyRead(QTcpSocket* socket);
+    void onGuestBytesWritten(QTcpSocket* socket);
+    void sendSnapshot(QTcpSocket* socket);
+    void sendToSpectators();
+    void relayToSpectators(MessageType type, const QByteArray& payload);
+    void removeGuest(QTcpSocket* socket, bool abort = false);
     void updateLocalAddresses();
     
     // TCP
     QTcpServer* m_server = nullptr;
     QTcpSocket* m_socket = nullptr;
-    QByteArray m_readBuffer;
+    Framing::FrameReader m_reader;
+    Framing::FrameWriter m_writer;
+    QHash<QTcpSocket*, Guest> m_guests;
+    const CheckersGame* m_game = nullptr;
+    int m_maxFrameSize = static_cast<int>(Framing::DEFAULT_MAX_FRAME_SIZE);
     
     // UDP Discovery
     QUdpSocket* m_discoverySocket = nullptr;
@@ -131,6 +180,9 @@ private:
     // Keep-alive
     QTimer* m_pingTimer = nullptr;
     
+    // Spectator stalls
+    QTimer* m_stallTimer = nullptr;
+    
     // State
     NetworkRole m_role = NetworkRole::None;
     bool m_connected = false;
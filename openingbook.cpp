@@ -0,0 +1,181 @@
+#include "openingbook.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+namespace {
+
+const char FILE_MAGIC[4] = {'C', 'K', 'B', 'K'};
+constexpr std::uint8_t FILE_VERSION = 1;
+
+std::uint64_t readLittleEndian(const std::uint8_t* bytes, int count)
+{
+    std::uint64_t value = 0;
+    for (int i = count - 1; i >= 0; --i) {
+        value = (value << 8) | bytes[i];
+    }
+    return value;
+}
+
+void writeLittleEndian(std::uint8_t* bytes, std::uint64_t value, int count)
+{
+    for (int i = 0; i < count; ++i) {
+        bytes[i] = static_cast<std::uint8_t>(value >> (8 * i));
+    }
+}
+
+bool sameMove(const Move& a, const Move& b)
+{
+    return a.from == b.from && a.to == b.to && a.captures == b.captures;
+}
+
+} // namespace
+
+bool OpeningBook::load(const std::string& path)
+{
+    close();
+    if (!m_file.open(path)) return false;
+    
+    const std::uint8_t* data = m_file.data();
+    std::size_t size = m_file.size();
+    if (size < FILE_HEADER_SIZE
+        || std::memcmp(data, FILE_MAGIC, sizeof(FILE_MAGIC)) != 0
+        || data[4] != FILE_VERSION
+        || readLittleEndian(data + 8, 8) != (size - FILE_HEADER_SIZE) / RECORD_SIZE
+        || (size - FILE_HEADER_SIZE) % RECORD_SIZE != 0) {
+        std::fprintf(stderr, "Ignoring invalid opening book %s\n", path.c_str());
+        m_file.close();
+        return false;
+    }
+    
+    m_records = data + FILE_HEADER_SIZE;
+    m_recordCount = (size - FILE_HEADER_SIZE) / RECORD_SIZE;
+    return true;
+}
+
+void OpeningBook::close()
+{
+    m_file.close();
+    m_records = nullptr;
+    m_recordCount = 0;
+}
+
+OpeningBook::Record OpeningBook::recordAt(std::size_t index) const
+{
+    const std::uint8_t* bytes = m_records + index * RECORD_SIZE;
+    Record record;
+    record.key = readLittleEndian(bytes, 8);
+    record.move.from = bytes[8];
+    record.move.to = bytes[9];
+    record.weight = static_cast<std::uint32_t>(readLittleEndian(bytes + 10, 2));
+    record.move.captures = static_cast<Bitboard::Mask>(readLittleEndian(bytes + 12, 4));
+    return record;
+}
+
+std::vector<OpeningBook::BookMove> OpeningBook::probe(const Position& position) const
+{
+    std::vector<BookMove> result;
+    if (!m_records) return result;
+    
+    // First record with this key
+    const std::uint64_t key = position.hash();
+    std::size_t low = 0;
+    std::size_t high = m_recordCount;
+    while (low < high) {
+        std::size_t middle = low + (high - low) / 2;
+        if (readLittleEndian(m_records + middle * RECORD_SIZE, 8) < key) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    if (low == m_recordCount) return result;
+    
+    // Checking legality guards against hash collisions and stale books
+    MoveList legal;
+    position.generateMoves(legal);
+    
+    for (std::size_t index = low; index < m_recordCount; ++index) {
+        Record record = recordAt(index);
+        if (record.key != key) break;
+        
+        for (const Move& move : legal) {
+            if (sameMove(move, record.move)) {
+                result.push_back({move, static_cast<int>(record.weight)});
+                break;
+            }
+        }
+    }
+    
+    std::stable_sort(result.begin(), result.end(), [](const BookMove& a, const BookMove& b) {
+        return a.weight > b.weight;
+    });
+    return result;
+}
+
+bool OpeningBook::pickMove(const Position& position, std::uint64_t random, Move& move) const
+{
+    std::vector<BookMove> moves = probe(position);
+    
+    std::uint64_t total = 0;
+    for (const BookMove& bookMove : moves) {
+        total += static_cast<std::uint64_t>(bookMove.weight);
+    }
+    if (total == 0) return false;
+    
+    std::uint64_t target = random % total;
+    for (const BookMove& bookMove : moves) {
+        if (target < static_cast<std::uint64_t>(bookMove.weight)) {
+            move = bookMove.move;
+            return true;
+        }
+        target -= static_cast<std::uint64_t>(bookMove.weight);
+    }
+    return false;
+}
+
+bool OpeningBook::write(const std::string& path, std::vector<Record> records)
+{
+    auto less = [](const Record& a, const Record& b) {
+        if (a.key != b.key) return a.key < b.key;
+        if (a.move.from != b.move.from) return a.move.from < b.move.from;
+        if (a.move.to != b.move.to) return a.move.to < b.move.to;
+        return a.move.captures < b.move.captures;
+    };
+    std::sort(records.begin(), records.end(), less);
+    
+    std::vector<Record> merged;
+    for (const Record& record : records) {
+        if (!merged.empty() && merged.back().key == record.key && sameMove(merged.back().move, record.move)) {
+            merged.back().weight += record.weight;
+        } else {
+            merged.push_back(record);
+        }
+    }
+    
+    std::FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file) {
+        std::fprintf(stderr, "Cannot write %s\n", path.c_str());
+        return false;
+    }
+    
+    std::uint8_t header[FILE_HEADER_SIZE] = {'C', 'K', 'B', 'K', FILE_VERSION};
+    writeLittleEndian(header + 8, merged.size(), 8);
+    bool ok = std::fwrite(header, 1, sizeof(header), file) == sizeof(header);
+    
+    for (const Record& record : merged) {
+        std::uint8_t bytes[RECORD_SIZE];
+        writeLittleEndian(bytes, record.key, 8);
+        bytes[8] = record.move.from;
+        bytes[9] = record.move.to;
+        writeLittleEndian(bytes + 10, std::min(record.weight, MAX_WEIGHT), 2);
+        writeLittleEndian(bytes + 12, record.move.captures, 4);
+        ok = ok && std::fwrite(bytes, 1, sizeof(bytes), file) == sizeof(bytes);
+    }
+    
+    ok = (std::fclose(file) == 0) && ok;
+    if (!ok) {
+        std::fprintf(stderr, "Error writing %s\n", path.c_str());
+    }
+    return ok;
+}
@@ -0,0 +1,62 @@
+#ifndef OPENINGBOOK_H
+#define OPENINGBOOK_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "mappedfile.h"
+#include "position.h"
+
+// Opening book: moves known to be good in common early positions, keyed by
+// the position's Zobrist hash. checkers-bookgen builds it.
+//
+// The file is a 16-byte header followed by fixed 16-byte records sorted by
+// key, so it is used straight from a read-only memory mapping: opening it
+// parses nothing and a probe is a binary search over the records.
+//
+// Record layout, little-endian: key (8 bytes), from (1), to (1), weight (2),
+// captures (4).
+class OpeningBook
+{
+public:
+    static constexpr int FILE_HEADER_SIZE = 16;
+    static constexpr int RECORD_SIZE = 16;
+    static constexpr std::uint32_t MAX_WEIGHT = 0xFFFF;
+    
+    struct Record {
+        std::uint64_t key = 0;
+        Move move = Move::invalid();
+        std::uint32_t weight = 0; // How often the move was played
+    };
+    
+    struct BookMove {
+        Move move;
+        int weight;
+    };
+    
+    bool load(const std::string& path);
+    void close();
+    bool isOpen() const { return m_file.isOpen(); }
+    std::size_t recordCount() const { return m_recordCount; }
+    
+    // The position's book moves that are legal in it, most played first
+    std::vector<BookMove> probe(const Position& position) const;
+    
+    // A book move chosen with probability proportional to its weight;
+    // random is any uniformly distributed value. False if out of book.
+    bool pickMove(const Position& position, std::uint64_t random, Move& move) const;
+    
+    // Sorts the records, merges duplicates by adding their weights and
+    // writes a book file
+    static bool write(const std::string& path, std::vector<Record> records);
+    
+private:
+    Record recordAt(std::size_t index) const;
+    
+    MappedFile m_file;
+    const std::uint8_t* m_records = nullptr;
+    std::size_t m_recordCount = 0;
+};
+
+#endif // OPENINGBOOK_H
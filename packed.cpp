@@ -0,0 +1,153 @@
+#include "packed.h"
+
+namespace Packed {
+
+namespace {
+
+void writeUint32(std::uint8_t* out, std::uint32_t value)
+{
+    for (int i = 0; i < 4; ++i) {
+        out[i] = static_cast<std::uint8_t>(value >> (8 * i));
+    }
+}
+
+std::uint32_t readUint32(const std::uint8_t* data)
+{
+    return std::uint32_t(data[0]) | (std::uint32_t(data[1]) << 8)
+           | (std::uint32_t(data[2]) << 16) | (std::uint32_t(data[3]) << 24);
+}
+
+void writeUint64(std::uint8_t* out, std::uint64_t value)
+{
+    for (int i = 0; i < 8; ++i) {
+        out[i] = static_cast<std::uint8_t>(value >> (8 * i));
+    }
+}
+
+std::uint64_t readUint64(const std::uint8_t* data)
+{
+    std::uint64_t value = 0;
+    for (int i = 7; i >= 0; --i) {
+        value = (value << 8) | data[i];
+    }
+    return value;
+}
+
+std::uint8_t stateFlags(const Position& position, PlayerColor winner)
+{
+    return static_cast<std::uint8_t>((position.sideToMove() == PlayerColor::Black ? 1 : 0)
+                                     | (static_cast<int>(winner) << 1));
+}
+
+// Side to move and winner from a flags byte; false if it isn't valid
+bool readFlags(std::uint8_t flags, PlayerColor& sideToMove, PlayerColor& winner)
+{
+    int winnerCode = (flags >> 1) & 3;
+    if ((flags & ~7) || winnerCode > static_cast<int>(PlayerColor::Black)) return false;
+    
+    sideToMove = (flags & 1) ? PlayerColor::Black : PlayerColor::Red;
+    winner = static_cast<PlayerColor>(winnerCode);
+    return true;
+}
+
+} // namespace
+
+Record encode(const Position& position, PlayerColor winner)
+{
+    const Bitboard::Board& board = position.board();
+    
+    Record record;
+    record[0] = VERSION_1;
+    writeUint32(&record[1], board.red);
+    writeUint32(&record[5], board.black);
+    writeUint32(&record[9], board.kings);
+    record[13] = stateFlags(position, winner);
+    return record;
+}
+
+bool decode(const std::uint8_t* data, std::size_t size, Position& position, PlayerColor& winner)
+{
+    if (size != SIZE || data[0] != VERSION_1) return false;
+    
+    Bitboard::Board board;
+    board.red = readUint32(&data[1]);
+    board.black = readUint32(&data[5]);
+    board.kings = readUint32(&data[9]);
+    if ((board.red & board.black) || (board.kings & ~board.occupied())) return false;
+    
+    PlayerColor sideToMove;
+    PlayerColor decodedWinner;
+    if (!readFlags(data[13], sideToMove, decodedWinner)) return false;
+    
+    position.setBoard(board, sideToMove);
+    winner = decodedWinner;
+    return true;
+}
+
+std::vector<std::uint8_t> encodeDelta(const Position& base, const Position& target, PlayerColor winner,
+                                      std::uint32_t sequence)
+{
+    const Bitboard::Board& from = base.board();
+    const Bitboard::Board& to = target.board();
+    Bitboard::Mask changed = (from.red ^ to.red) | (from.black ^ to.black) | (from.kings ^ to.kings);
+    
+    std::vector<std::uint8_t> delta(DELTA_HEADER_SIZE + (Bitboard::popCount(changed) + 1) / 2, 0);
+    delta[0] = DELTA_1;
+    writeUint32(&delta[1], sequence);
+    writeUint64(&delta[5], base.hash());
+    writeUint64(&delta[13], target.hash());
+    writeUint32(&delta[21], changed);
+    delta[25] = stateFlags(target, winner);
+    
+    int index = 0;
+    while (changed) {
+        auto piece = static_cast<std::uint8_t>(target.pieceOn(Bitboard::popLowestSquare(changed)));
+        delta[DELTA_HEADER_SIZE + index / 2] |= (index % 2) ? std::uint8_t(piece << 4) : piece;
+        ++index;
+    }
+    return delta;
+}
+
+DeltaResult applyDelta(const std::uint8_t* data, std::size_t size, Position& position, PlayerColor& winner,
+                       std::uint32_t& sequence)
+{
+    if (size < DELTA_HEADER_SIZE || data[0] != DELTA_1) return DeltaResult::Invalid;
+    
+    Bitboard::Mask changed = readUint32(&data[21]);
+    if (size != DELTA_HEADER_SIZE + (Bitboard::popCount(changed) + 1) / 2) return DeltaResult::Invalid;
+    
+    PlayerColor sideToMove;
+    PlayerColor deltaWinner;
+    if (!readFlags(data[25], sideToMove, deltaWinner)) return DeltaResult::Invalid;
+    
+    std::uint32_t deltaSequence = readUint32(&data[1]);
+    std::uint64_t baseHash = readUint64(&data[5]);
+    std::uint64_t targetHash = readUint64(&data[13]);
+    DeltaResult result = DeltaResult::AlreadyApplied;
+    
+    if (position.hash() != targetHash) {
+        if (position.hash() != baseHash) return DeltaResult::Mismatch;
+        if (deltaSequence != sequence + 1) return DeltaResult::OutOfSequence;
+        
+        Position updated = position;
+        int index = 0;
+        while (changed) {
+            int square = Bitboard::popLowestSquare(changed);
+            int piece = (data[DELTA_HEADER_SIZE + index / 2] >> ((index % 2) * 4)) & 0xF;
+            if (piece > static_cast<int>(Piece::BlackKing)) return DeltaResult::Invalid;
+            updated.setPiece(square, static_cast<Piece>(piece));
+            ++index;
+        }
+        updated.setSideToMove(sideToMove);
+        if (updated.hash() != targetHash) return DeltaResult::Mismatch;
+        
+        position = updated;
+        result = DeltaResult::Applied;
+    }
+    
+    winner = deltaWinner;
+    sequence = deltaSequence;
+    return result;
+}
+
+} // namespace Packed
@@ -0,0 +1,81 @@
+#ifndef PACKED_H
+#define PACKED_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "position.h"
+
+// Compact, versioned position records: network GameState messages, on-disk
+// position files and exact map keys. Also the state deltas peers use to
+// stay in sync without resending whole positions.
+//
+//   byte 0      version tag, 0x81 for this layout
+//   bytes 1-4   Red pieces    (little-endian Bitboard::Mask)
+//   bytes 5-8   Black pieces
+//   bytes 9-12  kings
+//   byte 13     bit 0: Black to move; bits 1-2: the winner's PlayerColor
+//
+// The tag has its high bit set so a record can't be mistaken for the old
+// CheckersGame::serialize layout, 264 bytes of QDataStream ints whose first
+// byte is always zero. A future layout gets a new tag.
+namespace Packed {
+
+constexpr std::uint8_t VERSION_1 = 0x81;
+constexpr std::size_t SIZE = 14;
+
+using Record = std::array<std::uint8_t, SIZE>;
+
+Record encode(const Position& position, PlayerColor winner = PlayerColor::None);
+
+// False, leaving position and winner alone, unless data is a well-formed
+// record: a known tag, no square held by both colours, kings only on
+// occupied squares and valid side and winner fields
+bool decode(const std::uint8_t* data, std::size_t size, Position& position, PlayerColor& winner);
+
+inline bool isPacked(const std::uint8_t* data, std::size_t size)
+{
+    return size >= 1 && data[0] == VERSION_1;
+}
+
+// A delta takes a peer from the state with hash baseHash to the one with
+// targetHash (Position::hash) by listing only the squares that differ:
+//
+//   byte 0       version tag, 0x91 for this layout
+//   bytes 1-4    sequence number of the target state
+//   bytes 5-12   base hash
+//   bytes 13-20  target hash
+//   bytes 21-24  changed squares (Bitboard::Mask)
+//   byte 25      side to move and winner, as in a record
+//   then the new Piece of each changed square, lowest square first, two
+//   per byte with the first in the low nibble
+//
+// Integers are little-endian.
+constexpr std::uint8_t DELTA_1 = 0x91;
+constexpr std::size_t DELTA_HEADER_SIZE = 26;
+
+enum class DeltaResult {
+    Applied,        // position held the base state and now holds the target
+    AlreadyApplied, // position already held the target state
+    Mismatch,       // position holds neither; a full record is needed
+    OutOfSequence,  // position holds the base state, but the delta does not
+                    // follow sequence: one was skipped or this one replayed
+    Invalid         // not a well-formed delta
+};
+
+std::vector<std::uint8_t> encodeDelta(const Position& base, const Position& target, PlayerColor winner,
+                                      std::uint32_t sequence);
+
+// On Applied and AlreadyApplied also sets winner and sequence from the
+// delta; otherwise changes nothing. A delta is only applied if its sequence
+// is the one after sequence; one that finds the target state already there
+// only confirms it, so its sequence is adopted whatever it is. The target
+// hash is checked after the squares are applied, so a delta never leaves a
+// position it can't vouch for.
+DeltaResult applyDelta(const std::uint8_t* data, std::size_t size, Position& position, PlayerColor& winner,
+                       std::uint32_t& sequence);
+
+} // namespace Packed
+
+#endif // PACKED_H
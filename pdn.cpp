@@ -0,0 +1,531 @@
+#include "pdn.h"
+#include <cstring>
+
+namespace {
+
+bool isSpace(char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v';
+}
+
+// Characters that end a symbol token
+bool isDelimiter(char c)
+{
+    return isSpace(c) || c == '[' || c == ']' || c == '{' || c == '}' || c == '(' || c == ')'
+        || c == ';' || c == '"' || c == '$';
+}
+
+bool isResult(std::string_view text)
+{
+    return text == "*" || text == "1-0" || text == "0-1" || text == "1/2-1/2"
+        || text == "2-0" || text == "0-2" || text == "1-1" || text == "0-0";
+}
+
+std::string unescape(std::string_view text)
+{
+    std::string value;
+    value.reserve(text.size());
+    for (std::size_t i = 0; i < text.size(); ++i) {
+        if (text[i] == '\\' && i + 1 < text.size()) ++i;
+        value += text[i];
+    }
+    return value;
+}
+
+std::string escape(const std::string& text)
+{
+    std::string value;
+    value.reserve(text.size());
+    for (char c : text) {
+        if (c == '"' || c == '\\') value += '\\';
+        value += c;
+    }
+    return value;
+}
+
+// The square jumped when a piece goes from a to b, or -1 if that isn't a jump
+int jumpedSquare(int a, int b)
+{
+    int rowDelta = Bitboard::squareRow(b) - Bitboard::squareRow(a);
+    int colDelta = Bitboard::squareCol(b) - Bitboard::squareCol(a);
+    if ((rowDelta != 2 && rowDelta != -2) || (colDelta != 2 && colDelta != -2)) return -1;
+    return Bitboard::squareIndex(Bitboard::squareRow(a) + rowDelta / 2, Bitboard::squareCol(a) + colDelta / 2);
+}
+
+// Depth-first search for a route from square to move.to that jumps each
+// piece in remaining exactly once
+bool findJumpPath(int square, const Move& move, Bitboard::Mask remaining, std::vector<int>& path)
+{
+    path.push_back(square);
+    if (remaining == 0 && square == move.to) return true;
+    
+    static constexpr int STEPS[4][2] = {{-1, -1}, {-1, 1}, {1, -1}, {1, 1}};
+    for (const auto& step : STEPS) {
+        int row = Bitboard::squareRow(square);
+        int col = Bitboard::squareCol(square);
+        int jumped = Bitboard::squareIndex(row + step[0], col + step[1]);
+        int landing = Bitboard::squareIndex(row + 2 * step[0], col + 2 * step[1]);
+        if (jumped < 0 || landing < 0 || !(remaining & Bitboard::bit(jumped))) continue;
+        if (findJumpPath(landing, move, remaining & ~Bitboard::bit(jumped), path)) return true;
+    }
+    path.pop_back();
+    return false;
+}
+
+} // namespace
+
+void PdnGame::clear()
+{
+    tags.clear();
+    start = Pdn::standardStart();
+    moves.clear();
+    result = "*";
+}
+
+std::string PdnGame::tag(std::string_view name) const
+{
+    for (const auto& entry : tags) {
+        if (entry.first == name) return entry.second;
+    }
+    return std::string();
+}
+
+void PdnGame::setTag(const std::string& name, const std::string& value)
+{
+    for (auto& entry : tags) {
+        if (entry.first == name) {
+            entry.second = value;
+            return;
+        }
+    }
+    tags.emplace_back(name, value);
+}
+
+namespace Pdn {
+
+Position standardStart()
+{
+    Position position;
+    position.setSideToMove(PlayerColor::Black);
+    return position;
+}
+
+bool parseSquares(std::string_view text, std::vector<int>& squares)
+{
+    squares.clear();
+    int value = 0;
+    bool inNumber = false;
+    for (char c : text) {
+        if (c >= '0' && c <= '9') {
+            value = value * 10 + (c - '0');
+            if (value > Bitboard::SQUARES) return false;
+            inNumber = true;
+        } else if ((c == '-' || c == 'x') && inNumber) {
+            squares.push_back(value);
+            value = 0;
+            inNumber = false;
+        } else {
+            return false;
+        }
+    }
+    if (!inNumber) return false;
+    squares.push_back(value);
+    
+    for (int square : squares) {
+        if (square < 1) return false;
+    }
+    return squares.size() >= 2;
+}
+
+bool findMove(const Position& position, const std::vector<int>& squares, Move& move)
+{
+    if (squares.size() < 2) return false;
+    
+    MoveList legal;
+    position.generateMoves(legal);
+    const Move* found = nullptr;
+    for (const Move& candidate : legal) {
+        if (candidate.from != squares.front() - 1 || candidate.to != squares.back() - 1) continue;
+        
+        if (squares.size() > 2) {
+            // Each hop jumps the piece halfway between its two landing
+            // squares, and every captured piece is on the path
+            bool matches = Bitboard::popCount(candidate.captures) == static_cast<int>(squares.size()) - 1;
+            for (std::size_t i = 0; i + 1 < squares.size() && matches; ++i) {
+                int jumped = jumpedSquare(squares[i] - 1, squares[i + 1] - 1);
+                matches = jumped >= 0 && (candidate.captures & Bitboard::bit(jumped));
+            }
+            if (!matches) continue;
+        } else if (found) {
+            return false; // Captures with the same ends need the full path
+        }
+        found = &candidate;
+        if (squares.size() > 2) break;
+    }
+    if (!found) return false;
+    move = *found;
+    return true;
+}
+
+bool parseMove(const Position& position, std::string_view text, Move& move)
+{
+    std::vector<int> squares;
+    return parseSquares(text, squares) && findMove(position, squares, move);
+}
+
+std::string moveText(const Move& move)
+{
+    if (!move.isCapture()) {
+        return std::to_string(move.from + 1) + "-" + std::to_string(move.to + 1);
+    }
+    
+    std::vector<int> path;
+    if (!findJumpPath(move.from, move, move.captures, path)) {
+        path = {move.from, move.to};
+    }
+    std::string text;
+    for (std::size_t i = 0; i < path.size(); ++i) {
+        if (i > 0) text += 'x';
+        text += std::to_string(path[i] + 1);
+    }
+    return text;
+}
+
+PlayerColor resultWinner(std::string_view result)
+{
+    if (result == "1-0" || result == "2-0") return PlayerColor::Red;
+    if (result == "0-1" || result == "0-2") return PlayerColor::Black;
+    return PlayerColor::None;
+}
+
+std::string writeGame(const PdnGame& game)
+{
+    std::string text;
+    for (const auto& entry : game.tags) {
+        text += "[" + entry.first + " \"" + escape(entry.second) + "\"]\n";
+    }
+    if (game.tag("FEN").empty() && game.start.toFen() != standardStart().toFen()) {
+        text += "[FEN \"" + game.start.toFen() + "\"]\n";
+    }
+    if (!game.tags.empty()) text += '\n';
+    
+    // Numbered in pairs from the first mover, wrapped at 80 columns
+    std::size_t lineStart = text.size();
+    auto append = [&](const std::string& word) {
+        if (text.size() > lineStart) {
+            if (text.size() - lineStart + 1 + word.size() > 80) {
+                text += '\n';
+                lineStart = text.size();
+            } else {
+                text += ' ';
+            }
+        }
+        text += word;
+    };
+    
+    for (std::size_t ply = 0; ply < game.moves.size(); ++ply) {
+        std::string word = moveText(game.moves[ply]);
+        if (ply % 2 == 0) word = std::to_string(ply / 2 + 1) + ". " + word;
+        append(word);
+    }
+    append(game.result);
+    text += "\n\n";
+    return text;
+}
+
+} // namespace Pdn
+
+bool PdnReader::open(const std::string& path)
+{
+    reset();
+    if (!m_file.open(path)) return false;
+    m_begin = reinterpret_cast<const char*>(m_file.data());
+    m_pos = m_begin;
+    m_end = m_begin + m_file.size();
+    return true;
+}
+
+void PdnReader::setData(std::string_view data)
+{
+    reset();
+    m_begin = data.data();
+    m_pos = m_begin;
+    m_end = m_begin + data.size();
+}
+
+void PdnReader::setStream(std::FILE* file, std::size_t chunkSize)
+{
+    reset();
+    m_stream = file;
+    m_chunkSize = chunkSize > 0 ? chunkSize : DEFAULT_CHUNK_SIZE;
+}
+
+void PdnReader::reset()
+{
+    m_file.close();
+    m_stream = nullptr;
+    m_buffer.clear();
+    m_begin = m_pos = m_end = m_tokenStart = nullptr;
+    m_consumedBefore = 0;
+    m_line = 1;
+    m_pendingTag = false;
+    m_error.clear();
+}
+
+bool PdnReader::refill()
+{
+    if (!m_stream) return false;
+    
+    // Everything before the current token is done with; the rest moves to
+    // the front and the next chunk goes after it
+    std::size_t keep = m_tokenStart ? static_cast<std::size_t>(m_end - m_tokenStart) : 0;
+    std::size_t offset = m_tokenStart ? static_cast<std::size_t>(m_pos - m_tokenStart) : 0;
+    if (m_tokenStart) {
+        m_consumedBefore += static_cast<std::uint64_t>(m_tokenStart - m_begin);
+        std::memmove(m_buffer.data(), m_tokenStart, keep);
+    }
+    if (m_buffer.size() < keep + m_chunkSize) {
+        m_buffer.resize(keep + m_chunkSize);
+    }
+    std::size_t got = std::fread(m_buffer.data() + keep, 1, m_chunkSize, m_stream);
+    
+    m_begin = m_buffer.data();
+    m_tokenStart = m_begin;
+    m_pos = m_begin + offset;
+    m_end = m_begin + keep + got;
+    return got > 0;
+}
+
+bool PdnReader::skipSpaceAndComments()
+{
+    for (;;) {
+        m_tokenStart = m_pos;
+        if (m_pos == m_end && !refill()) return true;
+        
+        char c = *m_pos;
+        if (isSpace(c)) {
+            if (c == '\n') ++m_line;
+            ++m_pos;
+            continue;
+        }
+        if (c == ';') {
+            // To the end of the line
+            while ((m_pos < m_end || refill()) && *m_pos != '\n') ++m_pos;
+            continue;
+        }
+        if (c != '{' && c != '(') return true;
+        
+        // Comments don't nest. Variations do, and are skipped whole,
+        // comments included, since their moves aren't part of the game.
+        int depth = 0;
+        bool inComment = false;
+        do {
+            if (m_pos == m_end) {
+                m_tokenStart = m_pos;
+                if (!refill()) return false;
+            }
+            char skipped = *m_pos++;
+            if (skipped == '\n') {
+                ++m_line;
+            } else if (inComment) {
+                inComment = (skipped != '}');
+            } else if (skipped == '{') {
+                inComment = true;
+            } else if (skipped == '(') {
+                ++depth;
+            } else if (skipped == ')') {
+                --depth;
+            }
+        } while (depth > 0 || inComment);
+    }
+}
+
+bool PdnReader::nextToken(Token& token)
+{
+    token.text = std::string_view();
+    if (!skipSpaceAndComments()) {
+        token.type = TokenType::Error;
+        token.line = m_line;
+        m_error = "unterminated comment or variation";
+        return false;
+    }
+    
+    token.line = m_line;
+    m_tokenStart = m_pos;
+    if (m_pos == m_end) {
+        token.type = TokenType::End;
+        return true;
+    }
+    
+    char c = *m_pos++;
+    switch (c) {
+    case '[':
+        token.type = TokenType::TagOpen;
+        return true;
+    case ']':
+        token.type = TokenType::TagClose;
+        return true;
+    case ')':
+    case '}':
+        token.type = TokenType::Error;
+        m_error = std::string("unexpected '") + c + "'";
+        return false;
+    case '"': {
+        bool escaped = false;
+        for (;;) {
+            if (m_pos == m_end && !refill()) {
+                token.type = TokenType::Error;
+                m_error = "unterminated string";
+                return false;
+            }
+            char next = *m_pos++;
+            if (next == '\n') ++m_line;
+            if (escaped) {
+                escaped = false;
+            } else if (next == '\\') {
+                escaped = true;
+            } else if (next == '"') {
+                break;
+            }
+        }
+        token.type = TokenType::String;
+        token.text = std::string_view(m_tokenStart + 1, static_cast<std::size_t>(m_pos - m_tokenStart) - 2);
+        return true;
+    }
+    default:
+        break;
+    }
+    
+    token.type = (c == '$') ? TokenType::Nag : TokenType::Symbol;
+    while ((m_pos < m_end || refill()) && !isDelimiter(*m_pos)) ++m_pos;
+    token.text = std::string_view(m_tokenStart, static_cast<std::size_t>(m_pos - m_tokenStart));
+    return true;
+}
+
+PdnReader::Status PdnReader::fail(const Token& token, const std::string& message)
+{
+    m_error = "line " + std::to_string(token.line) + ": " + message;
+    skipToNextGame();
+    return Status::Error;
+}
+
+void PdnReader::skipToNextGame()
+{
+    // The game ends at its result, or where the next one's tags start
+    bool inTag = false;
+    bool inMoves = false;
+    Token token;
+    for (;;) {
+        if (!nextToken(token)) {
+            if (m_pos == m_end && !refill()) return;
+            continue;
+        }
+        switch (token.type) {
+        case TokenType::End:
+            return;
+        case TokenType::TagOpen:
+            if (inMoves) {
+                m_pendingTag = true;
+                return;
+            }
+            inTag = true;
+            break;
+        case TokenType::TagClose:
+            inTag = false;
+            break;
+        case TokenType::Symbol:
+            if (inTag) break;
+            if (isResult(token.text)) return;
+            inMoves = true;
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+PdnReader::Status PdnReader::readGame(PdnGame& game)
+{
+    game.clear();
+    m_error.clear();
+    
+    Position position;
+    bool started = false; // Any tag or move read
+    bool inMoves = false;
+    Token token;
+    for (;;) {
+        if (m_pendingTag) {
+            m_pendingTag = false;
+            token.type = TokenType::TagOpen;
+            token.line = m_line;
+        } else if (!nextToken(token)) {
+            return fail(token, m_error);
+        }
+        
+        switch (token.type) {
+        case TokenType::End:
+            return started ? Status::Game : Status::End;
+            
+        case TokenType::TagOpen: {
+            if (inMoves) {
+                // The game had no result
+                m_pendingTag = true;
+                return Status::Game;
+            }
+            started = true;
+            
+            // The name's view only lasts until the next token
+            if (!nextToken(token)) return fail(token, m_error);
+            if (token.type != TokenType::Symbol) return fail(token, "malformed tag");
+            std::string name(token.text);
+            if (!nextToken(token)) return fail(token, m_error);
+            if (token.type != TokenType::String) return fail(token, "malformed tag " + name);
+            std::string value = unescape(token.text);
+            if (!nextToken(token)) return fail(token, m_error);
+            if (token.type != TokenType::TagClose) return fail(token, "malformed tag " + name);
+            
+            if (name == "FEN" && !game.start.fromFen(value)) {
+                return fail(token, "invalid FEN \"" + value + "\"");
+            }
+            game.tags.emplace_back(std::move(name), std::move(value));
+            break;
+        }
+        
+        case TokenType::Symbol: {
+            std::string_view text = token.text;
+            if (isResult(text)) {
+                game.result = std::string(text);
+                return Status::Game;
+            }
+            
+            // Move numbers, either alone ("12.", "12...") or run into the
+            // move ("12.11-15"), and annotations such as "!" or "?!"
+            std::size_t dot = text.rfind('.');
+            if (dot != std::string_view::npos) text.remove_prefix(dot + 1);
+            while (!text.empty() && (text.back() == '!' || text.back() == '?')) text.remove_suffix(1);
+            if (text.empty()) break;
+            
+            if (!inMoves) {
+                position = game.start;
+                inMoves = true;
+                started = true;
+            }
+            Move move;
+            if (!Pdn::parseSquares(text, m_squares) || !Pdn::findMove(position, m_squares, move)) {
+                return fail(token, "illegal move " + std::string(text) + " after "
+                                   + std::to_string(game.moves.size()) + " plies");
+            }
+            UndoRecord undo;
+            position.doMove(move, undo);
+            game.moves.push_back(move);
+            break;
+        }
+        
+        case TokenType::Nag:
+            break;
+            
+        default:
+            return fail(token, "unexpected " + std::string(token.type == TokenType::String ? "string" : "']'"));
+        }
+    }
+}
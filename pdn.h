@@ -0,0 +1,124 @@
+#ifndef PDN_H
+#define PDN_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "mappedfile.h"
+#include "position.h"
+
+// Portable Draughts Notation game records.
+//
+// Squares use the usual 1-32 numbering and FEN's White is Red. Without a
+// FEN tag a game starts from the standard position with Black to move, as
+// PDN files from other programs expect; games from this program start with
+// Red to move, so they are always written with a FEN tag.
+struct PdnGame;
+
+namespace Pdn {
+
+// "B:W21-32:B1-12"
+Position standardStart();
+
+// Splits "11-15", "9x18x27" or "9x27" into squares (1-32); false if it
+// isn't a move
+bool parseSquares(std::string_view text, std::vector<int>& squares);
+
+// The legal move that squares describe. Intermediate squares pick between
+// captures with the same ends; without them such a move is ambiguous.
+bool findMove(const Position& position, const std::vector<int>& squares, Move& move);
+bool parseMove(const Position& position, std::string_view text, Move& move);
+
+// "11-15", or the full jump path such as "9x18x27"
+std::string moveText(const Move& move);
+
+// The side a result such as "1-0" or "0-2" scores as the winner, from
+// White's (Red's) side first; None for a draw or an unfinished game
+PlayerColor resultWinner(std::string_view result);
+
+// Tags, a blank line, the movetext wrapped at about 80 columns and a
+// blank line after
+std::string writeGame(const PdnGame& game);
+
+} // namespace Pdn
+
+struct PdnGame {
+    std::vector<std::pair<std::string, std::string>> tags; // In file order
+    Position start = Pdn::standardStart();
+    std::vector<Move> moves;
+    std::string result = "*";
+    
+    void clear();
+    std::string tag(std::string_view name) const; // Empty if absent
+    void setTag(const std::string& name, const std::string& value);
+};
+
+// Reads games one at a time from a memory-mapped file, a caller's buffer or
+// a stream read in fixed-size chunks. Tokens are views into the input, so
+// nothing is copied but tag values, and memory use doesn't grow with the
+// size of the input. Every move is checked against the rules as it is read.
+class PdnReader
+{
+public:
+    enum class Status {
+        Game,  // game holds the next game
+        End,   // No more games
+        Error  // The next game is invalid; see error(). Reading can continue.
+    };
+    
+    static constexpr std::size_t DEFAULT_CHUNK_SIZE = 1 << 20;
+    
+    bool open(const std::string& path);
+    void setData(std::string_view data); // Not copied; must outlive the reader
+    void setStream(std::FILE* file, std::size_t chunkSize = DEFAULT_CHUNK_SIZE);
+    
+    Status readGame(PdnGame& game);
+    
+    const std::string& error() const { return m_error; }
+    std::uint64_t bytesRead() const { return m_consumedBefore + static_cast<std::uint64_t>(m_pos - m_begin); }
+    
+private:
+    enum class TokenType {
+        End,
+        TagOpen,   // [
+        TagClose,  // ]
+        String,    // "..." without the quotes, escapes still in place
+        Symbol,    // Tag names, moves, move numbers and results
+        Nag,       // $12
+        Error
+    };
+    
+    struct Token {
+        TokenType type = TokenType::End;
+        std::string_view text;
+        int line = 0;
+    };
+    
+    void reset();
+    bool refill();
+    bool nextToken(Token& token);
+    bool skipSpaceAndComments();
+    Status fail(const Token& token, const std::string& message);
+    void skipToNextGame();
+    
+    MappedFile m_file;
+    std::FILE* m_stream = nullptr;
+    std::vector<char> m_buffer;
+    std::size_t m_chunkSize = DEFAULT_CHUNK_SIZE;
+    
+    const char* m_begin = nullptr;
+    const char* m_pos = nullptr;
+    const char* m_end = nullptr;
+    const char* m_tokenStart = nullptr; // Kept when the buffer is refilled
+    std::uint64_t m_consumedBefore = 0;
+    int m_line = 1;
+    
+    bool m_pendingTag = false; // A '[' read ahead, which starts the next game
+    std::vector<int> m_squares; // Reused for every move
+    std::string m_error;
+};
+
+#endif // PDN_H
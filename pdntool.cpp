@@ -0,0 +1,130 @@
+#include "pdn.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+// PDN archive checker and converter.
+//
+//   checkers-pdn <input> [options]
+//
+// Reads every game in the input, checking each move against the rules, and
+// reports the games that don't parse. Files are memory-mapped; "-" reads
+// standard input in chunks. Either way memory use stays the same however
+// large the archive is.
+//
+// Options:
+//   --output <file>     Write the valid games here, with full jump paths and
+//                       FEN tags where needed ("-" for standard output)
+//   --stream            Read the input file in chunks instead of mapping it
+//   --chunk-size <KiB>  Chunk size for --stream and standard input (default: 1024)
+//   --max-errors <n>    Errors printed before going quiet (default: 20)
+
+namespace {
+
+struct Options {
+    std::string inputPath;
+    std::string outputPath;
+    bool stream = false;
+    std::size_t chunkSize = PdnReader::DEFAULT_CHUNK_SIZE;
+    long maxErrors = 20;
+};
+
+void printUsage()
+{
+    std::fprintf(stderr,
+        "Usage: checkers-pdn <input> [--output <file>] [--stream] [--chunk-size <KiB>] [--max-errors <n>]\n");
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+            options.outputPath = argv[++i];
+        } else if (std::strcmp(argv[i], "--stream") == 0) {
+            options.stream = true;
+        } else if (std::strcmp(argv[i], "--chunk-size") == 0 && i + 1 < argc) {
+            options.chunkSize = static_cast<std::size_t>(std::max(std::atol(argv[++i]), 1L)) * 1024;
+        } else if (std::strcmp(argv[i], "--max-errors") == 0 && i + 1 < argc) {
+            options.maxErrors = std::atol(argv[++i]);
+        } else if (options.inputPath.empty() && (argv[i][0] != '-' || std::strcmp(argv[i], "-") == 0)) {
+            options.inputPath = argv[i];
+        } else {
+            printUsage();
+            return 1;
+        }
+    }
+    if (options.inputPath.empty()) {
+        printUsage();
+        return 1;
+    }
+    
+    PdnReader reader;
+    std::FILE* input = nullptr;
+    if (options.inputPath == "-") {
+        reader.setStream(stdin, options.chunkSize);
+    } else if (options.stream) {
+        input = std::fopen(options.inputPath.c_str(), "rb");
+        if (!input) {
+            std::fprintf(stderr, "Cannot read %s\n", options.inputPath.c_str());
+            return 1;
+        }
+        reader.setStream(input, options.chunkSize);
+    } else if (!reader.open(options.inputPath)) {
+        std::fprintf(stderr, "Cannot map %s\n", options.inputPath.c_str());
+        return 1;
+    }
+    
+    std::FILE* output = nullptr;
+    if (options.outputPath == "-") {
+        output = stdout;
+    } else if (!options.outputPath.empty()) {
+        output = std::fopen(options.outputPath.c_str(), "wb");
+        if (!output) {
+            std::fprintf(stderr, "Cannot write %s\n", options.outputPath.c_str());
+            return 1;
+        }
+    }
+    
+    auto started = std::chrono::steady_clock::now();
+    std::uint64_t games = 0;
+    std::uint64_t moves = 0;
+    std::uint64_t errors = 0;
+    PdnGame game;
+    for (;;) {
+        PdnReader::Status status = reader.readGame(game);
+        if (status == PdnReader::Status::End) break;
+        
+        if (status == PdnReader::Status::Error) {
+            if (static_cast<long>(++errors) <= options.maxErrors) {
+                std::fprintf(stderr, "%s\n", reader.error().c_str());
+            }
+            continue;
+        }
+        
+        ++games;
+        moves += game.moves.size();
+        if (output) {
+            std::string text = Pdn::writeGame(game);
+            std::fwrite(text.data(), 1, text.size(), output);
+        }
+    }
+    
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    double megabytes = static_cast<double>(reader.bytesRead()) / (1024.0 * 1024.0);
+    std::fprintf(stderr, "%llu games, %llu moves, %llu invalid games\n",
+                 static_cast<unsigned long long>(games), static_cast<unsigned long long>(moves),
+                 static_cast<unsigned long long>(errors));
+    std::fprintf(stderr, "%.1f MB in %.2f s (%.1f MB/s, %.0f games/s)\n", megabytes, seconds,
+                 seconds > 0 ? megabytes / seconds : 0.0,
+                 seconds > 0 ? static_cast<double>(games + errors) / seconds : 0.0);
+    
+    if (input) std::fclose(input);
+    if (output && output != stdout) std::fclose(output);
+    return errors == 0 ? 0 : 2;
+}
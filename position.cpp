@@ -0,0 +1,518 @@
+#include "position.h"
+#include "zobrist.h"
+#include <charconv>
+
+using Bitboard::Mask;
+
+namespace {
+
+Mask playerPieces(const Bitboard::Board& board, PlayerColor player)
+{
+    return player == PlayerColor::Red ? board.red : board.black;
+}
+
+// Compile-time description of each side, so move generation and make/unmake
+// are instantiated per colour and never test the side to move in a loop
+template <PlayerColor Side>
+struct SideTraits;
+
+template <>
+struct SideTraits<PlayerColor::Red> {
+    static constexpr bool RED = true;
+    static constexpr Bitboard::Mover MAN = Bitboard::RedMan;
+    static constexpr Mask PROMOTION_ROW = Bitboard::TOP_ROW;
+    static constexpr Mask Bitboard::Board::* OWN = &Bitboard::Board::red;
+    static constexpr Mask Bitboard::Board::* OPP = &Bitboard::Board::black;
+};
+
+template <>
+struct SideTraits<PlayerColor::Black> {
+    static constexpr bool RED = false;
+    static constexpr Bitboard::Mover MAN = Bitboard::BlackMan;
+    static constexpr Mask PROMOTION_ROW = Bitboard::BOTTOM_ROW;
+    static constexpr Mask Bitboard::Board::* OWN = &Bitboard::Board::black;
+    static constexpr Mask Bitboard::Board::* OPP = &Bitboard::Board::red;
+};
+
+// Pieces of the given colour with at least one jump available. Red men jump
+// upwards, Black men downwards, kings both ways.
+template <PlayerColor Side>
+Mask capturingPieces(const Bitboard::Board& board)
+{
+    using namespace Bitboard;
+    using Traits = SideTraits<Side>;
+    
+    const Mask empty = board.empty();
+    const Mask own = board.*Traits::OWN;
+    const Mask opp = board.*Traits::OPP;
+    
+    // Shift the landing squares back over an opponent to find the jumper
+    Mask upJumpers = downRight(downRight(empty) & opp) | downLeft(downLeft(empty) & opp);
+    Mask downJumpers = upLeft(upLeft(empty) & opp) | upRight(upRight(empty) & opp);
+    
+    if constexpr (Traits::RED) {
+        return (own & upJumpers) | (own & board.kings & downJumpers);
+    } else {
+        return (own & downJumpers) | (own & board.kings & upJumpers);
+    }
+}
+
+// Pieces of the given colour with at least one non-capturing step available
+template <PlayerColor Side>
+Mask steppingPieces(const Bitboard::Board& board)
+{
+    using namespace Bitboard;
+    using Traits = SideTraits<Side>;
+    
+    const Mask empty = board.empty();
+    const Mask own = board.*Traits::OWN;
+    
+    Mask upMovers = downRight(empty) | downLeft(empty);
+    Mask downMovers = upLeft(empty) | upRight(empty);
+    
+    if constexpr (Traits::RED) {
+        return (own & upMovers) | (own & board.kings & downMovers);
+    } else {
+        return (own & downMovers) | (own & board.kings & upMovers);
+    }
+}
+
+Mask capturingPieces(const Bitboard::Board& board, PlayerColor player)
+{
+    return player == PlayerColor::Red ? capturingPieces<PlayerColor::Red>(board)
+                                      : capturingPieces<PlayerColor::Black>(board);
+}
+
+Mask steppingPieces(const Bitboard::Board& board, PlayerColor player)
+{
+    return player == PlayerColor::Red ? steppingPieces<PlayerColor::Red>(board)
+                                      : steppingPieces<PlayerColor::Black>(board);
+}
+
+// Red moves up (negative y), Black moves down (positive y). Targets come out
+// in Direction order because the squares above have lower indices.
+template <Bitboard::Mover M>
+void appendSteps(int square, Mask empty, MoveList& moves)
+{
+    Mask targets = Bitboard::GEOMETRY.steps[M][square] & empty;
+    while (targets) {
+        moves.append({static_cast<std::uint8_t>(square),
+                      static_cast<std::uint8_t>(Bitboard::popLowestSquare(targets)), 0});
+    }
+}
+
+template <Bitboard::Mover M>
+void findMultiJumps(int square, int original, Mask opponents, Mask empty, Mask captured,
+                    MoveList& moves)
+{
+    const Bitboard::Geometry& geometry = Bitboard::GEOMETRY;
+    bool foundJump = false;
+    
+    for (int dir = Bitboard::FIRST_DIRECTION[M]; dir < Bitboard::END_DIRECTION[M]; ++dir) {
+        // Jump over an opponent piece to an empty square
+        Mask mid = geometry.neighbour[square][dir] & opponents;
+        if (!mid) continue;
+        
+        Mask to = geometry.landing[square][dir] & empty;
+        if (!to) continue;
+        
+        foundJump = true;
+        
+        // Captured pieces are lifted immediately so they can't be jumped twice
+        findMultiJumps<M>(Bitboard::lowestSquare(to), original,
+                          opponents & ~mid, empty, captured | mid, moves);
+    }
+    
+    // If no more jumps found and we've made at least one capture, record the move
+    if (foundJump || !captured) return;
+    
+    // A king can take the same pieces along different paths; those are one
+    // move. A man's captures fix its path, so only kings need the check.
+    if constexpr (M == Bitboard::King) {
+        for (int i = moves.size() - 1; i >= 0 && moves[i].from == original; --i) {
+            if (moves[i].to == square && moves[i].captures == captured) return;
+        }
+    }
+    
+    moves.append({static_cast<std::uint8_t>(original), static_cast<std::uint8_t>(square), captured});
+}
+
+// Pieces are visited in square order, so the move order is the same as
+// generating square by square whatever mix of men and kings is on the board
+template <PlayerColor Side>
+void generateMovesFor(const Bitboard::Board& board, Mask pieces, MoveList& moves)
+{
+    using Traits = SideTraits<Side>;
+    
+    const Mask empty = board.empty();
+    
+    // If the player has any capture available, they must capture
+    Mask jumpers = capturingPieces<Side>(board);
+    
+    if (jumpers) {
+        const Mask opponents = board.*Traits::OPP;
+        jumpers &= pieces;
+        while (jumpers) {
+            int square = Bitboard::popLowestSquare(jumpers);
+            
+            // The moving piece leaves its square, so a jump sequence may pass back over it
+            if (board.kings & Bitboard::bit(square)) {
+                findMultiJumps<Bitboard::King>(square, square, opponents, empty | Bitboard::bit(square), 0, moves);
+            } else {
+                findMultiJumps<Traits::MAN>(square, square, opponents, empty, 0, moves);
+            }
+        }
+        return;
+    }
+    
+    Mask steppers = steppingPieces<Side>(board) & pieces;
+    while (steppers) {
+        int square = Bitboard::popLowestSquare(steppers);
+        if (board.kings & Bitboard::bit(square)) {
+            appendSteps<Bitboard::King>(square, empty, moves);
+        } else {
+            appendSteps<Traits::MAN>(square, empty, moves);
+        }
+    }
+}
+
+Zobrist::PieceKind kindOf(Piece piece)
+{
+    return Zobrist::pieceKind(Position::pieceOwner(piece) == PlayerColor::Red, Position::isKing(piece));
+}
+
+void appendFenPieces(std::string& fen, char color, Mask pieces, Mask kings)
+{
+    fen += ':';
+    fen += color;
+    bool first = true;
+    while (pieces) {
+        int square = Bitboard::popLowestSquare(pieces);
+        if (!first) fen += ',';
+        if (kings & Bitboard::bit(square)) fen += 'K';
+        fen += std::to_string(square + 1);
+        first = false;
+    }
+}
+
+bool parseSquare(std::string_view text, int& square)
+{
+    int number = 0;
+    auto result = std::from_chars(text.data(), text.data() + text.size(), number);
+    if (result.ec != std::errc() || result.ptr != text.data() + text.size()) return false;
+    if (number < 1 || number > Bitboard::SQUARES) return false;
+    square = number - 1;
+    return true;
+}
+
+} // namespace
+
+Position::Position()
+{
+    reset();
+}
+
+void Position::reset()
+{
+    // Black fills the top 3 rows (squares 0-11), Red the bottom 3 (20-31)
+    m_board.black = 0x00000FFFu;
+    m_board.red = 0xFFF00000u;
+    m_board.kings = 0;
+    m_sideToMove = PlayerColor::Red; // Red goes first
+    m_hash = Zobrist::hashBoard(m_board, false);
+}
+
+void Position::clear()
+{
+    m_board = Bitboard::Board();
+    m_sideToMove = PlayerColor::Red;
+    m_hash = 0;
+}
+
+Piece Position::pieceOn(int square) const
+{
+    Mask b = Bitboard::bit(square);
+    bool king = (m_board.kings & b) != 0;
+    if (m_board.red & b) {
+        return king ? Piece::RedKing : Piece::Red;
+    }
+    if (m_board.black & b) {
+        return king ? Piece::BlackKing : Piece::Black;
+    }
+    return Piece::Empty;
+}
+
+void Position::setPiece(int square, Piece piece)
+{
+    Piece previous = pieceOn(square);
+    if (previous != Piece::Empty) {
+        m_hash ^= Zobrist::pieceKey(kindOf(previous), square);
+    }
+    
+    Mask b = Bitboard::bit(square);
+    m_board.red &= ~b;
+    m_board.black &= ~b;
+    m_board.kings &= ~b;
+    
+    switch (pieceOwner(piece)) {
+        case PlayerColor::Red:
+            m_board.red |= b;
+            break;
+        case PlayerColor::Black:
+            m_board.black |= b;
+            break;
+        default:
+            return;
+    }
+    if (isKing(piece)) {
+        m_board.kings |= b;
+    }
+    m_hash ^= Zobrist::pieceKey(kindOf(piece), square);
+}
+
+void Position::setSideToMove(PlayerColor player)
+{
+    if ((player == PlayerColor::Black) != (m_sideToMove == PlayerColor::Black)) {
+        m_hash ^= Zobrist::KEYS.blackToMove;
+    }
+    m_sideToMove = player;
+}
+
+void Position::setBoard(const Bitboard::Board& board, PlayerColor sideToMove)
+{
+    m_board = board;
+    m_sideToMove = sideToMove;
+    m_hash = Zobrist::hashBoard(m_board, sideToMove == PlayerColor::Black);
+}
+
+Mask Position::pieces(PlayerColor player) const
+{
+    return playerPieces(m_board, player);
+}
+
+PlayerColor Position::pieceOwner(Piece piece)
+{
+    switch (piece) {
+        case Piece::Red:
+        case Piece::RedKing:
+            return PlayerColor::Red;
+        case Piece::Black:
+        case Piece::BlackKing:
+            return PlayerColor::Black;
+        default:
+            return PlayerColor::None;
+    }
+}
+
+bool Position::isKing(Piece piece)
+{
+    return piece == Piece::RedKing || piece == Piece::BlackKing;
+}
+
+PlayerColor Position::opponent(PlayerColor player)
+{
+    return (player == PlayerColor::Red) ? PlayerColor::Black : PlayerColor::Red;
+}
+
+bool Position::hasCapture(PlayerColor player) const
+{
+    return capturingPieces(m_board, player) != 0;
+}
+
+Mask Position::movablePieces(PlayerColor player) const
+{
+    // If there's a capture available, only pieces that can capture may move
+    Mask jumpers = capturingPieces(m_board, player);
+    if (jumpers) {
+        return jumpers;
+    }
+    return steppingPieces(m_board, player);
+}
+
+void Position::generateMoves(MoveList& moves) const
+{
+    moves.clear();
+    generateMoves(m_sideToMove, playerPieces(m_board, m_sideToMove), moves);
+}
+
+void Position::generateMoves(PlayerColor player, Mask pieces, MoveList& moves) const
+{
+    if (player == PlayerColor::Red) {
+        generateMovesFor<PlayerColor::Red>(m_board, pieces, moves);
+    } else {
+        generateMovesFor<PlayerColor::Black>(m_board, pieces, moves);
+    }
+}
+
+void Position::doMove(const Move& move, UndoRecord& undo)
+{
+    if (m_sideToMove == PlayerColor::Red) {
+        doMoveFor<PlayerColor::Red>(move, undo);
+    } else {
+        doMoveFor<PlayerColor::Black>(move, undo);
+    }
+}
+
+void Position::undoMove(const UndoRecord& undo)
+{
+    // The side that made the move is the one not to move now
+    if (m_sideToMove == PlayerColor::Black) {
+        undoMoveFor<PlayerColor::Red>(undo);
+    } else {
+        undoMoveFor<PlayerColor::Black>(undo);
+    }
+}
+
+template <PlayerColor Side>
+void Position::doMoveFor(const Move& move, UndoRecord& undo)
+{
+    using Traits = SideTraits<Side>;
+    
+    Mask from = Bitboard::bit(move.from);
+    Mask to = Bitboard::bit(move.to);
+    constexpr bool red = Traits::RED;
+    Mask& own = m_board.*Traits::OWN;
+    Mask& opp = m_board.*Traits::OPP;
+    
+    undo.move = move;
+    undo.capturedKings = move.captures & m_board.kings;
+    undo.crowned = false;
+    undo.hash = m_hash;
+    
+    bool king = (m_board.kings & from) != 0;
+    m_hash ^= Zobrist::pieceKey(Zobrist::pieceKind(red, king), move.from);
+    
+    // A king's jump sequence may end on its starting square, so clear before setting
+    own = (own & ~from) | to;
+    if (king) {
+        m_board.kings = (m_board.kings & ~from) | to;
+    } else if (to & Traits::PROMOTION_ROW) {
+        m_board.kings |= to;
+        undo.crowned = true;
+    }
+    m_hash ^= Zobrist::pieceKey(Zobrist::pieceKind(red, king || undo.crowned), move.to);
+    
+    // Remove captured pieces
+    if (move.captures) {
+        m_hash ^= Zobrist::maskKey(Zobrist::pieceKind(!red, false), move.captures & ~undo.capturedKings);
+        m_hash ^= Zobrist::maskKey(Zobrist::pieceKind(!red, true), undo.capturedKings);
+        opp &= ~move.captures;
+        m_board.kings &= ~move.captures;
+    }
+    
+    m_sideToMove = red ? PlayerColor::Black : PlayerColor::Red;
+    m_hash ^= Zobrist::KEYS.blackToMove;
+}
+
+template <PlayerColor Side>
+void Position::undoMoveFor(const UndoRecord& undo)
+{
+    using Traits = SideTraits<Side>;
+    
+    m_sideToMove = Side;
+    
+    Mask from = Bitboard::bit(undo.move.from);
+    Mask to = Bitboard::bit(undo.move.to);
+    Mask& own = m_board.*Traits::OWN;
+    Mask& opp = m_board.*Traits::OPP;
+    
+    own = (own & ~to) | from;
+    if (undo.crowned) {
+        m_board.kings &= ~to;
+    } else if (m_board.kings & to) {
+        m_board.kings = (m_board.kings & ~to) | from;
+    }
+    
+    // Put captured pieces back
+    opp |= undo.move.captures;
+    m_board.kings |= undo.capturedKings;
+    
+    m_hash = undo.hash;
+}
+
+std::uint64_t Position::perft(int depth)
+{
+    if (depth <= 0) return 1;
+    
+    MoveList moves;
+    generateMoves(moves);
+    
+    if (depth == 1) return static_cast<std::uint64_t>(moves.size());
+    
+    std::uint64_t nodes = 0;
+    UndoRecord undo;
+    
+    for (const Move& move : moves) {
+        doMove(move, undo);
+        nodes += perft(depth - 1);
+        undoMove(undo);
+    }
+    
+    return nodes;
+}
+
+std::string Position::toFen() const
+{
+    std::string fen(1, m_sideToMove == PlayerColor::Black ? 'B' : 'W');
+    appendFenPieces(fen, 'W', m_board.red, m_board.kings);
+    appendFenPieces(fen, 'B', m_board.black, m_board.kings);
+    return fen;
+}
+
+bool Position::fromFen(std::string_view fen)
+{
+    // Tolerate surrounding quotes, whitespace and a trailing period
+    while (!fen.empty() && (fen.front() == '"' || fen.front() == ' ')) fen.remove_prefix(1);
+    while (!fen.empty() && (fen.back() == '"' || fen.back() == ' ' || fen.back() == '.'
+                            || fen.back() == '\r' || fen.back() == '\n')) {
+        fen.remove_suffix(1);
+    }
+    
+    if (fen.size() < 1 || (fen[0] != 'W' && fen[0] != 'B')) return false;
+    
+    Position parsed;
+    parsed.clear();
+    parsed.setSideToMove(fen[0] == 'B' ? PlayerColor::Black : PlayerColor::Red);
+    fen.remove_prefix(1);
+    
+    // Each field is ":W<squares>" or ":B<squares>"
+    while (!fen.empty()) {
+        if (fen.size() < 2 || fen[0] != ':' || (fen[1] != 'W' && fen[1] != 'B')) return false;
+        bool red = (fen[1] == 'W');
+        fen.remove_prefix(2);
+        
+        size_t end = fen.find(':');
+        std::string_view field = fen.substr(0, end);
+        fen.remove_prefix(end == std::string_view::npos ? fen.size() : end);
+        
+        while (!field.empty()) {
+            size_t comma = field.find(',');
+            std::string_view entry = field.substr(0, comma);
+            field.remove_prefix(comma == std::string_view::npos ? field.size() : comma + 1);
+            
+            bool king = !entry.empty() && entry[0] == 'K';
+            if (king) entry.remove_prefix(1);
+            
+            // Ranges such as "1-12" are allowed
+            int first = 0;
+            int last = 0;
+            size_t dash = entry.find('-');
+            if (dash == std::string_view::npos) {
+                if (!parseSquare(entry, first)) return false;
+                last = first;
+            } else if (!parseSquare(entry.substr(0, dash), first)
+                       || !parseSquare(entry.substr(dash + 1), last) || last < first) {
+                return false;
+            }
+            
+            Piece piece = red ? (king ? Piece::RedKing : Piece::Red)
+                              : (king ? Piece::BlackKing : Piece::Black);
+            for (int square = first; square <= last; ++square) {
+                parsed.setPiece(square, piece);
+            }
+        }
+    }
+    
+    *this = parsed;
+    return true;
+}
@@ -0,0 +1,92 @@
+#ifndef POSITION_H
+#define POSITION_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include "bitboard.h"
+#include "movelist.h"
+
+// Piece types
+enum class Piece : int {
+    Empty = 0,
+    Red = 1,
+    Black = 2,
+    RedKing = 3,
+    BlackKing = 4
+};
+
+// Player colors
+enum class PlayerColor : int {
+    None = 0,
+    Red = 1,
+    Black = 2
+};
+
+// Everything undoMove needs to take back a doMove
+struct UndoRecord {
+    Move move;
+    Bitboard::Mask capturedKings; // Which of move.captures were kings
+    bool crowned;
+    std::uint64_t hash; // Position hash before the move
+};
+
+// The rules of American checkers on a plain, trivially copyable value: piece
+// placement, side to move and an incrementally maintained Zobrist hash. It
+// has no Qt dependency, so engines, tools and worker threads can keep
+// positions by value and copy them with memcpy. CheckersGame wraps one of
+// these for the GUI.
+class Position
+{
+public:
+    Position(); // Standard starting position, Red to move
+    
+    void reset();
+    void clear(); // No pieces, Red to move
+    
+    Piece pieceOn(int square) const;
+    void setPiece(int square, Piece piece);
+    PlayerColor sideToMove() const { return m_sideToMove; }
+    void setSideToMove(PlayerColor player);
+    const Bitboard::Board& board() const { return m_board; }
+    void setBoard(const Bitboard::Board& board, PlayerColor sideToMove);
+    Bitboard::Mask pieces(PlayerColor player) const;
+    
+    // 64-bit Zobrist key of the pieces and side to move
+    std::uint64_t hash() const { return m_hash; }
+    
+    // Move generation. Captures are mandatory, so when a player can jump
+    // only jumping pieces are movable.
+    bool hasCapture(PlayerColor player) const;
+    Bitboard::Mask movablePieces(PlayerColor player) const;
+    void generateMoves(MoveList& moves) const; // All legal moves for the side to move
+    void generateMoves(PlayerColor player, Bitboard::Mask pieces, MoveList& moves) const;
+    
+    // Unchecked make/unmake. The move must be legal for the side to move
+    // (e.g. from generateMoves), and moves must be undone in reverse order.
+    void doMove(const Move& move, UndoRecord& undo);
+    void undoMove(const UndoRecord& undo);
+    
+    // Count leaf nodes of the legal move tree
+    std::uint64_t perft(int depth);
+    
+    // PDN FEN, e.g. "W:W21,22,K5:B1,2". W is Red (squares 21-32 at the
+    // start), B is Black; squares use the usual 1-32 numbering.
+    std::string toFen() const;
+    bool fromFen(std::string_view fen);
+    
+    static PlayerColor pieceOwner(Piece piece);
+    static bool isKing(Piece piece);
+    static PlayerColor opponent(PlayerColor player);
+    
+private:
+    Bitboard::Board m_board;
+    PlayerColor m_sideToMove = PlayerColor::Red;
+    std::uint64_t m_hash = 0;
+    
+    // doMove/undoMove for a side known at compile time
+    template <PlayerColor Side> void doMoveFor(const Move& move, UndoRecord& undo);
+    template <PlayerColor Side> void undoMoveFor(const UndoRecord& undo);
+};
+
+#endif // POSITION_H
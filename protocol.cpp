@@ -0,0 +1,118 @@
+#include "protocol.h"
+#include "checkersgame.h"
+#include <QDataStream>
+#include <QIODevice>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTcpSocket>
+
+namespace Protocol {
+
+QByteArray movePayload(const Move& move, quint32 sequence, quint64 hash)
+{
+    QByteArray payload;
+    QDataStream stream(&payload, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_5_15);
+    QPoint from = CheckersGame::squareToPoint(move.from);
+    QPoint to = CheckersGame::squareToPoint(move.to);
+    stream << from.x() << from.y() << to.x() << to.y();
+    stream << sequence << hash;
+    return payload;
+}
+
+bool readMove(const QByteArray& payload, Move& move, quint32& sequence, quint64& hash)
+{
+    QDataStream stream(payload);
+    stream.setVersion(QDataStream::Qt_5_15);
+    
+    int fromX, fromY, toX, toY;
+    stream >> fromX >> fromY >> toX >> toY >> sequence >> hash;
+    if (stream.status() != QDataStream::Ok) return false;
+    
+    int from = CheckersGame::pointToSquare(QPoint(fromX, fromY));
+    int to = CheckersGame::pointToSquare(QPoint(toX, toY));
+    if (from < 0 || to < 0) return false;
+    
+    move = Move::between(from, to);
+    return true;
+}
+
+QByteArray gameStatePayload(quint32 sequence, const QByteArray& state)
+{
+    QByteArray payload;
+    QDataStream stream(&payload, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_5_15);
+    stream << sequence << state;
+    return payload;
+}
+
+bool readGameState(const QByteArray& payload, QByteArray& state, quint32& sequence)
+{
+    QDataStream stream(payload);
+    stream.setVersion(QDataStream::Qt_5_15);
+    stream >> sequence >> state;
+    return stream.status() == QDataStream::Ok;
+}
+
+QByteArray playerReadyPayload(const QString& name)
+{
+    QJsonObject info;
+    info["name"] = name;
+    return QJsonDocument(info).toJson(QJsonDocument::Compact);
+}
+
+QString readPlayerName(const QByteArray& payload)
+{
+    QJsonDocument doc = QJsonDocument::fromJson(payload);
+    return doc.isObject() ? doc.object()["name"].toString() : QString();
+}
+
+QByteArray seatPayload(PlayerColor color)
+{
+    return QByteArray(1, static_cast<char>(color));
+}
+
+bool readSeat(const QByteArray& payload, PlayerColor& color)
+{
+    if (payload.size() != 1) return false;
+    
+    PlayerColor seat = static_cast<PlayerColor>(payload[0]);
+    if (seat != PlayerColor::Red && seat != PlayerColor::Black) return false;
+    color = seat;
+    return true;
+}
+
+bool writeFrame(QTcpSocket* socket, Framing::FrameWriter& writer, MessageType type, const QByteArray& payload)
+{
+    if (!writer.build(static_cast<std::uint8_t>(type), reinterpret_cast<const std::uint8_t*>(payload.constData()),
+                      static_cast<std::size_t>(payload.size()))) {
+        return false;
+    }
+    socket->write(reinterpret_cast<const char*>(writer.data()), static_cast<qint64>(writer.size()));
+    return true;
+}
+
+ReadResult readFrames(QTcpSocket* socket, Framing::FrameReader& reader, const FrameHandler& handler)
+{
+    // Frames left from an earlier, stopped call come first; then read
+    // straight into the frame ring and handle every complete message before
+    // reading more
+    forever {
+        Framing::Frame frame;
+        Framing::FrameReader::Status status;
+        while ((status = reader.next(frame)) == Framing::FrameReader::Status::Frame) {
+            QByteArray payload = QByteArray::fromRawData(reinterpret_cast<const char*>(frame.payload),
+                                                         static_cast<int>(frame.payloadSize));
+            if (!handler(static_cast<MessageType>(frame.type), payload)) return ReadResult::Stopped;
+        }
+        if (status == Framing::FrameReader::Status::Malformed) return ReadResult::Malformed;
+        
+        std::size_t space;
+        std::uint8_t* target = reader.writePointer(space);
+        qint64 bytes = socket->read(reinterpret_cast<char*>(target), static_cast<qint64>(space));
+        if (bytes <= 0) return ReadResult::Drained;
+        reader.commit(static_cast<std::size_t>(bytes));
+    }
+}
+
+} // namespace Protocol
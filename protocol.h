@@ -0,0 +1,69 @@
+#ifndef PROTOCOL_H
+#define PROTOCOL_H
+
+#include <QByteArray>
+#include <QString>
+#include <functional>
+#include "framing.h"
+#include "position.h"
+
+class QTcpSocket;
+
+// Message types for network protocol
+enum class MessageType : quint8 {
+    GameState = 1,      // Full game state sync
+    Move = 2,           // A move was made, with the sequence and hash after it
+    ChatMessage = 3,    // Chat message
+    PlayerReady = 4,    // Player is ready to start
+    GameStart = 5,      // Game is starting
+    GameReset = 6,      // Reset the game
+    Ping = 7,           // Keep-alive ping
+    Pong = 8,           // Keep-alive response
+    Disconnect = 9,     // Player disconnecting
+    StateDelta = 10,    // Host's state as changed squares plus hashes
+    StateRequest = 11,  // Client asks for a full GameState
+    SeatAssignment = 12, // Lobby server tells a client which colour it plays
+    Spectate = 13       // Sent instead of PlayerReady to watch a hosted game
+};
+
+// Payloads and framed socket I/O shared by the client's NetworkManager, the
+// lobby server and its load bots. The read functions return false for a
+// payload that is too short or out of range.
+namespace Protocol {
+
+constexpr quint16 DEFAULT_PORT = 45678;
+
+QByteArray movePayload(const Move& move, quint32 sequence, quint64 hash);
+bool readMove(const QByteArray& payload, Move& move, quint32& sequence, quint64& hash);
+
+QByteArray gameStatePayload(quint32 sequence, const QByteArray& state);
+bool readGameState(const QByteArray& payload, QByteArray& state, quint32& sequence);
+
+// PlayerReady and Spectate carry the sender's name as a small JSON object
+QByteArray playerReadyPayload(const QString& name);
+QString readPlayerName(const QByteArray& payload);
+
+QByteArray seatPayload(PlayerColor color);
+bool readSeat(const QByteArray& payload, PlayerColor& color);
+
+// Builds the frame once in writer and queues it on socket. False, sending
+// nothing, if the payload is over the writer's maximum frame size.
+bool writeFrame(QTcpSocket* socket, Framing::FrameWriter& writer, MessageType type,
+                const QByteArray& payload = QByteArray());
+
+enum class ReadResult {
+    Drained,    // everything the socket had was read
+    Stopped,    // the handler returned false
+    Malformed   // the peer broke the framing; drop the connection
+};
+
+// Reads everything available on socket into reader and hands each complete
+// frame to handler. The payload borrows the reader's bytes, so a handler
+// that keeps it must copy it. Returning false stops reading, e.g. when the
+// handler closed the connection.
+using FrameHandler = std::function<bool(MessageType type, const QByteArray& payload)>;
+ReadResult readFrames(QTcpSocket* socket, Framing::FrameReader& reader, const FrameHandler& handler);
+
+} // namespace Protocol
+
+#endif // PROTOCOL_H
@@ -0,0 +1,432 @@
+#include "search.h"
+#include "eval.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <utility>
+
+namespace {
+
+constexpr int INFINITE_SCORE = Searcher::MATE_SCORE + 1;
+
+// How often (in nodes) the clock and the stop flag are polled
+constexpr std::uint64_t STOP_CHECK_MASK = 2047;
+
+// Move ordering priorities
+constexpr int PV_MOVE_SCORE = 1 << 30;
+constexpr int HASH_MOVE_SCORE = PV_MOVE_SCORE - 1;
+constexpr int CAPTURE_SCORE = 1 << 24;
+constexpr int KILLER_SCORE = 1 << 20;
+constexpr int HISTORY_LIMIT = KILLER_SCORE - 1;
+
+bool sameMove(const Move& a, const Move& b)
+{
+    return a.from == b.from && a.to == b.to && a.captures == b.captures;
+}
+
+// The table keeps mate scores as distance from the stored node, so the
+// same entry is valid wherever the position turns up in the tree
+int scoreToTable(int score, int ply)
+{
+    if (score > Searcher::MATE_BOUND) return score + ply;
+    if (score < -Searcher::MATE_BOUND) return score - ply;
+    return score;
+}
+
+int scoreFromTable(int score, int ply)
+{
+    if (score > Searcher::MATE_BOUND) return score - ply;
+    if (score < -Searcher::MATE_BOUND) return score + ply;
+    return score;
+}
+
+} // namespace
+
+Searcher::Searcher()
+{
+    std::memset(m_pvLength, 0, sizeof(m_pvLength));
+    std::memset(m_history, 0, sizeof(m_history));
+}
+
+SearchInfo Searcher::search(const Position& root, const SearchLimits& limits,
+                            const IterationCallback& onIteration)
+{
+    const auto startTime = std::chrono::steady_clock::now();
+    auto elapsedMs = [&startTime]() {
+        return static_cast<std::int64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - startTime).count());
+    };
+    
+    m_position = root;
+    Eval::refresh(m_position, m_accumulators[0]);
+    m_stop.store(false, std::memory_order_relaxed);
+    m_aborted = false;
+    m_nodes = 0;
+    m_tablebaseHits = 0;
+    m_publishedNodes.store(0, std::memory_order_relaxed);
+    m_hasDeadline = limits.moveTimeMs > 0;
+    m_deadline = startTime + std::chrono::milliseconds(limits.moveTimeMs);
+    m_nodeLimit = limits.maxNodes;
+    m_previousPv.clear();
+    std::memset(m_history, 0, sizeof(m_history));
+    for (auto& killers : m_killers) {
+        killers[0] = killers[1] = Move::invalid();
+    }
+    
+    SearchInfo result;
+    MoveList rootMoves;
+    m_position.generateMoves(rootMoves);
+    if (rootMoves.isEmpty()) {
+        result.score = -MATE_SCORE;
+        return result;
+    }
+    
+    // Something to play even if the first iteration is interrupted
+    result.bestMove = rootMoves[0];
+    
+    const int maxDepth = std::min(limits.maxDepth, MAX_PLY - 1);
+    for (int depth = std::max(limits.minDepth, 1); depth <= maxDepth; ++depth) {
+        int score = negamax(depth, 0, -INFINITE_SCORE, INFINITE_SCORE);
+        if (m_aborted) break;
+        
+        m_previousPv.assign(m_pv[0], m_pv[0] + m_pvLength[0]);
+        extendPvFromTable(root, m_previousPv);
+        result.depth = depth;
+        result.score = score;
+        result.bestMove = m_previousPv.front();
+        result.pv = m_previousPv;
+        result.nodes = m_nodes;
+        result.tablebaseHits = m_tablebaseHits;
+        result.timeMs = elapsedMs();
+        
+        if (onIteration) {
+            onIteration(result);
+        }
+        
+        // A forced reply needs no thought, and a proven result won't change
+        if (rootMoves.size() == 1 || std::abs(score) > MATE_BOUND) break;
+        
+        // The next iteration takes several times as long as this one, so
+        // don't start it once half the time is gone
+        if (m_hasDeadline && result.timeMs * 2 > limits.moveTimeMs) break;
+    }
+    
+    result.nodes = m_nodes;
+    result.tablebaseHits = m_tablebaseHits;
+    result.timeMs = elapsedMs();
+    m_publishedNodes.store(m_nodes, std::memory_order_relaxed);
+    return result;
+}
+
+int Searcher::negamax(int depth, int ply, int alpha, int beta)
+{
+    if (depth <= 0) {
+        return quiescence(ply, alpha, beta);
+    }
+    
+    m_pvLength[ply] = ply;
+    ++m_nodes;
+    if (shouldStop()) return 0;
+    
+    m_hashes[ply] = m_position.hash();
+    if (ply > 0 && isRepetition(ply)) return 0;
+    if (ply >= MAX_PLY - 1) return Eval::evaluate(m_position, m_accumulators[ply]);
+    
+    int tablebaseScore;
+    if (ply > 0 && probeTablebase(ply, tablebaseScore)) return tablebaseScore;
+    
+    Move hashMove = Move::invalid();
+    if (m_table) {
+        TranspositionTable::Entry entry;
+        if (m_table->probe(m_position.hash(), entry)) {
+            hashMove = entry.move;
+            int score = scoreFromTable(entry.score, ply);
+            
+            // The root always searches, so there is a move to return
+            if (ply > 0 && entry.depth >= depth
+                && (entry.bound == TranspositionTable::ExactBound
+                    || (entry.bound == TranspositionTable::LowerBound && score >= beta)
+                    || (entry.bound == TranspositionTable::UpperBound && score <= alpha))) {
+                return score;
+            }
+        }
+    }
+    
+    MoveList moves;
+    m_position.generateMoves(moves);
+    
+    // No moves left loses; prefer the slowest loss and the fastest win
+    if (moves.isEmpty()) return -MATE_SCORE + ply;
+    
+    const int originalAlpha = alpha;
+    Move bestMove = Move::invalid();
+    int best = searchMoves(moves, depth, ply, alpha, beta, hashMove, bestMove);
+    
+    if (m_table && !m_aborted) {
+        TranspositionTable::Bound bound = best <= originalAlpha ? TranspositionTable::UpperBound
+                                        : best >= beta ? TranspositionTable::LowerBound
+                                        : TranspositionTable::ExactBound;
+        m_table->store(m_position.hash(), bestMove, scoreToTable(best, ply), depth, bound);
+    }
+    
+    return best;
+}
+
+int Searcher::quiescence(int ply, int alpha, int beta)
+{
+    m_pvLength[ply] = ply;
+    ++m_nodes;
+    if (shouldStop()) return 0;
+    
+    m_hashes[ply] = m_position.hash();
+    if (ply >= MAX_PLY - 1) return Eval::evaluate(m_position, m_accumulators[ply]);
+    
+    int tablebaseScore;
+    if (probeTablebase(ply, tablebaseScore)) return tablebaseScore;
+    
+    MoveList moves;
+    m_position.generateMoves(moves);
+    if (moves.isEmpty()) return -MATE_SCORE + ply;
+    
+    // Nothing to take, so the position is quiet enough to evaluate
+    if (!moves[0].isCapture()) return Eval::evaluate(m_position, m_accumulators[ply]);
+    
+    // Captures are compulsory, so there is no standing pat
+    Move bestMove;
+    return searchMoves(moves, 0, ply, alpha, beta, Move::invalid(), bestMove);
+}
+
+// Tablebase results are exact, so wins and losses score like any other
+// forced result at their distance from the root
+bool Searcher::probeTablebase(int ply, int& score)
+{
+    if (!m_tablebase) return false;
+    if (Bitboard::popCount(m_position.board().occupied()) > m_tablebase->maxPieces()) return false;
+    
+    Tablebase::Entry entry;
+    if (!m_tablebase->probe(m_position, entry)) return false;
+    
+    ++m_tablebaseHits;
+    switch (entry.result) {
+        case Tablebase::Result::Win:
+            score = MATE_SCORE - ply - entry.plies;
+            break;
+        case Tablebase::Result::Loss:
+            score = -MATE_SCORE + ply + entry.plies;
+            break;
+        default:
+            score = 0;
+            break;
+    }
+    return true;
+}
+
+int Searcher::searchMoves(MoveList& moves, int depth, int ply, int alpha, int beta,
+                          const Move& hashMove, Move& bestMove)
+{
+    int scores[MoveList::CAPACITY];
+    scoreMoves(moves, ply, hashMove, scores);
+    bestMove = moves[0];
+    
+    int best = -INFINITE_SCORE;
+    UndoRecord undo;
+    
+    for (int i = 0; i < moves.size(); ++i) {
+        // Bring the most promising remaining move forward
+        int pick = i;
+        for (int j = i + 1; j < moves.size(); ++j) {
+            if (scores[j] > scores[pick]) pick = j;
+        }
+        std::swap(moves[i], moves[pick]);
+        std::swap(scores[i], scores[pick]);
+        
+        const Move move = moves[i];
+        m_position.doMove(move, undo);
+        Eval::update(m_position, undo, m_accumulators[ply], m_accumulators[ply + 1]);
+        int score = -negamax(depth - 1, ply + 1, -beta, -alpha);
+        m_position.undoMove(undo);
+        
+        if (m_aborted) return 0;
+        
+        if (score <= best) continue;
+        best = score;
+        bestMove = move;
+        if (score <= alpha) continue;
+        
+        alpha = score;
+        updatePv(ply, move);
+        
+        if (score >= beta) {
+            if (!move.isCapture()) {
+                if (!sameMove(m_killers[ply][0], move)) {
+                    m_killers[ply][1] = m_killers[ply][0];
+                    m_killers[ply][0] = move;
+                }
+                int& history = m_history[move.from][move.to];
+                history = std::min(history + depth * depth, HISTORY_LIMIT);
+            }
+            break;
+        }
+    }
+    
+    return best;
+}
+
+void Searcher::scoreMoves(const MoveList& moves, int ply, const Move& hashMove, int* scores) const
+{
+    const Bitboard::Mask kings = m_position.board().kings;
+    const bool hasPvMove = ply < static_cast<int>(m_previousPv.size());
+    
+    for (int i = 0; i < moves.size(); ++i) {
+        const Move& move = moves[i];
+        if (hasPvMove && sameMove(move, m_previousPv[static_cast<size_t>(ply)])) {
+            scores[i] = PV_MOVE_SCORE;
+        } else if (move == hashMove) {
+            // The table keeps only the squares, which is enough for ordering
+            scores[i] = HASH_MOVE_SCORE;
+        } else if (move.isCapture()) {
+            // Longer jumps and jumps that take kings first
+            scores[i] = CAPTURE_SCORE + Bitboard::popCount(move.captures) * 16
+                      + Bitboard::popCount(move.captures & kings) * 8;
+        } else if (sameMove(move, m_killers[ply][0])) {
+            scores[i] = KILLER_SCORE + 1;
+        } else if (sameMove(move, m_killers[ply][1])) {
+            scores[i] = KILLER_SCORE;
+        } else {
+            scores[i] = m_history[move.from][move.to];
+        }
+    }
+}
+
+void Searcher::updatePv(int ply, const Move& move)
+{
+    m_pv[ply][ply] = move;
+    for (int i = ply + 1; i < m_pvLength[ply + 1]; ++i) {
+        m_pv[ply][i] = m_pv[ply + 1][i];
+    }
+    m_pvLength[ply] = std::max(m_pvLength[ply + 1], ply + 1);
+}
+
+// Table cutoffs cut the triangular PV short; follow the stored moves from
+// where it ends
+void Searcher::extendPvFromTable(const Position& root, std::vector<Move>& pv) const
+{
+    if (!m_table) return;
+    
+    Position position = root;
+    UndoRecord undo;
+    std::vector<std::uint64_t> seen(1, position.hash());
+    for (const Move& move : pv) {
+        position.doMove(move, undo);
+        seen.push_back(position.hash());
+    }
+    
+    TranspositionTable::Entry entry;
+    while (pv.size() < static_cast<size_t>(MAX_PLY) && m_table->probe(position.hash(), entry)) {
+        MoveList moves;
+        position.generateMoves(moves);
+        const Move* legal = std::find(moves.begin(), moves.end(), entry.move);
+        if (legal == moves.end()) break;
+        
+        position.doMove(*legal, undo);
+        
+        // Stop at a repetition rather than going round in circles
+        if (std::find(seen.begin(), seen.end(), position.hash()) != seen.end()) break;
+        seen.push_back(position.hash());
+        pv.push_back(*legal);
+    }
+}
+
+bool Searcher::isRepetition(int ply) const
+{
+    // Only positions with the same side to move can repeat
+    for (int i = ply - 2; i >= 0; i -= 2) {
+        if (m_hashes[i] == m_hashes[ply]) return true;
+    }
+    return false;
+}
+
+bool Searcher::shouldStop()
+{
+    if (m_aborted) return true;
+    if ((m_nodes & STOP_CHECK_MASK) != 0) return false;
+    
+    m_publishedNodes.store(m_nodes, std::memory_order_relaxed);
+    if (m_stop.load(std::memory_order_relaxed)
+        || (m_sharedStop && m_sharedStop->load(std::memory_order_relaxed))
+        || (m_nodeLimit && m_nodes >= m_nodeLimit)
+        || (m_hasDeadline && std::chrono::steady_clock::now() >= m_deadline)) {
+        m_aborted = true;
+    }
+    return m_aborted;
+}
+
+ParallelSearch::ParallelSearch(int threadCount, std::size_t hashMegabytes)
+    : m_table(hashMegabytes)
+{
+    setThreadCount(threadCount);
+}
+
+void ParallelSearch::setThreadCount(int threadCount)
+{
+    m_searchers.resize(static_cast<size_t>(std::max(threadCount, 1)));
+    for (std::unique_ptr<Searcher>& searcher : m_searchers) {
+        if (!searcher) {
+            searcher.reset(new Searcher);
+            searcher->setTranspositionTable(&m_table);
+            searcher->setSharedStop(&m_stop);
+            searcher->setTablebase(m_tablebase);
+        }
+    }
+}
+
+void ParallelSearch::setTablebase(const Tablebase* tablebase)
+{
+    m_tablebase = tablebase;
+    for (std::unique_ptr<Searcher>& searcher : m_searchers) {
+        searcher->setTablebase(tablebase);
+    }
+}
+
+SearchInfo ParallelSearch::search(const Position& root, const SearchLimits& limits,
+                                  const Searcher::IterationCallback& onIteration)
+{
+    m_stop.store(false, std::memory_order_relaxed);
+    m_table.newSearch();
+    
+    // Helpers search without limits until the main thread is done
+    std::vector<std::thread> helpers;
+    for (size_t i = 1; i < m_searchers.size(); ++i) {
+        SearchLimits helperLimits;
+        helperLimits.maxDepth = Searcher::MAX_PLY;
+        helperLimits.minDepth = 1 + static_cast<int>(i % 2);
+        helpers.emplace_back([this, i, &root, helperLimits]() {
+            m_searchers[i]->search(root, helperLimits);
+        });
+    }
+    
+    SearchInfo result = m_searchers[0]->search(root, limits, [this, &onIteration](const SearchInfo& info) {
+        if (!onIteration) return;
+        SearchInfo total = info;
+        total.nodes = totalNodes() - m_searchers[0]->nodes() + info.nodes;
+        onIteration(total);
+    });
+    
+    m_stop.store(true, std::memory_order_relaxed);
+    for (std::thread& helper : helpers) {
+        helper.join();
+    }
+    
+    result.nodes = totalNodes();
+    return result;
+}
+
+std::uint64_t ParallelSearch::totalNodes() const
+{
+    std::uint64_t nodes = 0;
+    for (const std::unique_ptr<Searcher>& searcher : m_searchers) {
+        nodes += searcher->nodes();
+    }
+    return nodes;
+}
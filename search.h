@@ -0,0 +1,141 @@
+#ifndef SEARCH_H
+#define SEARCH_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+#include "eval.h"
+#include "position.h"
+#include "tablebase.h"
+#include "tt.h"
+
+struct SearchLimits {
+    int maxDepth = 64;
+    int minDepth = 1; // Depth of the first iteration
+    int moveTimeMs = 0; // 0 searches until maxDepth or stop()
+    std::uint64_t maxNodes = 0; // 0 for no limit; checked every few thousand nodes
+};
+
+// Result of one completed iteration, and of the search as a whole
+struct SearchInfo {
+    int depth = 0;
+    int score = 0; // Hundredths of a man, from the side to move's view
+    Move bestMove = Move::invalid();
+    std::vector<Move> pv;
+    std::uint64_t nodes = 0;
+    std::uint64_t tablebaseHits = 0;
+    std::int64_t timeMs = 0;
+    bool fromBook = false; // Played from the opening book without searching
+    
+    std::uint64_t nodesPerSecond() const
+    {
+        return timeMs > 0 ? nodes * 1000 / static_cast<std::uint64_t>(timeMs) : nodes * 1000;
+    }
+};
+
+// Negamax alpha-beta with iterative deepening. Forced captures are always
+// searched to quiescence, and moves are ordered by the previous iteration's
+// principal variation, capture size, killer moves and history.
+//
+// A Searcher is used by one thread at a time; only stop() and nodes() may
+// be called from another thread.
+class Searcher
+{
+public:
+    static constexpr int MAX_PLY = 128;
+    static constexpr int MATE_SCORE = 30000;
+    static constexpr int MATE_BOUND = MATE_SCORE - MAX_PLY; // Scores above this are wins
+    
+    using IterationCallback = std::function<void(const SearchInfo& info)>;
+    
+    Searcher();
+    
+    // Searches until the limits are reached or stop() is called, reporting
+    // each completed depth to onIteration. The best move is invalid only if
+    // the root has no legal moves.
+    SearchInfo search(const Position& root, const SearchLimits& limits,
+                      const IterationCallback& onIteration = IterationCallback());
+    void stop() { m_stop.store(true, std::memory_order_relaxed); }
+    
+    // Optional; the table may be shared with other searchers
+    void setTranspositionTable(TranspositionTable* table) { m_table = table; }
+    
+    // Optional; positions it covers are scored from it instead of searched
+    void setTablebase(const Tablebase* tablebase) { m_tablebase = tablebase; }
+    
+    // Optional extra stop flag, e.g. one shared by a group of searchers.
+    // Unlike stop(), it is not cleared when a search starts.
+    void setSharedStop(const std::atomic<bool>* stop) { m_sharedStop = stop; }
+    
+    // Nodes searched so far, updated every few thousand nodes
+    std::uint64_t nodes() const { return m_publishedNodes.load(std::memory_order_relaxed); }
+    
+private:
+    int negamax(int depth, int ply, int alpha, int beta);
+    int quiescence(int ply, int alpha, int beta);
+    bool probeTablebase(int ply, int& score);
+    int searchMoves(MoveList& moves, int depth, int ply, int alpha, int beta,
+                    const Move& hashMove, Move& bestMove);
+    void scoreMoves(const MoveList& moves, int ply, const Move& hashMove, int* scores) const;
+    void updatePv(int ply, const Move& move);
+    void extendPvFromTable(const Position& root, std::vector<Move>& pv) const;
+    bool isRepetition(int ply) const;
+    bool shouldStop();
+    
+    Position m_position;
+    std::atomic<bool> m_stop{false};
+    const std::atomic<bool>* m_sharedStop = nullptr;
+    TranspositionTable* m_table = nullptr;
+    const Tablebase* m_tablebase = nullptr;
+    std::uint64_t m_tablebaseHits = 0;
+    bool m_aborted = false;
+    std::uint64_t m_nodes = 0;
+    std::atomic<std::uint64_t> m_publishedNodes{0};
+    std::chrono::steady_clock::time_point m_deadline;
+    bool m_hasDeadline = false;
+    std::uint64_t m_nodeLimit = 0;
+    
+    // Triangular principal variation table
+    Move m_pv[MAX_PLY][MAX_PLY];
+    int m_pvLength[MAX_PLY];
+    std::vector<Move> m_previousPv;
+    
+    Move m_killers[MAX_PLY][2];
+    int m_history[Bitboard::SQUARES][Bitboard::SQUARES];
+    std::uint64_t m_hashes[MAX_PLY]; // Positions on the current search path
+    Eval::Accumulator m_accumulators[MAX_PLY]; // Evaluation features along the path
+};
+
+// Lazy SMP: every thread runs its own Searcher on the same root and they
+// cooperate only through the shared transposition table. Half the helper
+// threads start one ply deeper so they don't all walk the tree in step.
+// The first thread's result is the one returned.
+class ParallelSearch
+{
+public:
+    explicit ParallelSearch(int threadCount = 1, std::size_t hashMegabytes = 64);
+    
+    int threadCount() const { return static_cast<int>(m_searchers.size()); }
+    void setThreadCount(int threadCount);
+    void resizeHash(std::size_t megabytes) { m_table.resize(megabytes); }
+    void clearHash() { m_table.clear(); }
+    void setTablebase(const Tablebase* tablebase);
+    
+    // Node counts in the reported infos cover all threads
+    SearchInfo search(const Position& root, const SearchLimits& limits,
+                      const Searcher::IterationCallback& onIteration = Searcher::IterationCallback());
+    void stop() { m_stop.store(true, std::memory_order_relaxed); }
+    
+private:
+    std::uint64_t totalNodes() const;
+    
+    TranspositionTable m_table;
+    const Tablebase* m_tablebase = nullptr;
+    std::vector<std::unique_ptr<Searcher>> m_searchers;
+    std::atomic<bool> m_stop{false};
+};
+
+#endif // SEARCH_H
@@ -0,0 +1,95 @@
+#include "lobbyserver.h"
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QThread>
+#include <QTimer>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// Headless lobby server.
+//
+//   checkers-server [options]
+//
+// Accepts any number of clients, pairs them into games as they send
+// PlayerReady and referees every game on a pool of I/O threads (see
+// LobbyServer). Clients join it the way they join a hosted game. Prints a
+// status line every few seconds:
+//
+//   <seconds>s <connections> connections, <n> waiting, <n> games, <n> finished,
+//   <moves> moves (<moves per second>/s), <n> resyncs
+//
+// Options:
+//   --port <n>         Port to listen on (default: 45678)
+//   --threads <n>      I/O threads (default: all cores)
+//   --stats <s>        Seconds between status lines, 0 for none (default: 5)
+
+namespace {
+
+void printUsage()
+{
+    std::fprintf(stderr, "Usage: checkers-server [--port <n>] [--threads <n>] [--stats <seconds>]\n");
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+    
+    quint16 port = Protocol::DEFAULT_PORT;
+    int threadCount = QThread::idealThreadCount();
+    int statsSeconds = 5;
+    
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--port") == 0 && i + 1 < argc) {
+            port = static_cast<quint16>(std::atoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            threadCount = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--stats") == 0 && i + 1 < argc) {
+            statsSeconds = std::max(std::atoi(argv[++i]), 0);
+        } else {
+            printUsage();
+            return 1;
+        }
+    }
+    threadCount = std::max(threadCount, 1);
+    
+    LobbyServer server(threadCount);
+    if (!server.listen(QHostAddress::Any, port)) {
+        std::fprintf(stderr, "Can't listen on port %u: %s\n", static_cast<unsigned>(port),
+                     server.errorString().toLocal8Bit().constData());
+        return 1;
+    }
+    std::printf("Listening on port %u with %d I/O threads\n", static_cast<unsigned>(server.serverPort()),
+                server.ioThreadCount());
+    std::fflush(stdout);
+    
+    QElapsedTimer clock;
+    clock.start();
+    qint64 lastElapsed = 0;
+    quint64 lastMoves = 0;
+    
+    QTimer statsTimer;
+    QObject::connect(&statsTimer, &QTimer::timeout, &server, [&]() {
+        const ServerStats& stats = server.stats();
+        qint64 elapsed = clock.elapsed();
+        quint64 moves = stats.moves;
+        double rate = (moves - lastMoves) * 1000.0 / std::max<qint64>(elapsed - lastElapsed, 1);
+        lastElapsed = elapsed;
+        lastMoves = moves;
+        
+        std::printf("%6llds %d connections, %d waiting, %d games, %llu finished, %llu moves (%.0f/s), %llu resyncs\n",
+                    static_cast<long long>(elapsed / 1000), stats.connections.load(),
+                    server.waitingPlayers(), stats.activeMatches.load(),
+                    static_cast<unsigned long long>(stats.gamesFinished), static_cast<unsigned long long>(moves),
+                    rate, static_cast<unsigned long long>(stats.resyncs));
+        std::fflush(stdout);
+    });
+    if (statsSeconds > 0) {
+        statsTimer.start(statsSeconds * 1000);
+    }
+    
+    return app.exec();
+}
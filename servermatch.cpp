@@ -0,0 +1,174 @@
+#include "servermatch.h"
+#include <QTcpSocket>
+#include <utility>
+
+namespace {
+
+PlayerColor seatColor(int seat)
+{
+    return seat == 0 ? PlayerColor::Red : PlayerColor::Black;
+}
+
+} // namespace
+
+ServerMatch::ServerMatch(Seat red, Seat black, ServerStats* stats)
+    : m_game(new CheckersGame(this))
+    , m_stats(stats)
+{
+    m_seats[0] = std::move(red);
+    m_seats[1] = std::move(black);
+    for (Seat& seat : m_seats) {
+        seat.socket->setParent(this);
+    }
+}
+
+void ServerMatch::start()
+{
+    ++m_stats->matchesStarted;
+    ++m_stats->activeMatches;
+    
+    for (int seat = 0; seat < 2; ++seat) {
+        QTcpSocket* socket = m_seats[seat].socket;
+        connect(socket, &QTcpSocket::readyRead, this, [this, seat]() { onReadyRead(seat); });
+        connect(socket, &QTcpSocket::disconnected, this, &ServerMatch::finish);
+        
+        // Either player may have left on the way here from the lobby
+        if (socket->state() != QAbstractSocket::ConnectedState) {
+            finish();
+            return;
+        }
+    }
+    
+    // Clients start a new game when their opponent's PlayerReady arrives,
+    // in the colour assigned just before it; then, as from a host, an empty
+    // delta confirms the start position
+    m_game->resetGame();
+    QByteArray delta = m_game->stateDelta(m_game->position());
+    for (int seat = 0; seat < 2; ++seat) {
+        send(seat, MessageType::SeatAssignment, Protocol::seatPayload(seatColor(seat)));
+        send(seat, MessageType::PlayerReady, Protocol::playerReadyPayload(m_seats[1 - seat].name));
+        send(seat, MessageType::StateDelta, delta);
+        send(seat, MessageType::GameStart);
+    }
+    
+    // Anything the clients sent while they waited in the lobby
+    for (int seat = 0; seat < 2 && !m_finished; ++seat) {
+        onReadyRead(seat);
+    }
+}
+
+void ServerMatch::onReadyRead(int seat)
+{
+    if (m_finished) return;
+    
+    Seat& player = m_seats[seat];
+    Protocol::ReadResult result = Protocol::readFrames(player.socket, player.reader,
+        [this, seat](MessageType type, const QByteArray& payload) {
+            return handleMessage(seat, type, payload);
+        });
+        
+    if (result == Protocol::ReadResult::Malformed) {
+        finish();
+    }
+}
+
+bool ServerMatch::handleMessage(int seat, MessageType type, const QByteArray& payload)
+{
+    int opponent = 1 - seat;
+    
+    switch (type) {
+        case MessageType::Move:
+            handleMove(seat, payload);
+            break;
+            
+        case MessageType::StateRequest:
+            sendState(seat);
+            break;
+            
+        case MessageType::GameReset: {
+            // Both clients reset themselves, so the delta only confirms it
+            Position before = m_game->position();
+            m_game->resetGame();
+            send(opponent, MessageType::GameReset);
+            
+            QByteArray delta = m_game->stateDelta(before);
+            send(seat, MessageType::StateDelta, delta);
+            send(opponent, MessageType::StateDelta, delta);
+            break;
+        }
+        
+        case MessageType::ChatMessage:
+            send(opponent, MessageType::ChatMessage, payload);
+            break;
+            
+        case MessageType::Ping:
+            send(seat, MessageType::Pong);
+            break;
+            
+        case MessageType::Disconnect:
+            finish();
+            break;
+            
+        default:
+            // The server's state is authoritative and it starts games
+            // itself, so clients' GameState, StateDelta, PlayerReady and
+            // GameStart messages are ignored
+            break;
+    }
+    return !m_finished;
+}
+
+void ServerMatch::handleMove(int seat, const QByteArray& payload)
+{
+    Move move;
+    quint32 sequence;
+    quint64 hash;
+    if (!Protocol::readMove(payload, move, sequence, hash)) return;
+    
+    // A move out of turn or illegal here means the mover's board is wrong
+    if (m_game->currentPlayer() != seatColor(seat) || !m_game->makeMove(move)) {
+        sendState(seat);
+        return;
+    }
+    
+    ++m_stats->moves;
+    if (m_game->isGameOver()) {
+        ++m_stats->gamesFinished;
+    }
+    send(1 - seat, MessageType::Move, Protocol::movePayload(move, m_game->stateSequence(), m_game->hash()));
+    
+    // Legal here, but the mover expected a different position or state
+    // number after it
+    if (m_game->hash() != hash || m_game->stateSequence() != sequence) {
+        sendState(seat);
+    }
+}
+
+void ServerMatch::sendState(int seat)
+{
+    ++m_stats->resyncs;
+    send(seat, MessageType::GameState, Protocol::gameStatePayload(m_game->stateSequence(), m_game->serialize()));
+}
+
+void ServerMatch::send(int seat, MessageType type, const QByteArray& payload)
+{
+    Protocol::writeFrame(m_seats[seat].socket, m_writer, type, payload);
+}
+
+void ServerMatch::finish()
+{
+    if (m_finished) return;
+    m_finished = true;
+    --m_stats->activeMatches;
+    m_stats->connections -= 2;
+    
+    // As from a host, the player still connected is told the other left
+    for (Seat& seat : m_seats) {
+        if (seat.socket->state() == QAbstractSocket::ConnectedState) {
+            Protocol::writeFrame(seat.socket, m_writer, MessageType::Disconnect);
+            seat.socket->flush();
+            seat.socket->disconnectFromHost();
+        }
+    }
+    emit finished();
+}
@@ -0,0 +1,64 @@
+#ifndef SERVERMATCH_H
+#define SERVERMATCH_H
+
+#include <QObject>
+#include <QString>
+#include <atomic>
+#include "checkersgame.h"
+#include "framing.h"
+#include "protocol.h"
+
+class QTcpSocket;
+
+// Counters shared by the lobby and every match, updated from the I/O threads
+struct ServerStats {
+    std::atomic<int> connections{0};        // Clients connected now
+    std::atomic<quint64> matchesStarted{0};
+    std::atomic<int> activeMatches{0};
+    std::atomic<quint64> gamesFinished{0};  // Games played to a result
+    std::atomic<quint64> moves{0};          // Moves checked and relayed
+    std::atomic<quint64> resyncs{0};        // Snapshots sent to a drifted client
+};
+
+// One game on the lobby server between two paired clients. The match and
+// both sockets live on one of the server's I/O threads, and the match keeps
+// the authoritative CheckersGame: a move is relayed only once it has been
+// played here, and a client whose board disagrees is sent the server's.
+// To each client the server looks like a host (see NetworkManager), except
+// that it also sends a SeatAssignment, since both clients joined.
+class ServerMatch : public QObject
+{
+    Q_OBJECT
+    
+public:
+    struct Seat {
+        QTcpSocket* socket = nullptr;
+        QString name;
+        Framing::FrameReader reader;  // Whatever arrived after PlayerReady
+    };
+    
+    // Takes the sockets as children; create it on the sockets' thread
+    ServerMatch(Seat red, Seat black, ServerStats* stats);
+    
+public slots:
+    void start();
+    
+signals:
+    void finished();
+    
+private:
+    void onReadyRead(int seat);
+    bool handleMessage(int seat, MessageType type, const QByteArray& payload);
+    void handleMove(int seat, const QByteArray& payload);
+    void sendState(int seat);
+    void send(int seat, MessageType type, const QByteArray& payload = QByteArray());
+    void finish();
+    
+    Seat m_seats[2];  // Red, then Black
+    CheckersGame* m_game;
+    Framing::FrameWriter m_writer;
+    ServerStats* m_stats;
+    bool m_finished = false;
+};
+
+#endif // SERVERMATCH_H
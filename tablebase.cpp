@@ -0,0 +1,279 @@
+#include "tablebase.h"
+#include <cstdio>
+#include <cstring>
+
+using Bitboard::Mask;
+
+namespace {
+
+const char FILE_MAGIC[4] = {'C', 'K', 'T', 'B'};
+constexpr std::uint8_t FILE_VERSION = 1;
+
+// Red men never stand on row 0 and Black men never on row 7, so men are
+// ranked among 28 squares and kings among all 32
+constexpr int MAN_SQUARES = 28;
+constexpr int RED_MAN_OFFSET = 4;
+
+struct Binomials {
+    std::uint64_t values[Bitboard::SQUARES + 1][Tablebase::MAX_PIECES + 1];
+};
+
+constexpr Binomials makeBinomials()
+{
+    Binomials b{};
+    for (int n = 0; n <= Bitboard::SQUARES; ++n) {
+        b.values[n][0] = 1;
+        for (int k = 1; k <= Tablebase::MAX_PIECES; ++k) {
+            b.values[n][k] = n == 0 ? 0 : b.values[n - 1][k - 1] + b.values[n - 1][k];
+        }
+    }
+    return b;
+}
+
+constexpr Binomials BINOMIALS = makeBinomials();
+
+std::uint64_t binomial(int n, int k)
+{
+    return BINOMIALS.values[n][k];
+}
+
+// Combinatorial number system rank of a set of squares
+std::uint64_t rankSquares(Mask squares, int offset)
+{
+    std::uint64_t rank = 0;
+    for (int i = 1; squares; ++i) {
+        rank += binomial(Bitboard::popLowestSquare(squares) - offset, i);
+    }
+    return rank;
+}
+
+Mask unrankSquares(std::uint64_t rank, int count, int offset, int range)
+{
+    Mask squares = 0;
+    int square = range - 1;
+    for (int i = count; i >= 1; --i) {
+        while (binomial(square, i) > rank) {
+            --square;
+        }
+        rank -= binomial(square, i);
+        squares |= Bitboard::bit(square + offset);
+        --square;
+    }
+    return squares;
+}
+
+Mask reverseBits(Mask m)
+{
+    m = ((m >> 1) & 0x55555555u) | ((m & 0x55555555u) << 1);
+    m = ((m >> 2) & 0x33333333u) | ((m & 0x33333333u) << 2);
+    m = ((m >> 4) & 0x0F0F0F0Fu) | ((m & 0x0F0F0F0Fu) << 4);
+    m = ((m >> 8) & 0x00FF00FFu) | ((m & 0x00FF00FFu) << 8);
+    return (m >> 16) | (m << 16);
+}
+
+} // namespace
+
+Tablebase::Material Tablebase::materialOf(const Bitboard::Board& board)
+{
+    Material material;
+    material.redMen = Bitboard::popCount(board.red & ~board.kings);
+    material.redKings = Bitboard::popCount(board.red & board.kings);
+    material.blackMen = Bitboard::popCount(board.black & ~board.kings);
+    material.blackKings = Bitboard::popCount(board.black & board.kings);
+    return material;
+}
+
+std::uint64_t Tablebase::sliceSize(const Material& material)
+{
+    return binomial(MAN_SQUARES, material.redMen) * binomial(Bitboard::SQUARES, material.redKings)
+         * binomial(MAN_SQUARES, material.blackMen) * binomial(Bitboard::SQUARES, material.blackKings);
+}
+
+std::uint64_t Tablebase::indexOf(const Bitboard::Board& board, const Material& material)
+{
+    std::uint64_t index = rankSquares(board.red & ~board.kings, RED_MAN_OFFSET);
+    index = index * binomial(Bitboard::SQUARES, material.redKings) + rankSquares(board.red & board.kings, 0);
+    index = index * binomial(MAN_SQUARES, material.blackMen) + rankSquares(board.black & ~board.kings, 0);
+    index = index * binomial(Bitboard::SQUARES, material.blackKings) + rankSquares(board.black & board.kings, 0);
+    return index;
+}
+
+bool Tablebase::boardAt(const Material& material, std::uint64_t index, Bitboard::Board& board)
+{
+    std::uint64_t blackKingCount = binomial(Bitboard::SQUARES, material.blackKings);
+    std::uint64_t blackManCount = binomial(MAN_SQUARES, material.blackMen);
+    std::uint64_t redKingCount = binomial(Bitboard::SQUARES, material.redKings);
+    
+    Mask blackKings = unrankSquares(index % blackKingCount, material.blackKings, 0, Bitboard::SQUARES);
+    index /= blackKingCount;
+    Mask blackMen = unrankSquares(index % blackManCount, material.blackMen, 0, MAN_SQUARES);
+    index /= blackManCount;
+    Mask redKings = unrankSquares(index % redKingCount, material.redKings, 0, Bitboard::SQUARES);
+    index /= redKingCount;
+    Mask redMen = unrankSquares(index, material.redMen, RED_MAN_OFFSET, MAN_SQUARES);
+    
+    board.red = redMen | redKings;
+    board.black = blackMen | blackKings;
+    board.kings = redKings | blackKings;
+    
+    // Each group was placed independently, so some indices are impossible
+    return Bitboard::popCount(board.red) + Bitboard::popCount(board.black) == material.pieces()
+        && (board.red & board.black) == 0;
+}
+
+Bitboard::Board Tablebase::flipped(const Bitboard::Board& board)
+{
+    // Turning the board round maps square s to 31 - s
+    Bitboard::Board result;
+    result.red = reverseBits(board.black);
+    result.black = reverseBits(board.red);
+    result.kings = reverseBits(board.kings);
+    return result;
+}
+
+std::string Tablebase::fileName(const Material& material)
+{
+    char name[32];
+    std::snprintf(name, sizeof(name), "tb-%d%d%d%d.ctb",
+                  material.redMen, material.redKings, material.blackMen, material.blackKings);
+    return name;
+}
+
+std::uint8_t Tablebase::encode(Result result, int plies)
+{
+    if (result != Result::Win && result != Result::Loss) return 0;
+    return static_cast<std::uint8_t>(plies + 1);
+}
+
+Tablebase::Entry Tablebase::decode(std::uint8_t value)
+{
+    Entry entry;
+    if (value == 0 || value > MAX_PLIES + 1) {
+        entry.result = Result::Draw;
+        return entry;
+    }
+    entry.plies = value - 1;
+    entry.result = (entry.plies % 2) ? Result::Win : Result::Loss;
+    return entry;
+}
+
+int Tablebase::materialKey(const Material& material)
+{
+    return ((material.redMen * 9 + material.redKings) * 9 + material.blackMen) * 9 + material.blackKings;
+}
+
+int Tablebase::load(const std::string& directory)
+{
+    int loaded = 0;
+    
+    for (int pieces = 2; pieces <= MAX_PIECES; ++pieces) {
+        for (int rm = 0; rm <= pieces; ++rm) {
+            for (int rk = 0; rm + rk <= pieces; ++rk) {
+                for (int bm = 0; rm + rk + bm <= pieces; ++bm) {
+                    Material material{rm, rk, bm, pieces - rm - rk - bm};
+                    if (rm + rk == 0 || material.blackMen + material.blackKings == 0) continue;
+                    
+                    std::unique_ptr<MappedFile> file(new MappedFile);
+                    if (!file->open(directory + "/" + fileName(material))) continue;
+                    
+                    // Check the header and that the file holds the whole slice
+                    const std::uint8_t* data = file->data();
+                    if (file->size() != FILE_HEADER_SIZE + sliceSize(material)
+                        || std::memcmp(data, FILE_MAGIC, sizeof(FILE_MAGIC)) != 0
+                        || data[4] != FILE_VERSION
+                        || data[5] != rm || data[6] != rk || data[7] != bm || data[8] != material.blackKings) {
+                        std::fprintf(stderr, "Ignoring invalid tablebase file %s\n", fileName(material).c_str());
+                        continue;
+                    }
+                    
+                    setSlice(material, data + FILE_HEADER_SIZE);
+                    m_files.push_back(std::move(file));
+                    ++loaded;
+                }
+            }
+        }
+    }
+    
+    return loaded;
+}
+
+void Tablebase::setSlice(const Material& material, const std::uint8_t* values)
+{
+    m_slices[static_cast<size_t>(materialKey(material))] = values;
+    if (values && material.pieces() > m_maxPieces) {
+        m_maxPieces = material.pieces();
+    }
+}
+
+int Tablebase::sliceCount() const
+{
+    int count = 0;
+    for (const std::uint8_t* slice : m_slices) {
+        if (slice) ++count;
+    }
+    return count;
+}
+
+bool Tablebase::probe(const Position& position, Entry& entry) const
+{
+    const Bitboard::Board& board = position.board();
+    
+    if (position.pieces(position.sideToMove()) == 0) {
+        entry = {Result::Loss, 0};
+        return true;
+    }
+    if (Bitboard::popCount(board.occupied()) > m_maxPieces) return false;
+    
+    Bitboard::Board redToMove = position.sideToMove() == PlayerColor::Red ? board : flipped(board);
+    Material material = materialOf(redToMove);
+    if (material.blackMen + material.blackKings == 0) return false;
+    
+    const std::uint8_t* slice = m_slices[static_cast<size_t>(materialKey(material))];
+    if (!slice) return false;
+    
+    entry = decode(slice[indexOf(redToMove, material)]);
+    return true;
+}
+
+bool Tablebase::bestMove(const Position& position, Move& move, Entry& entry) const
+{
+    MoveList moves;
+    position.generateMoves(moves);
+    if (moves.isEmpty()) return false;
+    
+    // Rank from the mover's point of view: fastest win, then draw, then slowest loss
+    auto rank = [](const Entry& e) {
+        switch (e.result) {
+            case Result::Win: return 1000 - e.plies;
+            case Result::Draw: return 0;
+            default: return -1000 + e.plies;
+        }
+    };
+    
+    bool found = false;
+    for (const Move& candidate : moves) {
+        Position child = position;
+        UndoRecord undo;
+        child.doMove(candidate, undo);
+        
+        Entry reply;
+        if (!probe(child, reply)) return false;
+        
+        Entry result;
+        if (reply.result == Result::Loss) {
+            result = {Result::Win, reply.plies + 1};
+        } else if (reply.result == Result::Win) {
+            result = {Result::Loss, reply.plies + 1};
+        } else {
+            result = {Result::Draw, 0};
+        }
+        
+        if (!found || rank(result) > rank(entry)) {
+            move = candidate;
+            entry = result;
+            found = true;
+        }
+    }
+    
+    return found;
+}
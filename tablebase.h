@@ -0,0 +1,94 @@
+#ifndef TABLEBASE_H
+#define TABLEBASE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "mappedfile.h"
+#include "position.h"
+
+// Endgame databases: the exact result and distance to the end, in plies,
+// of every position with few enough pieces. checkers-tbgen builds them.
+//
+// Positions are split into slices by material. Only Red-to-move positions
+// are stored; a Black-to-move position is rotated 180 degrees with the
+// colours swapped first. Within a slice each group of pieces is ranked by
+// the combinatorial number system, so an index is a handful of table
+// lookups and a probe is O(1).
+//
+// Each slice is a file with a 16-byte header followed by one byte per
+// position (see encode()). Files are memory-mapped read-only.
+class Tablebase
+{
+public:
+    static constexpr int MAX_PIECES = 8;
+    static constexpr int FILE_HEADER_SIZE = 16;
+    
+    enum class Result {
+        Unknown,
+        Draw,
+        Win, // For the side to move
+        Loss
+    };
+    
+    struct Entry {
+        Result result = Result::Unknown;
+        int plies = 0; // Until the losing side has no move; 0 for draws
+    };
+    
+    struct Material {
+        int redMen = 0;
+        int redKings = 0;
+        int blackMen = 0;
+        int blackKings = 0;
+        
+        int pieces() const { return redMen + redKings + blackMen + blackKings; }
+        int men() const { return redMen + blackMen; }
+        Material swapped() const { return {blackMen, blackKings, redMen, redKings}; }
+        bool operator==(const Material& other) const
+        {
+            return redMen == other.redMen && redKings == other.redKings
+                && blackMen == other.blackMen && blackKings == other.blackKings;
+        }
+    };
+    
+    // Indexing, always with Red to move
+    static Material materialOf(const Bitboard::Board& board);
+    static std::uint64_t sliceSize(const Material& material);
+    static std::uint64_t indexOf(const Bitboard::Board& board, const Material& material);
+    static bool boardAt(const Material& material, std::uint64_t index, Bitboard::Board& board); // False if pieces overlap
+    static Bitboard::Board flipped(const Bitboard::Board& board);
+    static std::string fileName(const Material& material);
+    
+    // A stored byte: 0 is a draw, otherwise it is plies + 1. Wins always
+    // take an odd number of plies and losses an even number.
+    static std::uint8_t encode(Result result, int plies);
+    static Entry decode(std::uint8_t value);
+    static constexpr int MAX_PLIES = 253;
+    
+    // Maps every slice file found in directory; returns how many
+    int load(const std::string& directory);
+    
+    // For the generator: use values (not owned) for a slice
+    void setSlice(const Material& material, const std::uint8_t* values);
+    
+    int maxPieces() const { return m_maxPieces; }
+    int sliceCount() const;
+    
+    // Thread-safe. False if the material isn't covered.
+    bool probe(const Position& position, Entry& entry) const;
+    
+    // The move that wins fastest, loses slowest or holds the draw
+    bool bestMove(const Position& position, Move& move, Entry& entry) const;
+    
+private:
+    static int materialKey(const Material& material);
+    
+    std::vector<const std::uint8_t*> m_slices = std::vector<const std::uint8_t*>(9 * 9 * 9 * 9, nullptr);
+    std::vector<std::unique_ptr<MappedFile>> m_files;
+    int m_maxPieces = 0;
+};
+
+#endif // TABLEBASE_H
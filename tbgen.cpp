@@ -0,0 +1,348 @@
+#include "tablebase.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+// Endgame tablebase generator.
+//
+//   checkers-tbgen <directory> [--pieces <n>] [--threads <n>]
+//
+// Writes one file per material slice with up to n pieces (default 4) into
+// directory. Slices are built smallest first by retrograde analysis: pass 0
+// marks positions with no moves as lost, then pass d finds wins in d plies
+// (a move to a loss in d - 1) and losses in d plies (every move leads to a
+// win for the opponent in at most d - 1). Whatever is still open once the
+// passes stop finding anything is a draw. Each pass is split across threads.
+
+namespace {
+
+constexpr std::uint8_t UNKNOWN = 0xFF;
+constexpr std::uint64_t CHUNK_SIZE = 4096;
+
+using Material = Tablebase::Material;
+using Result = Tablebase::Result;
+
+struct Slice {
+    Material material;
+    std::uint64_t size = 0;
+    std::unique_ptr<std::atomic<std::uint8_t>[]> values;
+};
+
+void printUsage()
+{
+    std::fprintf(stderr, "Usage: checkers-tbgen <directory> [--pieces <n>] [--threads <n>]\n");
+}
+
+// Runs body(index) for every index in [0, count) on threadCount threads and
+// returns the sum of what it returned
+template <typename Body>
+std::uint64_t parallelFor(std::uint64_t count, int threadCount, const Body& body)
+{
+    std::atomic<std::uint64_t> next{0};
+    std::atomic<std::uint64_t> total{0};
+    
+    auto worker = [&]() {
+        std::uint64_t changed = 0;
+        for (std::uint64_t start = next.fetch_add(CHUNK_SIZE); start < count; start = next.fetch_add(CHUNK_SIZE)) {
+            std::uint64_t end = std::min(start + CHUNK_SIZE, count);
+            for (std::uint64_t index = start; index < end; ++index) {
+                changed += body(index);
+            }
+        }
+        total += changed;
+    };
+    
+    std::vector<std::thread> threads;
+    for (int i = 1; i < threadCount; ++i) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    return total.load();
+}
+
+class Generator
+{
+public:
+    Generator(const std::string& directory, int threadCount)
+        : m_directory(directory)
+        , m_threadCount(threadCount)
+    {
+    }
+    
+    bool generate(int maxPieces);
+    
+private:
+    bool generateGroup(std::vector<Slice>& group);
+    std::uint8_t successorValue(const std::vector<Slice>& group, const Position& child) const;
+    bool writeSlice(const Slice& slice, const std::vector<std::uint8_t>& values) const;
+    
+    std::string m_directory;
+    int m_threadCount;
+    Tablebase m_tablebase;
+    std::vector<std::unique_ptr<std::vector<std::uint8_t>>> m_finished;
+    int m_longestPlies = 0; // Over all finished slices
+};
+
+bool Generator::generate(int maxPieces)
+{
+    // A slice and its colour-swapped twin lead into each other, so they are
+    // solved together. Captures lead to fewer pieces and crowning to fewer
+    // men, so groups are built in that order.
+    std::vector<Material> groups;
+    for (int pieces = 2; pieces <= maxPieces; ++pieces) {
+        for (int rm = 0; rm <= pieces; ++rm) {
+            for (int rk = 0; rm + rk <= pieces; ++rk) {
+                for (int bm = 0; rm + rk + bm <= pieces; ++bm) {
+                    Material material{rm, rk, bm, pieces - rm - rk - bm};
+                    Material twin = material.swapped();
+                    if (rm + rk == 0 || twin.redMen + twin.redKings == 0) continue;
+                    
+                    // List each pair once
+                    if (rm > twin.redMen || (rm == twin.redMen && rk > twin.redKings)) continue;
+                    groups.push_back(material);
+                }
+            }
+        }
+    }
+    std::stable_sort(groups.begin(), groups.end(), [](const Material& a, const Material& b) {
+        if (a.pieces() != b.pieces()) return a.pieces() < b.pieces();
+        return a.men() < b.men();
+    });
+    
+    for (const Material& material : groups) {
+        std::vector<Slice> group(1);
+        group[0].material = material;
+        if (!(material.swapped() == material)) {
+            group.emplace_back();
+            group[1].material = material.swapped();
+        }
+        if (!generateGroup(group)) return false;
+    }
+    return true;
+}
+
+bool Generator::generateGroup(std::vector<Slice>& group)
+{
+    auto startTime = std::chrono::steady_clock::now();
+    
+    for (Slice& slice : group) {
+        slice.size = Tablebase::sliceSize(slice.material);
+        slice.values.reset(new std::atomic<std::uint8_t>[slice.size]);
+    }
+    
+    // Pass 0: positions with no moves are lost, impossible indices are left as draws
+    for (Slice& slice : group) {
+        parallelFor(slice.size, m_threadCount, [&slice](std::uint64_t index) -> std::uint64_t {
+            Bitboard::Board board;
+            std::uint8_t value = 0;
+            if (Tablebase::boardAt(slice.material, index, board)) {
+                Position position;
+                position.setBoard(board, PlayerColor::Red);
+                MoveList moves;
+                position.generateMoves(moves);
+                value = moves.isEmpty() ? Tablebase::encode(Result::Loss, 0) : UNKNOWN;
+            }
+            slice.values[index].store(value, std::memory_order_relaxed);
+            return 0;
+        });
+    }
+    
+    int quietPasses = 0;
+    int plies = 1;
+    for (; plies <= Tablebase::MAX_PLIES; ++plies) {
+        const bool winPass = (plies % 2) == 1;
+        const std::uint8_t target = Tablebase::encode(winPass ? Result::Loss : Result::Win, plies - 1);
+        std::uint64_t changed = 0;
+        
+        for (Slice& slice : group) {
+            changed += parallelFor(slice.size, m_threadCount, [&](std::uint64_t index) -> std::uint64_t {
+                if (slice.values[index].load(std::memory_order_relaxed) != UNKNOWN) return 0;
+                
+                Bitboard::Board board;
+                Tablebase::boardAt(slice.material, index, board);
+                Position position;
+                position.setBoard(board, PlayerColor::Red);
+                MoveList moves;
+                position.generateMoves(moves);
+                
+                bool anyTarget = false;
+                bool allWins = true;
+                UndoRecord undo;
+                for (const Move& move : moves) {
+                    position.doMove(move, undo);
+                    std::uint8_t value = successorValue(group, position);
+                    position.undoMove(undo);
+                    
+                    if (value == target) {
+                        anyTarget = true;
+                    }
+                    Tablebase::Entry reply = Tablebase::decode(value);
+                    if (reply.result != Result::Win || reply.plies > plies - 1) {
+                        allWins = false;
+                    }
+                }
+                
+                if (winPass && anyTarget) {
+                    slice.values[index].store(Tablebase::encode(Result::Win, plies), std::memory_order_relaxed);
+                    return 1;
+                }
+                if (!winPass && allWins) {
+                    slice.values[index].store(Tablebase::encode(Result::Loss, plies), std::memory_order_relaxed);
+                    return 1;
+                }
+                return 0;
+            });
+        }
+        
+        // Nothing can change once two passes in a row find nothing and no
+        // smaller slice has a longer result left to feed in
+        quietPasses = changed ? 0 : quietPasses + 1;
+        if (quietPasses >= 2 && plies > m_longestPlies + 1) break;
+    }
+    
+    if (plies > Tablebase::MAX_PLIES) {
+        std::fprintf(stderr, "Results longer than %d plies; they are stored as draws\n", Tablebase::MAX_PLIES);
+    }
+    
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - startTime;
+    
+    for (Slice& slice : group) {
+        std::unique_ptr<std::vector<std::uint8_t>> values(new std::vector<std::uint8_t>(slice.size));
+        std::uint64_t counts[4] = {0, 0, 0, 0}; // Impossible, draws, wins, losses
+        int longest = 0;
+        
+        for (std::uint64_t index = 0; index < slice.size; ++index) {
+            std::uint8_t value = slice.values[index].load(std::memory_order_relaxed);
+            if (value == UNKNOWN) value = 0;
+            (*values)[index] = value;
+            
+            Bitboard::Board board;
+            if (!Tablebase::boardAt(slice.material, index, board)) {
+                ++counts[0];
+                continue;
+            }
+            Tablebase::Entry entry = Tablebase::decode(value);
+            if (entry.result == Result::Draw) {
+                ++counts[1];
+            } else {
+                ++counts[entry.result == Result::Win ? 2 : 3];
+                longest = std::max(longest, entry.plies);
+            }
+        }
+        
+        if (!writeSlice(slice, *values)) return false;
+        
+        std::printf("%s  positions %10llu  wins %10llu  losses %10llu  draws %10llu  longest %3d plies  %.2f s\n",
+                    Tablebase::fileName(slice.material).c_str(),
+                    static_cast<unsigned long long>(slice.size - counts[0]),
+                    static_cast<unsigned long long>(counts[2]),
+                    static_cast<unsigned long long>(counts[3]),
+                    static_cast<unsigned long long>(counts[1]),
+                    longest,
+                    elapsed.count());
+        std::fflush(stdout);
+        
+        m_longestPlies = std::max(m_longestPlies, longest);
+        m_tablebase.setSlice(slice.material, values->data());
+        m_finished.push_back(std::move(values));
+        slice.values.reset();
+    }
+    
+    return true;
+}
+
+// Value of a position with Black to move, from Black's point of view
+std::uint8_t Generator::successorValue(const std::vector<Slice>& group, const Position& child) const
+{
+    Bitboard::Board board = Tablebase::flipped(child.board());
+    Material material = Tablebase::materialOf(board);
+    
+    for (const Slice& slice : group) {
+        if (slice.material == material) {
+            return slice.values[Tablebase::indexOf(board, material)].load(std::memory_order_relaxed);
+        }
+    }
+    
+    // Smaller slices are finished, and a side left with nothing has lost
+    Tablebase::Entry entry;
+    if (!m_tablebase.probe(child, entry)) {
+        std::fprintf(stderr, "Missing slice %s\n", Tablebase::fileName(material).c_str());
+        std::abort();
+    }
+    return Tablebase::encode(entry.result, entry.plies);
+}
+
+bool Generator::writeSlice(const Slice& slice, const std::vector<std::uint8_t>& values) const
+{
+    std::string path = m_directory + "/" + Tablebase::fileName(slice.material);
+    std::FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file) {
+        std::fprintf(stderr, "Cannot write %s\n", path.c_str());
+        return false;
+    }
+    
+    std::uint8_t header[Tablebase::FILE_HEADER_SIZE] = {'C', 'K', 'T', 'B', 1};
+    header[5] = static_cast<std::uint8_t>(slice.material.redMen);
+    header[6] = static_cast<std::uint8_t>(slice.material.redKings);
+    header[7] = static_cast<std::uint8_t>(slice.material.blackMen);
+    header[8] = static_cast<std::uint8_t>(slice.material.blackKings);
+    
+    bool ok = std::fwrite(header, 1, sizeof(header), file) == sizeof(header)
+           && std::fwrite(values.data(), 1, values.size(), file) == values.size();
+    ok = (std::fclose(file) == 0) && ok;
+    if (!ok) {
+        std::fprintf(stderr, "Error writing %s\n", path.c_str());
+    }
+    return ok;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2) {
+        printUsage();
+        return 1;
+    }
+    
+    std::string directory = argv[1];
+    int maxPieces = 4;
+    int threadCount = static_cast<int>(std::thread::hardware_concurrency());
+    
+    for (int i = 2; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--pieces") == 0 && i + 1 < argc) {
+            maxPieces = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            threadCount = std::atoi(argv[++i]);
+        } else {
+            printUsage();
+            return 1;
+        }
+    }
+    
+    if (maxPieces < 2 || maxPieces > Tablebase::MAX_PIECES) {
+        std::fprintf(stderr, "Pieces must be between 2 and %d\n", Tablebase::MAX_PIECES);
+        return 1;
+    }
+    if (threadCount < 1) {
+        threadCount = 1;
+    }
+    
+    auto startTime = std::chrono::steady_clock::now();
+    Generator generator(directory, threadCount);
+    if (!generator.generate(maxPieces)) {
+        return 1;
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - startTime;
+    std::printf("Done in %.1f s with %d threads\n", elapsed.count(), threadCount);
+    
+    return 0;
+}
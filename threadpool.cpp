@@ -0,0 +1,128 @@
+#include "threadpool.h"
+
+namespace {
+
+// The pool and queue of the worker running on this thread, if any
+thread_local const ThreadPool* t_pool = nullptr;
+thread_local int t_workerIndex = -1;
+
+} // namespace
+
+ThreadPool::ThreadPool(int threadCount)
+{
+    if (threadCount < 1) {
+        threadCount = 1;
+    }
+    
+    for (int i = 0; i < threadCount; ++i) {
+        m_workers.push_back(std::make_unique<Worker>());
+    }
+    for (int i = 0; i < threadCount; ++i) {
+        m_threads.emplace_back(&ThreadPool::run, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    wait();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_wake.notify_all();
+    for (std::thread& thread : m_threads) {
+        thread.join();
+    }
+}
+
+int ThreadPool::workerIndex() const
+{
+    return (t_pool == this) ? t_workerIndex : -1;
+}
+
+void ThreadPool::submit(Task task)
+{
+    // Workers keep what they spawn; other threads' tasks queue in order
+    Worker& queue = (t_pool == this) ? *m_workers[static_cast<size_t>(t_workerIndex)] : m_injected;
+    
+    m_pending++;
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.tasks.push_back(std::move(task));
+    }
+    {
+        // Counted under m_mutex so a worker about to sleep can't miss it
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_queued++;
+    }
+    m_wake.notify_one();
+}
+
+void ThreadPool::wait()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_idle.wait(lock, [this]() { return m_pending.load() == 0; });
+}
+
+bool ThreadPool::takeTask(int index, Task& task)
+{
+    // Own queue from the back
+    {
+        Worker& own = *m_workers[static_cast<size_t>(index)];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            m_queued--;
+            return true;
+        }
+    }
+    
+    // Then the oldest submitted from outside
+    {
+        std::lock_guard<std::mutex> lock(m_injected.mutex);
+        if (!m_injected.tasks.empty()) {
+            task = std::move(m_injected.tasks.front());
+            m_injected.tasks.pop_front();
+            m_queued--;
+            return true;
+        }
+    }
+    
+    // Steal from the front of the others'
+    const size_t count = m_workers.size();
+    for (size_t offset = 1; offset < count; ++offset) {
+        Worker& victim = *m_workers[(static_cast<size_t>(index) + offset) % count];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            m_queued--;
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::run(int index)
+{
+    t_pool = this;
+    t_workerIndex = index;
+    
+    for (;;) {
+        Task task;
+        if (takeTask(index, task)) {
+            task();
+            task = nullptr;
+            if (--m_pending == 0) {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_idle.notify_all();
+            }
+            continue;
+        }
+        
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_wake.wait(lock, [this]() { return m_stopping || m_queued.load() > 0; });
+        if (m_stopping && m_queued.load() == 0) return;
+    }
+}
@@ -0,0 +1,66 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads, each with its own task queue. A worker runs
+// the tasks it spawned itself newest first; once it has none it takes the
+// oldest task submitted from outside the pool, and then steals the oldest
+// task from another worker. Tasks of very different lengths (whole games,
+// say) keep every thread busy, and outside submissions start in the order
+// they were made.
+//
+// Tasks must not throw.
+class ThreadPool
+{
+public:
+    using Task = std::function<void()>;
+    
+    explicit ThreadPool(int threadCount);
+    ~ThreadPool(); // Finishes every queued task first
+    
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+    
+    int threadCount() const { return static_cast<int>(m_threads.size()); }
+    
+    // 0 to threadCount() - 1 on this pool's workers, -1 on any other thread
+    int workerIndex() const;
+    
+    // Safe from any thread. A task submitted by a worker goes on that
+    // worker's own queue, any other on the pool's first-in first-out one.
+    void submit(Task task);
+    
+    // Blocks until every task submitted so far has finished
+    void wait();
+    
+private:
+    struct Worker {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+    
+    void run(int index);
+    bool takeTask(int index, Task& task);
+    
+    std::vector<std::unique_ptr<Worker>> m_workers;
+    std::vector<std::thread> m_threads;
+    Worker m_injected; // Submitted from outside the pool, oldest first
+    
+    std::mutex m_mutex;
+    std::condition_variable m_wake; // Tasks were queued, or the pool is stopping
+    std::condition_variable m_idle; // The last pending task finished
+    std::atomic<std::size_t> m_queued{0};  // Waiting in a queue
+    std::atomic<std::size_t> m_pending{0}; // Queued or running
+    bool m_stopping = false;
+};
+
+#endif // THREADPOOL_H
@@ -0,0 +1,77 @@
+#include "threadpool.h"
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Checks the order ThreadPool runs tasks submitted from outside it, the
+// way checkers-match and checkers-analyze submit a window of work and use
+// each result once everything before it is done. Exits non-zero on failure.
+
+namespace {
+
+int failures = 0;
+
+void check(bool condition, const char* what)
+{
+    if (!condition) {
+        std::fprintf(stderr, "FAILED: %s\n", what);
+        ++failures;
+    }
+}
+
+// Outside submissions start oldest first, so the first task of a full
+// window finishes with the first few rather than after the whole window
+void testWindowStreamsInOrder(int threadCount)
+{
+    const int window = threadCount * 64;
+    std::mutex mutex;
+    std::vector<int> started;
+    std::vector<int> finished;
+    
+    {
+        ThreadPool pool(threadCount);
+        for (int i = 0; i < window; ++i) {
+            pool.submit([&mutex, &started, &finished, i]() {
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    started.push_back(i);
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(2));
+                std::lock_guard<std::mutex> lock(mutex);
+                finished.push_back(i);
+            });
+        }
+        pool.wait();
+    }
+    
+    check(static_cast<int>(finished.size()) == window, "every task ran");
+    
+    // Workers take from one queue, so only tasks taken at about the same
+    // time can record their start out of order
+    bool ordered = true;
+    for (int rank = 0; rank < static_cast<int>(started.size()); ++rank) {
+        if (started[static_cast<std::size_t>(rank)] > rank + threadCount
+            || started[static_cast<std::size_t>(rank)] < rank - threadCount) {
+            ordered = false;
+        }
+    }
+    check(ordered, "tasks start in submission order");
+    
+    int firstDone = 0;
+    while (finished[static_cast<std::size_t>(firstDone)] != 0) {
+        ++firstDone;
+    }
+    std::printf("%d threads: task 0 finished %d of %d\n", threadCount, firstDone + 1, window);
+    check(firstDone < window / 4, "the first result arrives before the window fills");
+}
+
+} // namespace
+
+int main()
+{
+    testWindowStreamsInOrder(1);
+    testWindowStreamsInOrder(4);
+    return failures == 0 ? 0 : 1;
+}
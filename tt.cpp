@@ -0,0 +1,114 @@
+#include "tt.h"
+#include <algorithm>
+
+namespace {
+
+// Packed entry layout:
+//   bits  0-7   from square (Move::NO_SQUARE for none)
+//   bits  8-15  to square
+//   bits 16-31  score (signed)
+//   bits 32-39  depth
+//   bits 40-41  bound
+//   bits 42-47  search generation
+constexpr int SCORE_SHIFT = 16;
+constexpr int DEPTH_SHIFT = 32;
+constexpr int BOUND_SHIFT = 40;
+constexpr int GENERATION_SHIFT = 42;
+
+std::uint64_t pack(const Move& move, int score, int depth, TranspositionTable::Bound bound, unsigned generation)
+{
+    return std::uint64_t(move.from)
+         | std::uint64_t(move.to) << 8
+         | std::uint64_t(std::uint16_t(static_cast<std::int16_t>(score))) << SCORE_SHIFT
+         | std::uint64_t(std::clamp(depth, 0, 255)) << DEPTH_SHIFT
+         | std::uint64_t(bound) << BOUND_SHIFT
+         | std::uint64_t(generation) << GENERATION_SHIFT;
+}
+
+int unpackDepth(std::uint64_t data)
+{
+    return static_cast<int>((data >> DEPTH_SHIFT) & 0xFF);
+}
+
+unsigned unpackGeneration(std::uint64_t data)
+{
+    return static_cast<unsigned>((data >> GENERATION_SHIFT) & 0x3F);
+}
+
+} // namespace
+
+TranspositionTable::TranspositionTable(std::size_t megabytes)
+{
+    resize(megabytes);
+}
+
+void TranspositionTable::resize(std::size_t megabytes)
+{
+    // Round down to a power of two so a slot is found with a mask
+    std::size_t slots = std::max<std::size_t>(megabytes, 1) * 1024 * 1024 / sizeof(Slot);
+    std::size_t count = 1;
+    while (count * 2 <= slots) {
+        count *= 2;
+    }
+    
+    m_slots.reset(new Slot[count]);
+    m_mask = count - 1;
+    clear();
+}
+
+void TranspositionTable::clear()
+{
+    for (std::size_t i = 0; i <= m_mask; ++i) {
+        m_slots[i].keyXorData.store(0, std::memory_order_relaxed);
+        m_slots[i].data.store(0, std::memory_order_relaxed);
+    }
+    m_generation = 0;
+}
+
+bool TranspositionTable::probe(std::uint64_t key, Entry& entry) const
+{
+    const Slot& slot = m_slots[key & m_mask];
+    std::uint64_t data = slot.data.load(std::memory_order_relaxed);
+    std::uint64_t check = slot.keyXorData.load(std::memory_order_relaxed);
+    
+    // Also rejects a slot that has never been written (data 0, check 0)
+    if ((check ^ data) != key || data == 0) return false;
+    
+    entry.move.from = static_cast<std::uint8_t>(data & 0xFF);
+    entry.move.to = static_cast<std::uint8_t>((data >> 8) & 0xFF);
+    entry.move.captures = 0;
+    entry.score = static_cast<std::int16_t>((data >> SCORE_SHIFT) & 0xFFFF);
+    entry.depth = unpackDepth(data);
+    entry.bound = static_cast<Bound>((data >> BOUND_SHIFT) & 0x3);
+    return true;
+}
+
+void TranspositionTable::store(std::uint64_t key, const Move& move, int score, int depth, Bound bound)
+{
+    Slot& slot = m_slots[key & m_mask];
+    std::uint64_t old = slot.data.load(std::memory_order_relaxed);
+    std::uint64_t oldCheck = slot.keyXorData.load(std::memory_order_relaxed);
+    
+    // Keep a deeper result for the same position from this search
+    if ((oldCheck ^ old) == key && unpackGeneration(old) == m_generation
+        && unpackDepth(old) > depth && bound != ExactBound) {
+        return;
+    }
+    
+    std::uint64_t data = pack(move, score, depth, bound, m_generation);
+    slot.data.store(data, std::memory_order_relaxed);
+    slot.keyXorData.store(key ^ data, std::memory_order_relaxed);
+}
+
+int TranspositionTable::hashfull() const
+{
+    const std::size_t sample = std::min<std::size_t>(1000, m_mask + 1);
+    int used = 0;
+    for (std::size_t i = 0; i < sample; ++i) {
+        std::uint64_t data = m_slots[i].data.load(std::memory_order_relaxed);
+        if (data != 0 && unpackGeneration(data) == m_generation) {
+            ++used;
+        }
+    }
+    return static_cast<int>(used * 1000 / sample);
+}
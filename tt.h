@@ -0,0 +1,62 @@
+#ifndef TT_H
+#define TT_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include "movelist.h"
+
+// Transposition table shared by all search threads without locks.
+//
+// Each slot is two atomic 64-bit words: the packed entry, and the position
+// key XORed with it. A reader accepts a slot only if the two words XOR back
+// to its key, so a slot torn by concurrent writers reads as a miss instead
+// of returning another position's data.
+class TranspositionTable
+{
+public:
+    enum Bound : int {
+        NoBound = 0,
+        UpperBound = 1, // Score is at most this (fail low)
+        LowerBound = 2, // Score is at least this (fail high)
+        ExactBound = 3
+    };
+    
+    struct Entry {
+        Move move; // Only from and to are kept; captures is always 0
+        int score;
+        int depth;
+        Bound bound;
+    };
+    
+    explicit TranspositionTable(std::size_t megabytes = 64);
+    
+    // Not thread-safe; call only while no search is running
+    void resize(std::size_t megabytes);
+    void clear();
+    void newSearch() { m_generation = (m_generation + 1) & GENERATION_MASK; }
+    
+    // Safe to call from any number of threads at once
+    bool probe(std::uint64_t key, Entry& entry) const;
+    void store(std::uint64_t key, const Move& move, int score, int depth, Bound bound);
+    
+    std::size_t slotCount() const { return m_mask + 1; }
+    
+    // Per-mille of a sample of slots written during the current search
+    int hashfull() const;
+    
+private:
+    static constexpr unsigned GENERATION_MASK = 0x3F;
+    
+    struct Slot {
+        std::atomic<std::uint64_t> keyXorData;
+        std::atomic<std::uint64_t> data;
+    };
+    
+    std::unique_ptr<Slot[]> m_slots;
+    std::size_t m_mask = 0;
+    unsigned m_generation = 0;
+};
+
+#endif // TT_H
@@ -0,0 +1,114 @@
+#include "variants.h"
+#include <charconv>
+
+namespace Variants {
+
+namespace {
+
+const char* const VARIANT_NAMES[] = {"american", "russian", "brazilian", "international"};
+
+bool parseSquare(std::string_view text, int squares, int& square)
+{
+    int number = 0;
+    auto result = std::from_chars(text.data(), text.data() + text.size(), number);
+    if (result.ec != std::errc() || result.ptr != text.data() + text.size()) return false;
+    if (number < 1 || number > squares) return false;
+    square = number - 1;
+    return true;
+}
+
+void appendFenPieces(std::string& fen, char color, const Piece* pieces, int squares, PlayerColor owner)
+{
+    fen += ':';
+    fen += color;
+    bool first = true;
+    for (int square = 0; square < squares; ++square) {
+        if (pieces[square] == Piece::Empty || ::Position::pieceOwner(pieces[square]) != owner) continue;
+        
+        if (!first) fen += ',';
+        if (::Position::isKing(pieces[square])) fen += 'K';
+        fen += std::to_string(square + 1);
+        first = false;
+    }
+}
+
+} // namespace
+
+bool parseVariant(std::string_view name, Variant& variant)
+{
+    for (int i = 0; i < 4; ++i) {
+        if (name == VARIANT_NAMES[i]) {
+            variant = static_cast<Variant>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+std::string fenFromPieces(PlayerColor sideToMove, const Piece* pieces, int squares)
+{
+    std::string fen(1, sideToMove == PlayerColor::Black ? 'B' : 'W');
+    appendFenPieces(fen, 'W', pieces, squares, PlayerColor::Red);
+    appendFenPieces(fen, 'B', pieces, squares, PlayerColor::Black);
+    return fen;
+}
+
+// The same syntax Position::fromFen reads, for any number of squares
+bool piecesFromFen(std::string_view fen, int squares, PlayerColor& sideToMove, Piece* pieces)
+{
+    while (!fen.empty() && (fen.front() == '"' || fen.front() == ' ')) fen.remove_prefix(1);
+    while (!fen.empty() && (fen.back() == '"' || fen.back() == ' ' || fen.back() == '.'
+                            || fen.back() == '\r' || fen.back() == '\n')) {
+        fen.remove_suffix(1);
+    }
+    
+    if (fen.size() < 1 || (fen[0] != 'W' && fen[0] != 'B')) return false;
+    
+    for (int square = 0; square < squares; ++square) {
+        pieces[square] = Piece::Empty;
+    }
+    sideToMove = fen[0] == 'B' ? PlayerColor::Black : PlayerColor::Red;
+    fen.remove_prefix(1);
+    
+    // Each field is ":W<squares>" or ":B<squares>"
+    while (!fen.empty()) {
+        if (fen.size() < 2 || fen[0] != ':' || (fen[1] != 'W' && fen[1] != 'B')) return false;
+        bool red = (fen[1] == 'W');
+        fen.remove_prefix(2);
+        
+        size_t end = fen.find(':');
+        std::string_view field = fen.substr(0, end);
+        fen.remove_prefix(end == std::string_view::npos ? fen.size() : end);
+        
+        while (!field.empty()) {
+            size_t comma = field.find(',');
+            std::string_view entry = field.substr(0, comma);
+            field.remove_prefix(comma == std::string_view::npos ? field.size() : comma + 1);
+            
+            bool king = !entry.empty() && entry[0] == 'K';
+            if (king) entry.remove_prefix(1);
+            
+            // Ranges such as "1-20" are allowed
+            int first = 0;
+            int last = 0;
+            size_t dash = entry.find('-');
+            if (dash == std::string_view::npos) {
+                if (!parseSquare(entry, squares, first)) return false;
+                last = first;
+            } else if (!parseSquare(entry.substr(0, dash), squares, first)
+                       || !parseSquare(entry.substr(dash + 1), squares, last) || last < first) {
+                return false;
+            }
+            
+            Piece piece = red ? (king ? Piece::RedKing : Piece::Red)
+                              : (king ? Piece::BlackKing : Piece::Black);
+            for (int square = first; square <= last; ++square) {
+                pieces[square] = piece;
+            }
+        }
+    }
+    
+    return true;
+}
+
+} // namespace Variants
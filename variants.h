@@ -0,0 +1,585 @@
+#ifndef VARIANTS_H
+#define VARIANTS_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include "position.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// Draughts rule variants as compile-time policies.
+//
+// Position (position.h) is hand-tuned for American checkers and is what the
+// engine, the GUI and the network protocol use. Variants::Position<Rules>
+// offers the same generate/make/unmake interface, built from a rules policy.
+// Board size, backward captures by men, flying kings, the maximum-capture
+// rule and crowning in the middle of a capture are all constants, so each
+// variant compiles to its own generator. The 8x8 American path pays nothing
+// for rules it doesn't have.
+//
+// Squares use the PDN numbering of each board: row-major from the top, row 0
+// being Black's back rank, dark squares only, so square 1 is always in the
+// second column. Red is the side at the bottom ("White" in PDN and in the
+// European games) and moves first.
+namespace Variants {
+
+// American checkers, the rules Position implements; perft must agree with it
+struct American {
+    static constexpr int SIZE = 8;
+    static constexpr bool MEN_CAPTURE_BACKWARD = false;
+    static constexpr bool FLYING_KINGS = false;
+    static constexpr bool MAXIMUM_CAPTURE = false;
+    static constexpr bool CROWN_DURING_CAPTURE = false;
+};
+
+// Russian draughts: any capture may be chosen, and a man that reaches the far
+// row during a capture is crowned at once and carries on as a king
+struct Russian {
+    static constexpr int SIZE = 8;
+    static constexpr bool MEN_CAPTURE_BACKWARD = true;
+    static constexpr bool FLYING_KINGS = true;
+    static constexpr bool MAXIMUM_CAPTURE = false;
+    static constexpr bool CROWN_DURING_CAPTURE = true;
+};
+
+// Brazilian draughts: the international rules on an 8x8 board
+struct Brazilian {
+    static constexpr int SIZE = 8;
+    static constexpr bool MEN_CAPTURE_BACKWARD = true;
+    static constexpr bool FLYING_KINGS = true;
+    static constexpr bool MAXIMUM_CAPTURE = true;
+    static constexpr bool CROWN_DURING_CAPTURE = false;
+};
+
+// International draughts. A man only crowns if its capture ends on the far row.
+struct International {
+    static constexpr int SIZE = 10;
+    static constexpr bool MEN_CAPTURE_BACKWARD = true;
+    static constexpr bool FLYING_KINGS = true;
+    static constexpr bool MAXIMUM_CAPTURE = true;
+    static constexpr bool CROWN_DURING_CAPTURE = false;
+};
+
+enum class Variant : int {
+    American,
+    Russian,
+    Brazilian,
+    International
+};
+
+// "american", "russian", "brazilian" or "international"
+bool parseVariant(std::string_view name, Variant& variant);
+
+// PDN FEN for any board size; pieces holds one Piece per square
+std::string fenFromPieces(PlayerColor sideToMove, const Piece* pieces, int squares);
+bool piecesFromFen(std::string_view fen, int squares, PlayerColor& sideToMove, Piece* pieces);
+
+// Playable squares fit a 32-bit mask on 8x8 and need 64 bits on 10x10
+template <int Size>
+using MaskFor = std::conditional_t<(Size * Size / 2 <= 32), std::uint32_t, std::uint64_t>;
+
+inline int lowestSquare(std::uint32_t m) { return Bitboard::lowestSquare(m); }
+
+inline int lowestSquare(std::uint64_t m)
+{
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward64(&index, m);
+    return static_cast<int>(index);
+#else
+    return __builtin_ctzll(m);
+#endif
+}
+
+inline int popCount(std::uint32_t m) { return Bitboard::popCount(m); }
+
+inline int popCount(std::uint64_t m)
+{
+#if defined(_MSC_VER)
+    return static_cast<int>(__popcnt64(m));
+#else
+    return __builtin_popcountll(m);
+#endif
+}
+
+template <class M>
+int popLowestSquare(M& m)
+{
+    int square = lowestSquare(m);
+    m &= m - 1;
+    return square;
+}
+
+// Board geometry, in the same layout as bitboard.h: even rows hold their
+// squares in the odd columns and odd rows in the even ones
+template <int Size>
+constexpr int squareIndex(int row, int col)
+{
+    if (row < 0 || row >= Size || col < 0 || col >= Size || (row + col) % 2 == 0) {
+        return -1;
+    }
+    return row * (Size / 2) + col / 2;
+}
+
+template <int Size>
+constexpr int squareRow(int square) { return square / (Size / 2); }
+
+template <int Size>
+constexpr int squareCol(int square) { return 2 * (square % (Size / 2)) + ((squareRow<Size>(square) & 1) ^ 1); }
+
+// The next square in each Bitboard::Direction, -1 off the board. A flying
+// king follows these links until it meets a piece.
+template <int Size>
+struct Neighbours {
+    std::int8_t next[Size * Size / 2][4] = {};
+};
+
+template <int Size>
+constexpr Neighbours<Size> makeNeighbours()
+{
+    const int rowStep[4] = {-1, -1, 1, 1};
+    const int colStep[4] = {-1, 1, -1, 1};
+    
+    Neighbours<Size> neighbours;
+    for (int square = 0; square < Size * Size / 2; ++square) {
+        for (int dir = 0; dir < 4; ++dir) {
+            neighbours.next[square][dir] = static_cast<std::int8_t>(
+                squareIndex<Size>(squareRow<Size>(square) + rowStep[dir], squareCol<Size>(square) + colStep[dir]));
+        }
+    }
+    return neighbours;
+}
+
+template <int Size>
+inline constexpr Neighbours<Size> NEIGHBOURS = makeNeighbours<Size>();
+
+template <int Size>
+constexpr MaskFor<Size> rowMask(int row)
+{
+    MaskFor<Size> mask = 0;
+    for (int i = 0; i < Size / 2; ++i) {
+        mask |= MaskFor<Size>(1) << (row * (Size / 2) + i);
+    }
+    return mask;
+}
+
+// Fixed-capacity, stack-resident move list, like MoveList
+template <class MoveType, int Capacity>
+class FixedMoveList
+{
+public:
+    static constexpr int CAPACITY = Capacity;
+    
+    void append(const MoveType& move)
+    {
+        if (m_size < CAPACITY) {
+            m_moves[m_size++] = move;
+        }
+    }
+    
+    void clear() { m_size = 0; }
+    int size() const { return m_size; }
+    bool isEmpty() const { return m_size == 0; }
+    
+    MoveType& operator[](int index) { return m_moves[index]; }
+    const MoveType& operator[](int index) const { return m_moves[index]; }
+    
+    MoveType* begin() { return m_moves; }
+    MoveType* end() { return m_moves + m_size; }
+    const MoveType* begin() const { return m_moves; }
+    const MoveType* end() const { return m_moves + m_size; }
+    
+private:
+    MoveType m_moves[CAPACITY];
+    int m_size = 0;
+};
+
+template <class Rules>
+class Position
+{
+public:
+    static constexpr int SIZE = Rules::SIZE;
+    static constexpr int SQUARES = SIZE * SIZE / 2;
+    using Mask = MaskFor<SIZE>;
+    
+    // Captured pieces are one bit each, as in Move. A man can't be told from
+    // a king by its squares alone once it may crown mid-capture, so the move
+    // says whether the piece ends it crowned.
+    struct Move {
+        std::uint8_t from;
+        std::uint8_t to;
+        bool crowns;
+        Mask captures;
+        
+        bool isCapture() const { return captures != 0; }
+    };
+    
+    // Flying kings on 10x10 have far more moves than the 8x8 men
+    using MoveList = FixedMoveList<Move, 256>;
+    
+    struct UndoRecord {
+        Move move;
+        Mask capturedKings;
+    };
+    
+    Position() { reset(); }
+    
+    void reset(); // Starting position, Red to move
+    void clear(); // No pieces, Red to move
+    
+    Piece pieceOn(int square) const;
+    void setPiece(int square, Piece piece);
+    PlayerColor sideToMove() const { return m_sideToMove; }
+    void setSideToMove(PlayerColor player) { m_sideToMove = player; }
+    Mask pieces(PlayerColor player) const { return player == PlayerColor::Red ? m_red : m_black; }
+    Mask kings() const { return m_kings; }
+    
+    // All legal moves for the side to move: captures are mandatory, every
+    // capture sequence is taken to the end, and under MAXIMUM_CAPTURE only
+    // the sequences taking the most pieces remain
+    void generateMoves(MoveList& moves) const;
+    
+    // Unchecked make/unmake, as for Position
+    void doMove(const Move& move, UndoRecord& undo);
+    void undoMove(const UndoRecord& undo);
+    
+    // Count leaf nodes of the legal move tree
+    std::uint64_t perft(int depth);
+    
+    std::string toFen() const;
+    bool fromFen(std::string_view fen);
+    
+private:
+    static constexpr Mask bit(int square) { return Mask(1) << square; }
+    
+    // Men step forward only: up for Red, down for Black
+    template <PlayerColor Side>
+    static constexpr int FORWARD = Side == PlayerColor::Red ? 0 : 2;
+    
+    template <PlayerColor Side>
+    static constexpr Mask PROMOTION_ROW = rowMask<SIZE>(Side == PlayerColor::Red ? 0 : SIZE - 1);
+    
+    // Captured pieces stay on the board as obstacles until the move ends, so
+    // occupied still holds them while opponents no longer does
+    template <PlayerColor Side, bool King>
+    static bool canCapture(int square, Mask opponents, Mask occupied);
+    
+    template <PlayerColor Side, bool King>
+    static void findCaptures(int square, int original, Mask opponents, Mask occupied, Mask captured,
+                             bool crowned, MoveList& moves, int& best);
+    
+    static void addCapture(const Move& move, MoveList& moves, int& best);
+    
+    template <PlayerColor Side>
+    void generateMovesFor(MoveList& moves) const;
+    
+    Mask m_red = 0;
+    Mask m_black = 0;
+    Mask m_kings = 0;
+    PlayerColor m_sideToMove = PlayerColor::Red;
+};
+
+template <class Rules>
+void Position<Rules>::reset()
+{
+    constexpr int startRows = SIZE / 2 - 1;
+    clear();
+    for (int row = 0; row < startRows; ++row) {
+        m_black |= rowMask<SIZE>(row);
+        m_red |= rowMask<SIZE>(SIZE - 1 - row);
+    }
+}
+
+template <class Rules>
+void Position<Rules>::clear()
+{
+    m_red = 0;
+    m_black = 0;
+    m_kings = 0;
+    m_sideToMove = PlayerColor::Red;
+}
+
+template <class Rules>
+Piece Position<Rules>::pieceOn(int square) const
+{
+    Mask mask = bit(square);
+    bool king = (m_kings & mask) != 0;
+    if (m_red & mask) return king ? Piece::RedKing : Piece::Red;
+    if (m_black & mask) return king ? Piece::BlackKing : Piece::Black;
+    return Piece::Empty;
+}
+
+template <class Rules>
+void Position<Rules>::setPiece(int square, Piece piece)
+{
+    Mask mask = bit(square);
+    m_red &= ~mask;
+    m_black &= ~mask;
+    m_kings &= ~mask;
+    if (piece == Piece::Empty) return;
+    
+    if (::Position::pieceOwner(piece) == PlayerColor::Red) {
+        m_red |= mask;
+    } else {
+        m_black |= mask;
+    }
+    if (::Position::isKing(piece)) {
+        m_kings |= mask;
+    }
+}
+
+template <class Rules>
+template <PlayerColor Side, bool King>
+bool Position<Rules>::canCapture(int square, Mask opponents, Mask occupied)
+{
+    const auto& next = NEIGHBOURS<SIZE>.next;
+    constexpr bool manBackward = Rules::MEN_CAPTURE_BACKWARD;
+    constexpr int first = (King || manBackward) ? 0 : FORWARD<Side>;
+    constexpr int end = (King || manBackward) ? 4 : FORWARD<Side> + 2;
+    
+    for (int dir = first; dir < end; ++dir) {
+        int mid = next[square][dir];
+        if constexpr (King && Rules::FLYING_KINGS) {
+            while (mid >= 0 && !(occupied & bit(mid))) mid = next[mid][dir];
+        }
+        if (mid < 0 || !(opponents & bit(mid))) continue;
+        
+        int land = next[mid][dir];
+        if (land >= 0 && !(occupied & bit(land))) return true;
+    }
+    return false;
+}
+
+template <class Rules>
+template <PlayerColor Side, bool King>
+void Position<Rules>::findCaptures(int square, int original, Mask opponents, Mask occupied, Mask captured,
+                                   bool crowned, MoveList& moves, int& best)
+{
+    const auto& next = NEIGHBOURS<SIZE>.next;
+    constexpr bool manBackward = Rules::MEN_CAPTURE_BACKWARD;
+    constexpr int first = (King || manBackward) ? 0 : FORWARD<Side>;
+    constexpr int end = (King || manBackward) ? 4 : FORWARD<Side> + 2;
+    bool foundJump = false;
+    
+    for (int dir = first; dir < end; ++dir) {
+        // A flying king may run up to the piece it takes
+        int mid = next[square][dir];
+        if constexpr (King && Rules::FLYING_KINGS) {
+            while (mid >= 0 && !(occupied & bit(mid))) mid = next[mid][dir];
+        }
+        if (mid < 0 || !(opponents & bit(mid))) continue;
+        
+        int land = next[mid][dir];
+        if (land < 0 || (occupied & bit(land))) continue;
+        
+        foundJump = true;
+        Mask remaining = opponents & ~bit(mid);
+        Mask taken = captured | bit(mid);
+        
+        if constexpr (King && Rules::FLYING_KINGS) {
+            // Any empty square beyond will do, but the capture must go on if
+            // it can, so only landings that continue it count when there are any
+            bool mustContinue = false;
+            for (int to = land; to >= 0 && !(occupied & bit(to)); to = next[to][dir]) {
+                if (canCapture<Side, true>(to, remaining, occupied)) {
+                    mustContinue = true;
+                    break;
+                }
+            }
+            for (int to = land; to >= 0 && !(occupied & bit(to)); to = next[to][dir]) {
+                if (mustContinue && !canCapture<Side, true>(to, remaining, occupied)) continue;
+                findCaptures<Side, true>(to, original, remaining, occupied, taken, crowned, moves, best);
+            }
+        } else if constexpr (!King && Rules::CROWN_DURING_CAPTURE) {
+            if (PROMOTION_ROW<Side> & bit(land)) {
+                findCaptures<Side, true>(land, original, remaining, occupied, taken, true, moves, best);
+            } else {
+                findCaptures<Side, false>(land, original, remaining, occupied, taken, false, moves, best);
+            }
+        } else {
+            findCaptures<Side, King>(land, original, remaining, occupied, taken, crowned, moves, best);
+        }
+    }
+    
+    // Only a sequence that can't be continued is a move
+    if (foundJump || !captured) return;
+    
+    bool crowns = crowned || (!King && (PROMOTION_ROW<Side> & bit(square)));
+    addCapture({static_cast<std::uint8_t>(original), static_cast<std::uint8_t>(square), crowns, captured},
+               moves, best);
+}
+
+template <class Rules>
+void Position<Rules>::addCapture(const Move& move, MoveList& moves, int& best)
+{
+    if constexpr (Rules::MAXIMUM_CAPTURE) {
+        int count = popCount(move.captures);
+        if (count < best) return;
+        if (count > best) {
+            moves.clear();
+            best = count;
+        }
+    }
+    
+    // Paths taking the same pieces to the same square are one move
+    for (int i = moves.size() - 1; i >= 0 && moves[i].from == move.from; --i) {
+        if (moves[i].to == move.to && moves[i].captures == move.captures && moves[i].crowns == move.crowns) return;
+    }
+    
+    moves.append(move);
+}
+
+template <class Rules>
+template <PlayerColor Side>
+void Position<Rules>::generateMovesFor(MoveList& moves) const
+{
+    const auto& next = NEIGHBOURS<SIZE>.next;
+    const Mask own = Side == PlayerColor::Red ? m_red : m_black;
+    const Mask opponents = Side == PlayerColor::Red ? m_black : m_red;
+    const Mask occupied = m_red | m_black;
+    
+    // The moving piece leaves its square, so a capture may pass back over it
+    int best = 0;
+    for (Mask pieces = own; pieces;) {
+        int square = popLowestSquare(pieces);
+        if (m_kings & bit(square)) {
+            findCaptures<Side, true>(square, square, opponents, occupied & ~bit(square), 0, false, moves, best);
+        } else {
+            findCaptures<Side, false>(square, square, opponents, occupied & ~bit(square), 0, false, moves, best);
+        }
+    }
+    if (!moves.isEmpty()) return;
+    
+    for (Mask pieces = own; pieces;) {
+        int square = popLowestSquare(pieces);
+        if (m_kings & bit(square)) {
+            for (int dir = 0; dir < 4; ++dir) {
+                for (int to = next[square][dir]; to >= 0 && !(occupied & bit(to)); to = next[to][dir]) {
+                    moves.append({static_cast<std::uint8_t>(square), static_cast<std::uint8_t>(to), false, 0});
+                    if (!Rules::FLYING_KINGS) break;
+                }
+            }
+        } else {
+            for (int dir = FORWARD<Side>; dir < FORWARD<Side> + 2; ++dir) {
+                int to = next[square][dir];
+                if (to < 0 || (occupied & bit(to))) continue;
+                
+                bool crowns = (PROMOTION_ROW<Side> & bit(to)) != 0;
+                moves.append({static_cast<std::uint8_t>(square), static_cast<std::uint8_t>(to), crowns, 0});
+            }
+        }
+    }
+}
+
+template <class Rules>
+void Position<Rules>::generateMoves(MoveList& moves) const
+{
+    moves.clear();
+    if (m_sideToMove == PlayerColor::Red) {
+        generateMovesFor<PlayerColor::Red>(moves);
+    } else {
+        generateMovesFor<PlayerColor::Black>(moves);
+    }
+}
+
+template <class Rules>
+void Position<Rules>::doMove(const Move& move, UndoRecord& undo)
+{
+    Mask from = bit(move.from);
+    Mask to = bit(move.to);
+    bool red = (m_sideToMove == PlayerColor::Red);
+    Mask& own = red ? m_red : m_black;
+    Mask& opp = red ? m_black : m_red;
+    
+    undo.move = move;
+    undo.capturedKings = move.captures & m_kings;
+    
+    // A king's capture may end on its starting square, so clear before setting
+    own = (own & ~from) | to;
+    if (m_kings & from) {
+        m_kings = (m_kings & ~from) | to;
+    } else if (move.crowns) {
+        m_kings |= to;
+    }
+    
+    opp &= ~move.captures;
+    m_kings &= ~move.captures;
+    m_sideToMove = red ? PlayerColor::Black : PlayerColor::Red;
+}
+
+template <class Rules>
+void Position<Rules>::undoMove(const UndoRecord& undo)
+{
+    m_sideToMove = (m_sideToMove == PlayerColor::Red) ? PlayerColor::Black : PlayerColor::Red;
+    
+    Mask from = bit(undo.move.from);
+    Mask to = bit(undo.move.to);
+    bool red = (m_sideToMove == PlayerColor::Red);
+    Mask& own = red ? m_red : m_black;
+    Mask& opp = red ? m_black : m_red;
+    
+    own = (own & ~to) | from;
+    if (undo.move.crowns) {
+        m_kings &= ~to;
+    } else if (m_kings & to) {
+        m_kings = (m_kings & ~to) | from;
+    }
+    
+    opp |= undo.move.captures;
+    m_kings |= undo.capturedKings;
+}
+
+template <class Rules>
+std::uint64_t Position<Rules>::perft(int depth)
+{
+    if (depth <= 0) return 1;
+    
+    MoveList moves;
+    generateMoves(moves);
+    
+    if (depth == 1) return static_cast<std::uint64_t>(moves.size());
+    
+    std::uint64_t nodes = 0;
+    UndoRecord undo;
+    
+    for (const Move& move : moves) {
+        doMove(move, undo);
+        nodes += perft(depth - 1);
+        undoMove(undo);
+    }
+    
+    return nodes;
+}
+
+template <class Rules>
+std::string Position<Rules>::toFen() const
+{
+    Piece pieces[SQUARES];
+    for (int square = 0; square < SQUARES; ++square) {
+        pieces[square] = pieceOn(square);
+    }
+    return fenFromPieces(m_sideToMove, pieces, SQUARES);
+}
+
+template <class Rules>
+bool Position<Rules>::fromFen(std::string_view fen)
+{
+    Piece pieces[SQUARES];
+    PlayerColor sideToMove = PlayerColor::Red;
+    if (!piecesFromFen(fen, SQUARES, sideToMove, pieces)) return false;
+    
+    clear();
+    m_sideToMove = sideToMove;
+    for (int square = 0; square < SQUARES; ++square) {
+        setPiece(square, pieces[square]);
+    }
+    return true;
+}
+
+} // namespace Variants
+
+#endif // VARIANTS_H
@@ -0,0 +1,79 @@
+#ifndef ZOBRIST_H
+#define ZOBRIST_H
+
+#include <cstdint>
+#include "bitboard.h"
+
+// Zobrist keys for 64-bit position hashing: one random key per piece kind
+// and playable square, plus one toggled when Black is to move. The keys are
+// generated at compile time so every build and every peer agrees on them.
+namespace Zobrist {
+
+enum PieceKind : int {
+    RedMan = 0,
+    BlackMan = 1,
+    RedKing = 2,
+    BlackKing = 3
+};
+
+struct Keys {
+    std::uint64_t pieces[4][Bitboard::SQUARES];
+    std::uint64_t blackToMove;
+};
+
+constexpr std::uint64_t splitMix64(std::uint64_t& state)
+{
+    std::uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+constexpr Keys makeKeys()
+{
+    Keys keys{};
+    std::uint64_t state = 0x2C1A4C4EC4E55ull;
+    for (int kind = 0; kind < 4; ++kind) {
+        for (int square = 0; square < Bitboard::SQUARES; ++square) {
+            keys.pieces[kind][square] = splitMix64(state);
+        }
+    }
+    keys.blackToMove = splitMix64(state);
+    return keys;
+}
+
+inline constexpr Keys KEYS = makeKeys();
+
+constexpr PieceKind pieceKind(bool red, bool king)
+{
+    return static_cast<PieceKind>((red ? 0 : 1) + (king ? 2 : 0));
+}
+
+constexpr std::uint64_t pieceKey(PieceKind kind, int square)
+{
+    return KEYS.pieces[kind][square];
+}
+
+// XOR of the keys for every piece of one kind in a mask
+inline std::uint64_t maskKey(PieceKind kind, Bitboard::Mask squares)
+{
+    std::uint64_t key = 0;
+    while (squares) {
+        key ^= pieceKey(kind, Bitboard::popLowestSquare(squares));
+    }
+    return key;
+}
+
+// Full hash of a board, used when a position is set up from scratch
+inline std::uint64_t hashBoard(const Bitboard::Board& board, bool blackToMove)
+{
+    std::uint64_t key = maskKey(RedMan, board.red & ~board.kings)
+                      ^ maskKey(BlackMan, board.black & ~board.kings)
+                      ^ maskKey(RedKing, board.red & board.kings)
+                      ^ maskKey(BlackKing, board.black & board.kings);
+    return blackToMove ? key ^ KEYS.blackToMove : key;
+}
+
+} // namespace Zobrist
+
+#endif // ZOBRIST_H